@@ -46,6 +46,19 @@ GS::Texture::Texture(uint32_t width, uint32_t height, gs_color_format format, ui
 		throw std::runtime_error("Failed to create texture.");
 }
 
+GS::Texture::Texture(std::string name, uint32_t width, uint32_t height, gs_color_format format, uint32_t mip_levels, const uint8_t **mip_data, uint32_t flags,
+	Cache *cache) : Texture(width, height, format, mip_levels, mip_data, flags, cache) {
+	m_name = name;
+	size_t bytes = 0;
+	for (uint32_t i = 0, w = width, h = height; i < mip_levels; i++) {
+		bytes += (size_t)w * h * gs_get_format_bpp(format) / 8;
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+	if (!m_cache->add(CacheableType::Texture, m_name, (void *)m_texture, bytes))
+		blog(LOG_WARNING, "Caching texture failed: %s", m_name.c_str());
+}
+
 GS::Texture::Texture(uint32_t width, uint32_t height, uint32_t depth, gs_color_format format, uint32_t mip_levels, const uint8_t **mip_data, uint32_t flags,
 	Cache *cache) : m_destroy(true), m_cache(cache) {
 	m_name = ""; // will not participate in caching
@@ -100,10 +113,15 @@ GS::Texture::Texture(std::string name,uint32_t size, gs_color_format format, uin
 
 		m_texture = gs_cubetexture_create(size, format, mip_levels, mip_data, (flags & Flags::Dynamic) ? GS_DYNAMIC : 0 | (flags & Flags::BuildMipMaps) ? GS_BUILD_MIPMAPS : 0);
 
-		if (!m_texture)
+		if (!m_texture) {
+			obs_leave_graphics();
 			throw std::runtime_error("Failed to create texture.");
+		}
 
-		if (!m_cache->add(CacheableType::Texture, m_name, (void *)m_texture))
+		size_t bytes = 0;
+		for (uint32_t i = 0, s = size; i < mip_levels && s > 0; i++, s /= 2)
+			bytes += (size_t)s * s * 6 * gs_get_format_bpp(format) / 8;
+		if (!m_cache->add(CacheableType::Texture, m_name, (void *)m_texture, bytes))
 			blog(LOG_WARNING, "Caching texture failed: %s", m_name.c_str());
 
 	}
@@ -102,6 +102,26 @@ namespace GS {
 			uint32_t flags,
 			Cache *cache);
 
+		/*!
+		 * \brief Create a new cached texture from data
+		 *
+		 * Same as the unnamed version, but the new texture is added to
+		 * the cache under name, so others can Cache::load it.
+		 */
+		Texture(std::string name, uint32_t width, uint32_t height,
+			gs_color_format format, uint32_t mip_levels,
+			const uint8_t **mip_data, uint32_t flags,
+			Cache *cache);
+
+		/*!
+		* \brief Wrap a texture already loaded from the cache
+		*
+		* Takes over the reference from Cache::load, and hands it back
+		* to the cache when destroyed.
+		*/
+		Texture(std::string name, gs_texture_t* tex, Cache *cache)
+			: m_texture(tex), m_destroy(true), m_name(name), m_cache(cache) {}
+
 		/*!
 		* \brief Load a texture from a file
 		*
@@ -160,7 +180,7 @@ namespace GS {
 		std::string m_name;
 
 		// cache manager from FM instance
-		// currently only caching cubemaps
+		// only named textures are cached
 		Cache *m_cache;
 
 	};
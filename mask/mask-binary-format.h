@@ -0,0 +1,68 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#pragma once
+#include <inttypes.h>
+
+// Compiled mask file layout
+// (shared with MaskMaker's compile command)
+//
+//   Header
+//   Section[numSections]
+//   section data, each starting on a SECTION_ALIGNMENT boundary
+//
+// Section 0 is the mask json, zero terminated. Big base64 values in
+// the json (image mips, vertex/index buffers, animation values, ...)
+// are replaced with a reference string "@blob:N", where N is the index
+// of a blob section that holds the decoded (and inflated) bytes.
+//
+namespace Mask {
+	namespace Binary {
+
+		static const char		MAGIC[4] = { 'F', 'M', 'S', 'K' };
+		static const uint32_t	VERSION = 1;
+		static const uint64_t	SECTION_ALIGNMENT = 16;
+		static const char* const BLOB_PREFIX = "@blob:";
+		static const char* const FILE_EXTENSION = ".fmask";
+
+		enum SectionType : uint32_t {
+			SECTION_JSON = 1,
+			SECTION_BLOB = 2,
+		};
+
+#pragma pack(push, 1)
+		struct Header {
+			char		magic[4];
+			uint32_t	version;
+			uint32_t	numSections;
+			uint32_t	reserved;
+		};
+
+		struct Section {
+			uint32_t	type;
+			uint32_t	reserved;
+			uint64_t	offset;
+			uint64_t	size;
+		};
+#pragma pack(pop)
+
+		static_assert(sizeof(Header) == 16, "Header layout changed");
+		static_assert(sizeof(Section) == 24, "Section layout changed");
+	}
+}
@@ -0,0 +1,204 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#include "mask-binary.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include "plugin/utils.h"
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Mask::Binary;
+
+namespace Mask {
+
+	MappedMaskFile::MappedMaskFile(const std::string& file)
+		: m_file(nullptr), m_mapping(nullptr), m_base(nullptr), m_size(0),
+		m_header(nullptr), m_sections(nullptr) {
+#ifdef _WIN32
+		std::wstring wide_file(Utils::ConvertStringToWstring(file));
+
+		HANDLE h = CreateFileW(wide_file.c_str(), GENERIC_READ, FILE_SHARE_READ,
+			NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (h == INVALID_HANDLE_VALUE)
+			throw std::runtime_error("Cannot open compiled mask file");
+		m_file = h;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(h, &size) || size.QuadPart == 0) {
+			Close();
+			throw std::runtime_error("Cannot get compiled mask file size");
+		}
+		m_size = (size_t)size.QuadPart;
+
+		m_mapping = CreateFileMappingW(h, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!m_mapping) {
+			Close();
+			throw std::runtime_error("Cannot map compiled mask file");
+		}
+		m_base = (const uint8_t*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+		int fd = open(file.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw std::runtime_error("Cannot open compiled mask file");
+		m_file = (void*)(intptr_t)(fd + 1);
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			Close();
+			throw std::runtime_error("Cannot get compiled mask file size");
+		}
+		m_size = (size_t)st.st_size;
+
+		void* p = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		m_base = (p == MAP_FAILED) ? nullptr : (const uint8_t*)p;
+#endif
+		if (!m_base) {
+			Close();
+			throw std::runtime_error("Cannot map compiled mask file");
+		}
+
+		try {
+			Validate();
+		}
+		catch (...) {
+			Close();
+			throw;
+		}
+	}
+
+	MappedMaskFile::~MappedMaskFile() {
+		Close();
+	}
+
+	void MappedMaskFile::Close() {
+#ifdef _WIN32
+		if (m_base)
+			UnmapViewOfFile(m_base);
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		if (m_file)
+			CloseHandle(m_file);
+#else
+		if (m_base)
+			munmap((void*)m_base, m_size);
+		if (m_file)
+			close((int)(intptr_t)m_file - 1);
+#endif
+		m_base = nullptr;
+		m_mapping = nullptr;
+		m_file = nullptr;
+		m_header = nullptr;
+		m_sections = nullptr;
+	}
+
+	void MappedMaskFile::Validate() {
+		if (m_size < sizeof(Header))
+			throw std::runtime_error("Compiled mask file is truncated");
+
+		m_header = (const Header*)m_base;
+		if (memcmp(m_header->magic, MAGIC, sizeof(MAGIC)) != 0)
+			throw std::runtime_error("Not a compiled mask file");
+		if (m_header->version != VERSION)
+			throw std::runtime_error("Unsupported compiled mask file version");
+
+		uint64_t tableEnd = sizeof(Header) +
+			(uint64_t)m_header->numSections * sizeof(Section);
+		if (m_header->numSections == 0 || tableEnd > m_size)
+			throw std::runtime_error("Compiled mask file has a bad section table");
+		m_sections = (const Section*)(m_base + sizeof(Header));
+
+		for (uint32_t i = 0; i < m_header->numSections; i++) {
+			const Section& s = m_sections[i];
+			if (s.offset < tableEnd || s.offset > m_size ||
+				s.size > m_size - s.offset)
+				throw std::runtime_error("Compiled mask file has a bad section");
+		}
+
+		const Section& json = m_sections[0];
+		if (json.type != SECTION_JSON || json.size == 0 ||
+			m_base[json.offset + json.size - 1] != 0)
+			throw std::runtime_error("Compiled mask file has no json section");
+	}
+
+	bool MappedMaskFile::IsCompiled(const std::string& file) {
+#ifdef _WIN32
+		std::ifstream f(Utils::ConvertStringToWstring(file).c_str(), std::ios::binary);
+#else
+		std::ifstream f(file, std::ios::binary);
+#endif
+		char magic[sizeof(MAGIC)];
+		if (!f.read(magic, sizeof(magic)))
+			return false;
+		return memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+	}
+
+	bool MappedMaskFile::IsUpToDate(const std::string& file,
+		const std::string& source) {
+#ifdef _WIN32
+		WIN32_FILE_ATTRIBUTE_DATA fileData, sourceData;
+		if (!GetFileAttributesExW(Utils::ConvertStringToWstring(file).c_str(),
+			GetFileExInfoStandard, &fileData))
+			return false;
+		if (!GetFileAttributesExW(Utils::ConvertStringToWstring(source).c_str(),
+			GetFileExInfoStandard, &sourceData))
+			return true;
+		return CompareFileTime(&fileData.ftLastWriteTime,
+			&sourceData.ftLastWriteTime) >= 0;
+#else
+		struct stat fileStat, sourceStat;
+		if (stat(file.c_str(), &fileStat) != 0)
+			return false;
+		if (stat(source.c_str(), &sourceStat) != 0)
+			return true;
+		return fileStat.st_mtime >= sourceStat.st_mtime;
+#endif
+	}
+
+	const char* MappedMaskFile::GetJson() const {
+		return (const char*)(m_base + m_sections[0].offset);
+	}
+
+	bool MappedMaskFile::GetBlob(const char* value, const uint8_t** data,
+		size_t* size) const {
+		size_t prefixLen = strlen(BLOB_PREFIX);
+		if (!value || strncmp(value, BLOB_PREFIX, prefixLen) != 0)
+			return false;
+
+		char* end = nullptr;
+		unsigned long idx = strtoul(value + prefixLen, &end, 10);
+		if (end == value + prefixLen || *end != 0 ||
+			idx == 0 || idx >= m_header->numSections ||
+			m_sections[idx].type != SECTION_BLOB)
+			throw std::runtime_error("Bad blob reference in compiled mask");
+
+		*data = m_base + m_sections[idx].offset;
+		*size = (size_t)m_sections[idx].size;
+		return true;
+	}
+}
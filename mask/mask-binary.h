@@ -0,0 +1,67 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#pragma once
+#include "mask-binary-format.h"
+#include <string>
+
+namespace Mask {
+
+	// MappedMaskFile : read-only view of a compiled mask file
+	//
+	// - the file is memory mapped, so blobs are handed out as
+	//   pointers straight into the mapping (no copies, no decoding)
+	// - pointers stay valid for the lifetime of this object
+	//
+	class MappedMaskFile {
+	public:
+		// throws std::runtime_error if the file can't be mapped,
+		// or isn't a valid compiled mask
+		MappedMaskFile(const std::string& file);
+		~MappedMaskFile();
+
+		// quick check of the file magic, without mapping it
+		static bool IsCompiled(const std::string& file);
+
+		// false if the compiled file is missing, or older than the
+		// source json it was compiled from (so it needs recompiling)
+		static bool IsUpToDate(const std::string& file, const std::string& source);
+
+		// the mask json (zero terminated)
+		const char* GetJson() const;
+
+		// Resolve a "@blob:N" reference. Returns false if the value
+		// is not a blob reference, throws if it is a bad one.
+		bool GetBlob(const char* value, const uint8_t** data, size_t* size) const;
+
+	private:
+		void*					m_file;
+		void*					m_mapping;
+		const uint8_t*			m_base;
+		size_t					m_size;
+		const Binary::Header*	m_header;
+		const Binary::Section*	m_sections;
+
+		void Validate();
+		void Close();
+
+		MappedMaskFile(const MappedMaskFile&) = delete;
+		MappedMaskFile& operator=(const MappedMaskFile&) = delete;
+	};
+}
@@ -0,0 +1,293 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#include "mask-block-compression.h"
+#include <cstring>
+
+namespace {
+	const int BLOCK_SIZE = 4;
+	const int BLOCK_TEXELS = BLOCK_SIZE * BLOCK_SIZE;
+
+	typedef uint8_t Block[BLOCK_TEXELS][4];
+
+	uint16_t pack565(const int c[3]) {
+		return (uint16_t)((((c[0] * 31 + 127) / 255) << 11) |
+			(((c[1] * 63 + 127) / 255) << 5) |
+			((c[2] * 31 + 127) / 255));
+	}
+
+	void unpack565(uint16_t v, int c[3]) {
+		int r = (v >> 11) & 31;
+		int g = (v >> 5) & 63;
+		int b = v & 31;
+		c[0] = (r << 3) | (r >> 2);
+		c[1] = (g << 2) | (g >> 4);
+		c[2] = (b << 3) | (b >> 2);
+	}
+
+	// texels outside the image repeat the edge
+	void fetchBlock(const uint8_t* rgba, int width, int height, int bx, int by, Block block) {
+		for (int y = 0; y < BLOCK_SIZE; y++) {
+			int sy = by + y < height ? by + y : height - 1;
+			for (int x = 0; x < BLOCK_SIZE; x++) {
+				int sx = bx + x < width ? bx + x : width - 1;
+				memcpy(block[y * BLOCK_SIZE + x], rgba + ((size_t)sy * width + sx) * 4, 4);
+			}
+		}
+	}
+
+	void storeBlock(const Block block, int width, int height, int bx, int by, uint8_t* rgba) {
+		for (int y = 0; y < BLOCK_SIZE && by + y < height; y++) {
+			for (int x = 0; x < BLOCK_SIZE && bx + x < width; x++) {
+				memcpy(rgba + ((size_t)(by + y) * width + bx + x) * 4, block[y * BLOCK_SIZE + x], 4);
+			}
+		}
+	}
+
+	void colorPalette(uint16_t c0, uint16_t c1, bool fourColors, uint8_t palette[4][4]) {
+		int a[3], b[3];
+		unpack565(c0, a);
+		unpack565(c1, b);
+		for (int i = 0; i < 3; i++) {
+			palette[0][i] = (uint8_t)a[i];
+			palette[1][i] = (uint8_t)b[i];
+			if (fourColors) {
+				palette[2][i] = (uint8_t)((2 * a[i] + b[i]) / 3);
+				palette[3][i] = (uint8_t)((a[i] + 2 * b[i]) / 3);
+			}
+			else {
+				palette[2][i] = (uint8_t)((a[i] + b[i]) / 2);
+				palette[3][i] = 0;
+			}
+		}
+		palette[0][3] = palette[1][3] = palette[2][3] = 255;
+		palette[3][3] = fourColors ? 255 : 0;
+	}
+
+	void compressColor(const Block block, uint8_t* out) {
+		// bounding box of the colors, along the diagonal that follows
+		// the widest channel
+		int lo[3] = { 255, 255, 255 };
+		int hi[3] = { 0, 0, 0 };
+		int mean[3] = { 0, 0, 0 };
+		for (int t = 0; t < BLOCK_TEXELS; t++) {
+			for (int i = 0; i < 3; i++) {
+				int v = block[t][i];
+				lo[i] = v < lo[i] ? v : lo[i];
+				hi[i] = v > hi[i] ? v : hi[i];
+				mean[i] += v;
+			}
+		}
+		int widest = 0;
+		for (int i = 1; i < 3; i++) {
+			if (hi[i] - lo[i] > hi[widest] - lo[widest])
+				widest = i;
+		}
+		for (int i = 0; i < 3; i++) {
+			if (i == widest)
+				continue;
+			int cov = 0;
+			for (int t = 0; t < BLOCK_TEXELS; t++) {
+				cov += (block[t][widest] * BLOCK_TEXELS - mean[widest]) *
+					(block[t][i] * BLOCK_TEXELS - mean[i]) / BLOCK_TEXELS;
+			}
+			if (cov < 0) {
+				int tmp = lo[i];
+				lo[i] = hi[i];
+				hi[i] = tmp;
+			}
+		}
+
+		// pull the end points in a little, they are rarely hit exactly
+		for (int i = 0; i < 3; i++) {
+			int inset = (hi[i] - lo[i]) / 16;
+			hi[i] -= inset;
+			lo[i] += inset;
+		}
+
+		uint16_t c0 = pack565(hi);
+		uint16_t c1 = pack565(lo);
+		// c0 > c1 selects the four color mode
+		if (c0 < c1) {
+			uint16_t tmp = c0;
+			c0 = c1;
+			c1 = tmp;
+		}
+
+		uint32_t indices = 0;
+		if (c0 != c1) {
+			uint8_t palette[4][4];
+			colorPalette(c0, c1, true, palette);
+			for (int t = 0; t < BLOCK_TEXELS; t++) {
+				int best = 0;
+				int bestDist = 0x7FFFFFFF;
+				for (int p = 0; p < 4; p++) {
+					int dist = 0;
+					for (int i = 0; i < 3; i++) {
+						int d = (int)block[t][i] - palette[p][i];
+						dist += d * d;
+					}
+					if (dist < bestDist) {
+						bestDist = dist;
+						best = p;
+					}
+				}
+				indices |= (uint32_t)best << (t * 2);
+			}
+		}
+
+		out[0] = (uint8_t)(c0 & 0xFF);
+		out[1] = (uint8_t)(c0 >> 8);
+		out[2] = (uint8_t)(c1 & 0xFF);
+		out[3] = (uint8_t)(c1 >> 8);
+		for (int i = 0; i < 4; i++)
+			out[4 + i] = (uint8_t)(indices >> (i * 8));
+	}
+
+	void decompressColor(const uint8_t* in, bool forceFourColors, Block block) {
+		uint16_t c0 = (uint16_t)(in[0] | (in[1] << 8));
+		uint16_t c1 = (uint16_t)(in[2] | (in[3] << 8));
+		uint32_t indices = (uint32_t)in[4] | ((uint32_t)in[5] << 8) |
+			((uint32_t)in[6] << 16) | ((uint32_t)in[7] << 24);
+
+		uint8_t palette[4][4];
+		colorPalette(c0, c1, forceFourColors || c0 > c1, palette);
+		for (int t = 0; t < BLOCK_TEXELS; t++)
+			memcpy(block[t], palette[(indices >> (t * 2)) & 3], 4);
+	}
+
+	void alphaPalette(int a0, int a1, int palette[8]) {
+		palette[0] = a0;
+		palette[1] = a1;
+		if (a0 > a1) {
+			for (int i = 1; i < 7; i++)
+				palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+		}
+		else {
+			for (int i = 1; i < 5; i++)
+				palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	void compressAlpha(const Block block, uint8_t* out) {
+		int a0 = 0;
+		int a1 = 255;
+		for (int t = 0; t < BLOCK_TEXELS; t++) {
+			a0 = block[t][3] > a0 ? block[t][3] : a0;
+			a1 = block[t][3] < a1 ? block[t][3] : a1;
+		}
+
+		uint64_t indices = 0;
+		if (a0 != a1) {
+			int palette[8];
+			alphaPalette(a0, a1, palette);
+			for (int t = 0; t < BLOCK_TEXELS; t++) {
+				int best = 0;
+				int bestDist = 256;
+				for (int p = 0; p < 8; p++) {
+					int d = block[t][3] - palette[p];
+					d = d < 0 ? -d : d;
+					if (d < bestDist) {
+						bestDist = d;
+						best = p;
+					}
+				}
+				indices |= (uint64_t)best << (t * 3);
+			}
+		}
+
+		out[0] = (uint8_t)a0;
+		out[1] = (uint8_t)a1;
+		for (int i = 0; i < 6; i++)
+			out[2 + i] = (uint8_t)(indices >> (i * 8));
+	}
+
+	void decompressAlpha(const uint8_t* in, Block block) {
+		int palette[8];
+		alphaPalette(in[0], in[1], palette);
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; i++)
+			indices |= (uint64_t)in[2 + i] << (i * 8);
+		for (int t = 0; t < BLOCK_TEXELS; t++)
+			block[t][3] = (uint8_t)palette[(indices >> (t * 3)) & 7];
+	}
+
+	size_t blockBytes(Mask::BlockCompression::Format format) {
+		return format == Mask::BlockCompression::BC1 ? 8 : 16;
+	}
+}
+
+namespace Mask {
+	namespace BlockCompression {
+
+		const char* FormatName(Format format) {
+			return format == BC1 ? "bc1" : "bc3";
+		}
+
+		bool ParseFormat(const char* name, Format* format) {
+			if (strcmp(name, "bc1") == 0)
+				*format = BC1;
+			else if (strcmp(name, "bc3") == 0)
+				*format = BC3;
+			else
+				return false;
+			return true;
+		}
+
+		size_t ImageSize(Format format, int width, int height) {
+			size_t bw = (size_t)((width > 0 ? width : 1) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+			size_t bh = (size_t)((height > 0 ? height : 1) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+			return bw * bh * blockBytes(format);
+		}
+
+		void Compress(Format format, const uint8_t* rgba, int width, int height, uint8_t* blocks) {
+			Block block;
+			for (int by = 0; by < height; by += BLOCK_SIZE) {
+				for (int bx = 0; bx < width; bx += BLOCK_SIZE) {
+					fetchBlock(rgba, width, height, bx, by, block);
+					if (format == BC3) {
+						compressAlpha(block, blocks);
+						blocks += 8;
+					}
+					compressColor(block, blocks);
+					blocks += 8;
+				}
+			}
+		}
+
+		void Decompress(Format format, const uint8_t* blocks, int width, int height, uint8_t* rgba) {
+			Block block;
+			for (int by = 0; by < height; by += BLOCK_SIZE) {
+				for (int bx = 0; bx < width; bx += BLOCK_SIZE) {
+					if (format == BC3) {
+						decompressColor(blocks + 8, true, block);
+						decompressAlpha(blocks, block);
+					}
+					else {
+						decompressColor(blocks, false, block);
+					}
+					blocks += blockBytes(format);
+					storeBlock(block, width, height, bx, by, rgba);
+				}
+			}
+		}
+	}
+}
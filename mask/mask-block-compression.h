@@ -0,0 +1,52 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#pragma once
+#include <inttypes.h>
+#include <stddef.h>
+
+// Block compressed (BC1/BC3, aka DXT1/DXT5) texture data
+// (shared with MaskMaker's compile command)
+//
+// - the image is split into 4x4 texel blocks, row by row. partial
+//   blocks at the right and bottom edges are padded.
+// - BC1 is 8 bytes per block, opaque RGB (4 bpp)
+// - BC3 is 16 bytes per block, BC1 colors plus interpolated alpha (8 bpp)
+// - uncompressed texels are 8 bit RGBA
+//
+namespace Mask {
+	namespace BlockCompression {
+
+		enum Format {
+			BC1,
+			BC3,
+		};
+
+		// "bc1" or "bc3", as stored in the image resource json
+		const char* FormatName(Format format);
+		bool ParseFormat(const char* name, Format* format);
+
+		// bytes of one (mip level) image
+		size_t ImageSize(Format format, int width, int height);
+
+		// rgba is width * height * 4 bytes, blocks is ImageSize() bytes
+		void Compress(Format format, const uint8_t* rgba, int width, int height, uint8_t* blocks);
+		void Decompress(Format format, const uint8_t* blocks, int width, int height, uint8_t* rgba);
+	}
+}
@@ -0,0 +1,126 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#pragma once
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+namespace Mask {
+
+	// DrawList : flat list of draw commands, ordered by a sort key
+	//
+	// - commands are built on the cpu without touching gs, then
+	//   submitted in key order by a separate pass
+	// - the storage is an arena that is reused frame to frame,
+	//   clear() keeps the memory around
+	// - sorting is a radix sort of (key, index) pairs, the commands
+	//   themselves don't move
+	// - equal keys keep the order they were added in
+	//
+	template <typename Command>
+	class DrawList {
+	public:
+		void clear() {
+			m_commands.clear();
+			m_order.clear();
+		}
+
+		size_t size() const { return m_order.size(); }
+		bool empty() const { return m_order.empty(); }
+
+		// add a command, returns it so the caller can fill it in
+		Command& add(uint64_t key) {
+			m_order.push_back(SortEntry{ key, (uint32_t)m_commands.size() });
+			m_commands.emplace_back();
+			return m_commands.back();
+		}
+
+		// lsd radix sort, one byte per pass. passes where every key
+		// has the same byte are skipped, so short keys are cheap.
+		void sort() {
+			size_t count = m_order.size();
+			if (count < 2)
+				return;
+			m_scratch.resize(count);
+			SortEntry* src = m_order.data();
+			SortEntry* dst = m_scratch.data();
+			for (int shift = 0; shift < 64; shift += 8) {
+				size_t offsets[256];
+				memset(offsets, 0, sizeof(offsets));
+				for (size_t i = 0; i < count; i++)
+					offsets[(src[i].key >> shift) & 0xFF]++;
+				if (offsets[(src[0].key >> shift) & 0xFF] == count)
+					continue;
+
+				size_t total = 0;
+				for (int b = 0; b < 256; b++) {
+					size_t n = offsets[b];
+					offsets[b] = total;
+					total += n;
+				}
+				for (size_t i = 0; i < count; i++)
+					dst[offsets[(src[i].key >> shift) & 0xFF]++] = src[i];
+
+				SortEntry* tmp = src;
+				src = dst;
+				dst = tmp;
+			}
+			if (src != m_order.data())
+				m_order.swap(m_scratch);
+		}
+
+		// i'th command in sorted order
+		const Command& operator[](size_t i) const {
+			return m_commands[m_order[i].index];
+		}
+		uint64_t key(size_t i) const { return m_order[i].key; }
+
+	private:
+		struct SortEntry {
+			uint64_t	key;
+			uint32_t	index;
+		};
+
+		std::vector<Command>	m_commands;
+		std::vector<SortEntry>	m_order;
+		std::vector<SortEntry>	m_scratch;
+	};
+
+	// sort key pieces: map values to unsigned ints in the same order
+	inline uint32_t SortKeyInt(int32_t v) {
+		return (uint32_t)v ^ 0x80000000u;
+	}
+
+	inline uint32_t SortKeyFloat(float f) {
+		uint32_t u;
+		memcpy(&u, &f, sizeof(u));
+		// negatives flip entirely, positives just get the sign bit
+		return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+	}
+
+	// neighbouring commands can go in one draw if they are the same
+	// object drawn for the same part, with the same instance data
+	template <typename Command>
+	inline bool CanBatch(const Command& a, const Command& b) {
+		return a.batch && b.batch && a.sorted == b.sorted &&
+			a.part == b.part && a.instanceId == b.instanceId;
+	}
+}
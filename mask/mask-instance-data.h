@@ -22,6 +22,7 @@
 #include <vector>
 #include <stack>
 #include <map>
+#include "mask-instance-table.h"
 extern "C" {
 #pragma warning( push )
 #pragma warning( disable: 4201 )
@@ -34,14 +35,6 @@ extern "C" {
 
 namespace Mask {
 
-	// base class for per-part instance data
-	// resources can subclass and add them to the 
-	// instanceDatas map 
-	struct InstanceData {
-		virtual ~InstanceData() {}
-		virtual void Reset() {}
-	};
-
 	// instance datas found in mask's instanceDatas
 	// - these will always be present
 
@@ -53,6 +46,19 @@ namespace Mask {
 		AlphaInstanceData() : alpha(1.0f) {}
 	};
 
+	// InstanceHandle
+	// - a resource's cached lookup of its instance data. most
+	//   resources keep asking for the same instance, so they hold
+	//   on to the last one they got.
+	class MaskInstanceDatas;
+	template<typename IDType>
+	struct InstanceHandle {
+		std::size_t					id;
+		IDType*						data;
+		const MaskInstanceDatas*	owner;
+		InstanceHandle() : id(0), data(nullptr), owner(nullptr) {}
+	};
+
 	// MaskInstanceDatas
 	// - manages per-instance data in the part/resource heirarchy
 	// - since resources may be referenced in multiple parts or 
@@ -75,37 +81,37 @@ namespace Mask {
 		MaskInstanceDatas() : m_currentId(0) {}
 
 		template<typename IDType>
-		std::shared_ptr<IDType> GetData() {
+		IDType* GetData() {
 			return GetData<IDType>(CurrentId());
 		}
 
 		template<typename IDType>
-		std::shared_ptr<IDType> GetData(std::size_t the_id) {
+		IDType* GetData(std::size_t the_id) {
 			// create instance data if we need to.
-			auto it = m_instanceDatas.find(the_id);
-			if (it == m_instanceDatas.end()) {
-				std::shared_ptr<IDType> instData =
-					std::make_shared<IDType>();
-				m_instanceDatas[the_id] = instData;
-				return instData;
-			}
-			else {
-				return std::dynamic_pointer_cast<IDType>
-					(it->second);
+			return m_instanceDatas.Get<IDType>(the_id);
+		}
+
+		// same, but skips the lookup when the handle already
+		// points at the data for this id
+		template<typename IDType>
+		IDType* GetData(InstanceHandle<IDType>& handle) {
+			return GetData(handle, CurrentId());
+		}
+
+		template<typename IDType>
+		IDType* GetData(InstanceHandle<IDType>& handle, std::size_t the_id) {
+			if (!handle.data || handle.id != the_id || handle.owner != this) {
+				handle.data = m_instanceDatas.Get<IDType>(the_id);
+				handle.id = the_id;
+				handle.owner = this;
 			}
+			return handle.data;
 		}
 
 		template<typename IDType>
-		std::shared_ptr<IDType> FindDataDontCreate(std::size_t the_id) {
+		IDType* FindDataDontCreate(std::size_t the_id) {
 			// return nullptr if not found
-			auto it = m_instanceDatas.find(the_id);
-			if (it == m_instanceDatas.end()) {
-				return nullptr;
-			}
-			else {
-				return std::dynamic_pointer_cast<IDType>
-					(it->second);
-			}
+			return m_instanceDatas.Find<IDType>(the_id);
 		}
 
 		inline void Push(std::size_t the_id) {
@@ -127,19 +133,16 @@ namespace Mask {
 			return m_currentId;
 		}
 
-		std::vector<std::shared_ptr<InstanceData>> GetInstances() {
-			std::vector<std::shared_ptr<InstanceData>> r;
-			r.reserve(m_instanceDatas.size());
-			for (auto const& kv : m_instanceDatas) {
-				r.push_back(kv.second);
+		void ResetInstances() {
+			for (InstanceData* data : m_instanceDatas.Datas()) {
+				data->Reset();
 			}
-			return r;
 		}
 
 	protected:
 		std::size_t m_currentId;
 		std::vector<size_t> m_stack;
-		std::map<size_t, std::shared_ptr<InstanceData>> m_instanceDatas;
+		InstanceTable m_instanceDatas;
 
 		inline void hash_combine(std::size_t val) {
 			m_currentId ^= val + 0x9e3779b9 + (m_currentId << 6) + (m_currentId >> 2);
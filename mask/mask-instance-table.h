@@ -0,0 +1,153 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#pragma once
+#include <inttypes.h>
+#include <stddef.h>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace Mask {
+
+	// base class for per-part instance data
+	// resources can subclass and add them to the 
+	// instanceDatas map 
+	struct InstanceData {
+		virtual ~InstanceData() {}
+		virtual void Reset() {}
+	};
+
+	// InstanceTable : instance datas keyed by (path hash, type)
+	//
+	// - open addressing with linear probing, power of two capacity,
+	//   grows at half full. entries are never removed.
+	// - every data type has its own pool. the pools are deques, so
+	//   the pointers handed out stay valid as they grow.
+	// - lookups return plain pointers, types are told apart by a
+	//   per type index instead of rtti
+	//
+	class InstanceTable {
+	public:
+		InstanceTable() : m_count(0) {}
+
+		size_t Size() const { return m_count; }
+
+		// nullptr if there is no data of this type for the id
+		template <typename T>
+		T* Find(size_t id) const {
+			if (m_slots.empty())
+				return nullptr;
+			return static_cast<T*>(m_slots[Probe(id, TypeIndex<T>())].data);
+		}
+
+		// creates the data if we need to
+		template <typename T>
+		T* Get(size_t id) {
+			uint32_t type = TypeIndex<T>();
+			if (m_slots.empty())
+				Grow();
+			size_t slot = Probe(id, type);
+			if (m_slots[slot].data)
+				return static_cast<T*>(m_slots[slot].data);
+
+			if ((m_count + 1) * 2 > m_slots.size()) {
+				Grow();
+				slot = Probe(id, type);
+			}
+			if (m_pools.size() <= type)
+				m_pools.resize(type + 1);
+			if (!m_pools[type])
+				m_pools[type].reset(new Pool<T>());
+			std::deque<T>& items = static_cast<Pool<T>*>(m_pools[type].get())->items;
+			items.emplace_back();
+
+			m_slots[slot] = Slot{ id, type, &items.back() };
+			m_datas.push_back(&items.back());
+			m_count++;
+			return &items.back();
+		}
+
+		// every data, in the order they were created
+		const std::vector<InstanceData*>& Datas() const { return m_datas; }
+
+	private:
+		struct Slot {
+			size_t			id;
+			uint32_t		type;
+			// nullptr for an empty slot
+			InstanceData*	data;
+		};
+		struct IPool {
+			virtual ~IPool() {}
+		};
+		template <typename T>
+		struct Pool : public IPool {
+			std::deque<T> items;
+		};
+
+		std::vector<Slot>					m_slots;
+		std::vector<std::unique_ptr<IPool>>	m_pools;
+		std::vector<InstanceData*>			m_datas;
+		size_t								m_count;
+
+		static uint32_t NextTypeIndex() {
+			// types can be first seen on several threads at once
+			static std::atomic<uint32_t> next(0);
+			return next++;
+		}
+
+		template <typename T>
+		static uint32_t TypeIndex() {
+			static const uint32_t index = NextTypeIndex();
+			return index;
+		}
+
+		// ids are already hashes, but small fixed ids (like the
+		// alpha id) need spreading out
+		static size_t Hash(size_t id, uint32_t type) {
+			uint64_t h = (uint64_t)id ^ ((uint64_t)type * 0x9E3779B97F4A7C15ULL);
+			h ^= h >> 33;
+			h *= 0xFF51AFD7ED558CCDULL;
+			h ^= h >> 33;
+			return (size_t)h;
+		}
+
+		// the slot holding (id, type), or the empty slot it would go in
+		size_t Probe(size_t id, uint32_t type) const {
+			size_t mask = m_slots.size() - 1;
+			size_t i = Hash(id, type) & mask;
+			while (m_slots[i].data &&
+				(m_slots[i].id != id || m_slots[i].type != type))
+				i = (i + 1) & mask;
+			return i;
+		}
+
+		void Grow() {
+			std::vector<Slot> old;
+			old.swap(m_slots);
+			m_slots.resize(old.empty() ? 64 : old.size() * 2, Slot{ 0, 0, nullptr });
+			for (const Slot& s : old) {
+				if (s.data)
+					m_slots[Probe(s.id, s.type)] = s;
+			}
+		}
+	};
+}
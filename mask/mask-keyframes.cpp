@@ -0,0 +1,261 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#include "mask-keyframes.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+	const size_t HEADER_SIZE = 7 * sizeof(uint32_t);
+	const float QUANTIZE_STEPS = 65535.0f;
+
+	void put(std::vector<uint8_t>* data, const void* src, size_t size) {
+		const uint8_t* bytes = (const uint8_t*)src;
+		data->insert(data->end(), bytes, bytes + size);
+	}
+
+	// min and step of a 16 bit quantization of values
+	void quantizeRange(const std::vector<float>& values, float* min, float* step) {
+		float lo = values.empty() ? 0.0f : values[0];
+		float hi = lo;
+		for (float v : values) {
+			lo = v < lo ? v : lo;
+			hi = v > hi ? v : hi;
+		}
+		*min = lo;
+		*step = (hi - lo) / QUANTIZE_STEPS;
+	}
+
+	void putQuantized(std::vector<uint8_t>* data, const std::vector<float>& values,
+		float min, float step) {
+		for (float v : values) {
+			float q = step > 0.0f ? (v - min) / step + 0.5f : 0.0f;
+			q = q < 0.0f ? 0.0f : (q > QUANTIZE_STEPS ? QUANTIZE_STEPS : q);
+			uint16_t u = (uint16_t)q;
+			put(data, &u, sizeof(u));
+		}
+	}
+
+	const uint8_t* getValues(const uint8_t* src, size_t count, bool quantized,
+		float min, float step, std::vector<float>* values) {
+		values->resize(count);
+		for (size_t i = 0; i < count; i++) {
+			if (quantized) {
+				uint16_t u;
+				memcpy(&u, src, sizeof(u));
+				src += sizeof(u);
+				(*values)[i] = min + (float)u * step;
+			}
+			else {
+				memcpy(&(*values)[i], src, sizeof(float));
+				src += sizeof(float);
+			}
+		}
+		return src;
+	}
+}
+
+namespace Mask {
+	namespace Keyframes {
+
+		void FromSamples(const float* samples, size_t count, float tolerance, Curve* curve) {
+			curve->times.clear();
+			curve->values.clear();
+			curve->length = (float)count;
+			if (count == 0)
+				return;
+
+			// keep a sample when the line from the last kept one to
+			// the next sample misses anything in between
+			size_t start = 0;
+			curve->times.push_back(0.0f);
+			curve->values.push_back(samples[0]);
+			for (size_t i = 1; i < count; i++) {
+				bool keep = (i == count - 1);
+				for (size_t j = start + 1; j <= i && !keep; j++) {
+					float s = (float)(j - start) / (float)(i + 1 - start);
+					float v = samples[start] + (samples[i + 1] - samples[start]) * s;
+					keep = std::fabs(v - samples[j]) > tolerance;
+				}
+				if (keep) {
+					curve->times.push_back((float)i);
+					curve->values.push_back(samples[i]);
+					start = i;
+				}
+			}
+
+			// linear segments
+			size_t numKeys = curve->times.size();
+			curve->inTangents.assign(numKeys, 0.0f);
+			curve->outTangents.assign(numKeys, 0.0f);
+			for (size_t k = 0; k + 1 < numKeys; k++) {
+				float slope = (curve->values[k + 1] - curve->values[k]) /
+					(curve->times[k + 1] - curve->times[k]);
+				curve->outTangents[k] = slope;
+				curve->inTangents[k + 1] = slope;
+			}
+			if (numKeys > 1) {
+				curve->inTangents[0] = curve->outTangents[0];
+				curve->outTangents[numKeys - 1] = curve->inTangents[numKeys - 1];
+			}
+		}
+
+		void Encode(const Curve& curve, bool quantize, std::vector<uint8_t>* data) {
+			uint32_t count = (uint32_t)curve.times.size();
+			uint32_t flags = quantize ? KEYS_QUANTIZED : 0;
+
+			float valueMin = 0.0f, valueStep = 0.0f;
+			float tangentMin = 0.0f, tangentStep = 0.0f;
+			if (quantize) {
+				quantizeRange(curve.values, &valueMin, &valueStep);
+				std::vector<float> tangents(curve.inTangents);
+				tangents.insert(tangents.end(), curve.outTangents.begin(), curve.outTangents.end());
+				quantizeRange(tangents, &tangentMin, &tangentStep);
+			}
+
+			data->clear();
+			put(data, &count, sizeof(count));
+			put(data, &flags, sizeof(flags));
+			put(data, &curve.length, sizeof(float));
+			put(data, &valueMin, sizeof(float));
+			put(data, &valueStep, sizeof(float));
+			put(data, &tangentMin, sizeof(float));
+			put(data, &tangentStep, sizeof(float));
+			put(data, curve.times.data(), count * sizeof(float));
+			if (quantize) {
+				putQuantized(data, curve.values, valueMin, valueStep);
+				putQuantized(data, curve.inTangents, tangentMin, tangentStep);
+				putQuantized(data, curve.outTangents, tangentMin, tangentStep);
+			}
+			else {
+				put(data, curve.values.data(), count * sizeof(float));
+				put(data, curve.inTangents.data(), count * sizeof(float));
+				put(data, curve.outTangents.data(), count * sizeof(float));
+			}
+		}
+
+		bool Decode(const uint8_t* data, size_t size, Curve* curve) {
+			if (size < HEADER_SIZE)
+				return false;
+			uint32_t count, flags;
+			float valueMin, valueStep, tangentMin, tangentStep;
+			memcpy(&count, data, sizeof(count));
+			memcpy(&flags, data + 4, sizeof(flags));
+			memcpy(&curve->length, data + 8, sizeof(float));
+			memcpy(&valueMin, data + 12, sizeof(float));
+			memcpy(&valueStep, data + 16, sizeof(float));
+			memcpy(&tangentMin, data + 20, sizeof(float));
+			memcpy(&tangentStep, data + 24, sizeof(float));
+
+			bool quantized = (flags & KEYS_QUANTIZED) != 0;
+			size_t valueSize = quantized ? sizeof(uint16_t) : sizeof(float);
+			if (size < HEADER_SIZE + (size_t)count * (sizeof(float) + 3 * valueSize))
+				return false;
+
+			const uint8_t* src = data + HEADER_SIZE;
+			curve->times.resize(count);
+			memcpy(curve->times.data(), src, count * sizeof(float));
+			src += count * sizeof(float);
+			for (uint32_t i = 1; i < count; i++) {
+				if (!(curve->times[i] > curve->times[i - 1]))
+					return false;
+			}
+
+			src = getValues(src, count, quantized, valueMin, valueStep, &curve->values);
+			src = getValues(src, count, quantized, tangentMin, tangentStep, &curve->inTangents);
+			getValues(src, count, quantized, tangentMin, tangentStep, &curve->outTangents);
+			return true;
+		}
+
+		size_t CurveSet::Add(const Curve& curve, Extrapolation pre, Extrapolation post) {
+			Range r;
+			r.first = (uint32_t)m_times.size();
+			r.count = (uint32_t)curve.times.size();
+			r.pre = pre;
+			r.post = post;
+			r.length = curve.length;
+			m_ranges.push_back(r);
+
+			m_times.insert(m_times.end(), curve.times.begin(), curve.times.end());
+			m_values.insert(m_values.end(), curve.values.begin(), curve.values.end());
+			m_inTangents.insert(m_inTangents.end(), curve.inTangents.begin(), curve.inTangents.end());
+			m_outTangents.insert(m_outTangents.end(), curve.outTangents.begin(), curve.outTangents.end());
+			return m_ranges.size() - 1;
+		}
+
+		void CurveSet::Clear() {
+			m_ranges.clear();
+			m_times.clear();
+			m_values.clear();
+			m_inTangents.clear();
+			m_outTangents.clear();
+		}
+
+		void CurveSet::Evaluate(float frame, float* out) const {
+			for (size_t i = 0; i < m_ranges.size(); i++)
+				out[i] = Evaluate(i, frame);
+		}
+
+		float CurveSet::Evaluate(size_t which, float frame) const {
+			const Range& r = m_ranges[which];
+			if (r.count == 0)
+				return 0.0f;
+			const float* times = m_times.data() + r.first;
+			const float* values = m_values.data() + r.first;
+			uint32_t last = r.count - 1;
+
+			// outside the keys
+			if (frame < times[0] || frame > times[last]) {
+				bool before = frame < times[0];
+				Extrapolation mode = before ? r.pre : r.post;
+				if (mode == LINEAR) {
+					if (before)
+						return values[0] - (times[0] - frame) * m_inTangents[r.first];
+					return values[last] + (frame - times[last]) * m_outTangents[r.first + last];
+				}
+				float period = r.length > 0.0f ? r.length : times[last] - times[0];
+				if (mode == CONSTANT || period <= 0.0f)
+					return before ? values[0] : values[last];
+				frame = times[0] + std::fmod(frame - times[0], period);
+				if (frame < times[0])
+					frame += period;
+			}
+
+			// the segment, from k - 1 to k
+			uint32_t k = (uint32_t)(std::upper_bound(times, times + r.count, frame) - times);
+			if (k == 0)
+				return values[0];
+			if (k > last)
+				return values[last];
+
+			float t0 = times[k - 1];
+			float dt = times[k] - t0;
+			float s = (frame - t0) / dt;
+			float s2 = s * s;
+			float s3 = s2 * s;
+			float m0 = m_outTangents[r.first + k - 1] * dt;
+			float m1 = m_inTangents[r.first + k] * dt;
+			return (2.0f * s3 - 3.0f * s2 + 1.0f) * values[k - 1] +
+				(s3 - 2.0f * s2 + s) * m0 +
+				(-2.0f * s3 + 3.0f * s2) * values[k] +
+				(s3 - s2) * m1;
+		}
+	}
+}
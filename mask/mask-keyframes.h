@@ -0,0 +1,106 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#pragma once
+#include <inttypes.h>
+#include <stddef.h>
+#include <vector>
+
+// Keyframed animation curves
+// (shared with MaskMaker's import command)
+//
+// - a curve is a list of keys (time in frames, value, in and out
+//   tangents in value per frame), evaluated as cubic hermite
+//   segments at any time, not just whole frames
+// - the "keys" blob of an animation channel is an encoded curve,
+//   little endian:
+//     uint32	number of keys
+//     uint32	flags (KEYS_QUANTIZED)
+//     float	length in frames, the period when repeating
+//     float	value min, value step
+//     float	tangent min, tangent step
+//     float	times[number of keys]
+//     values[], in tangents[], out tangents[] : uint16 when
+//       quantized (min + q * step), float otherwise
+//
+namespace Mask {
+	namespace Keyframes {
+
+		static const uint32_t KEYS_QUANTIZED = 1;
+
+		// what a curve does outside of its keys. same order as
+		// the animation pre/post states.
+		enum Extrapolation : uint32_t {
+			CONSTANT,
+			LINEAR,
+			REPEAT,
+		};
+
+		struct Curve {
+			std::vector<float>	times;
+			std::vector<float>	values;
+			std::vector<float>	inTangents;
+			std::vector<float>	outTangents;
+			float				length;
+
+			Curve() : length(0.0f) {}
+		};
+
+		// Keys for one sample per frame, with linear tangents. Keys
+		// that are within tolerance of the line through their
+		// neighbours are dropped.
+		void FromSamples(const float* samples, size_t count, float tolerance, Curve* curve);
+
+		void Encode(const Curve& curve, bool quantize, std::vector<uint8_t>* data);
+		// false if the data is not a valid curve
+		bool Decode(const uint8_t* data, size_t size, Curve* curve);
+
+		// CurveSet : all the curves of an animation
+		//
+		// - the keys of every curve are packed back to back, so the
+		//   whole set is evaluated in one pass over flat arrays
+		//
+		class CurveSet {
+		public:
+			// returns the index of the curve
+			size_t Add(const Curve& curve, Extrapolation pre, Extrapolation post);
+			size_t Size() const { return m_ranges.size(); }
+			void Clear();
+
+			// one value per curve into out
+			void Evaluate(float frame, float* out) const;
+			float Evaluate(size_t which, float frame) const;
+
+		private:
+			struct Range {
+				uint32_t		first;
+				uint32_t		count;
+				Extrapolation	pre;
+				Extrapolation	post;
+				float			length;
+			};
+
+			std::vector<Range>	m_ranges;
+			std::vector<float>	m_times;
+			std::vector<float>	m_values;
+			std::vector<float>	m_inTangents;
+			std::vector<float>	m_outTangents;
+		};
+	}
+}
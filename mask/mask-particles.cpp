@@ -0,0 +1,136 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#include "mask-particles.h"
+#include <functional>
+#include <utility>
+#include <xmmintrin.h>
+
+void Mask::ParticleStore::Init(int capacity) {
+	if (capacity < 0)
+		capacity = 0;
+	size_t n = (size_t)capacity;
+	m_px.assign(n, 0.0f);
+	m_py.assign(n, 0.0f);
+	m_pz.assign(n, 0.0f);
+	m_vx.assign(n, 0.0f);
+	m_vy.assign(n, 0.0f);
+	m_vz.assign(n, 0.0f);
+	m_elapsed.assign(n, 0.0f);
+	m_friction.assign(n, 0.0f);
+	m_fx.assign(n, 0.0f);
+	m_fy.assign(n, 0.0f);
+	m_fz.assign(n, 0.0f);
+
+	std::hash<int> hasher;
+	m_ids.resize(n);
+	for (int i = 0; i < capacity; i++)
+		m_ids[i] = hasher(i);
+
+	Reset();
+}
+
+int Mask::ParticleStore::Emit(int num, const float velocityMin[3], const float velocityMax[3],
+	float velocityScale, ParticleRandom& random) {
+	int room = Capacity() - m_count;
+	if (num > room)
+		num = room;
+	for (int i = m_count; i < m_count + num; i++) {
+		m_px[i] = m_py[i] = m_pz[i] = 0.0f;
+		m_vx[i] = random.Float(velocityMin[0], velocityMax[0]) * velocityScale;
+		m_vy[i] = random.Float(velocityMin[1], velocityMax[1]) * velocityScale;
+		m_vz[i] = random.Float(velocityMin[2], velocityMax[2]) * velocityScale;
+		m_elapsed[i] = 0.0f;
+	}
+	m_count += num;
+	return num;
+}
+
+void Mask::ParticleStore::Integrate(float time, float lifetime, const ParticleForces& forces,
+	ParticleRandom& random) {
+	int n = m_alive;
+	if (n == 0)
+		return;
+
+	// random friction and force first, so the loop below is
+	// straight float math
+	for (int i = 0; i < n; i++) {
+		m_friction[i] = random.Float(forces.frictionMin, forces.frictionMax);
+		m_fx[i] = random.Float(forces.forceMin[0], forces.forceMax[0]) * time;
+		m_fy[i] = random.Float(forces.forceMin[1], forces.forceMax[1]) * time;
+		m_fz[i] = random.Float(forces.forceMin[2], forces.forceMax[2]) * time;
+	}
+
+	// p += v * t, then v = v * friction + force * t
+	float* p[3] = { m_px.data(), m_py.data(), m_pz.data() };
+	float* v[3] = { m_vx.data(), m_vy.data(), m_vz.data() };
+	const float* f[3] = { m_fx.data(), m_fy.data(), m_fz.data() };
+	float* e = m_elapsed.data();
+	const float* fr = m_friction.data();
+
+	__m128 t = _mm_set1_ps(time);
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		_mm_storeu_ps(e + i, _mm_add_ps(_mm_loadu_ps(e + i), t));
+		__m128 friction = _mm_loadu_ps(fr + i);
+		for (int a = 0; a < 3; a++) {
+			__m128 vel = _mm_loadu_ps(v[a] + i);
+			__m128 pos = _mm_loadu_ps(p[a] + i);
+			_mm_storeu_ps(p[a] + i, _mm_add_ps(pos, _mm_mul_ps(vel, t)));
+			vel = _mm_add_ps(_mm_mul_ps(vel, friction), _mm_loadu_ps(f[a] + i));
+			_mm_storeu_ps(v[a] + i, vel);
+		}
+	}
+	for (; i < n; i++) {
+		e[i] += time;
+		for (int a = 0; a < 3; a++) {
+			p[a][i] += v[a][i] * time;
+			v[a][i] = v[a][i] * fr[i] + f[a][i];
+		}
+	}
+
+	// kill old ones, back to front so swapped in particles have
+	// already been checked
+	for (int j = n - 1; j >= 0; j--) {
+		if (e[j] > lifetime)
+			Kill(j);
+	}
+}
+
+void Mask::ParticleStore::Swap(int a, int b) {
+	if (a == b)
+		return;
+	std::swap(m_px[a], m_px[b]);
+	std::swap(m_py[a], m_py[b]);
+	std::swap(m_pz[a], m_pz[b]);
+	std::swap(m_vx[a], m_vx[b]);
+	std::swap(m_vy[a], m_vy[b]);
+	std::swap(m_vz[a], m_vz[b]);
+	std::swap(m_elapsed[a], m_elapsed[b]);
+	std::swap(m_ids[a], m_ids[b]);
+}
+
+void Mask::ParticleStore::Kill(int i) {
+	// last live particle fills the hole, last spawned one fills
+	// its place, and the dead one ends up first in the free range
+	Swap(i, m_alive - 1);
+	Swap(m_alive - 1, m_count - 1);
+	m_alive--;
+	m_count--;
+}
@@ -0,0 +1,118 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#pragma once
+#include <inttypes.h>
+#include <stddef.h>
+#include <vector>
+
+namespace Mask {
+
+	// ParticleRandom : xorshift prng, one per emitter instance
+	class ParticleRandom {
+	public:
+		explicit ParticleRandom(uint32_t seed = 1) { Seed(seed); }
+
+		void Seed(uint32_t seed) { m_state = seed ? seed : 0x9E3779B9u; }
+
+		uint32_t Next() {
+			m_state ^= m_state << 13;
+			m_state ^= m_state >> 17;
+			m_state ^= m_state << 5;
+			return m_state;
+		}
+
+		// uniform in [min, max)
+		float Float(float min, float max) {
+			float a = (float)(Next() >> 8) * (1.0f / 16777216.0f);
+			return a * (max - min) + min;
+		}
+
+	private:
+		uint32_t m_state;
+	};
+
+	// per tick random ranges applied to live particles
+	struct ParticleForces {
+		float	frictionMin, frictionMax;
+		float	forceMin[3], forceMax[3];
+	};
+
+	// ParticleStore : particle pool as a structure of arrays
+	//
+	// - slots [0, NumAlive) are live particles, [NumAlive, Count) are
+	//   spawned ones waiting for their first render to be placed,
+	//   [Count, Capacity) are free
+	// - dead particles are swapped out to the free range, so every
+	//   loop runs over a dense range and emitting is an append
+	// - each slot keeps an instance id that moves with the particle,
+	//   the ids are a fixed set so per particle instance data is reused
+	//
+	class ParticleStore {
+	public:
+		ParticleStore() : m_alive(0), m_count(0) {}
+
+		void Init(int capacity);
+		// kill everything
+		void Reset() { m_alive = m_count = 0; }
+
+		int Capacity() const { return (int)m_elapsed.size(); }
+		int Count() const { return m_count; }
+		int NumAlive() const { return m_alive; }
+
+		// add up to num spawned particles at the origin, with a random
+		// velocity per axis scaled by velocityScale. returns how many
+		// fit.
+		int Emit(int num, const float velocityMin[3], const float velocityMax[3],
+			float velocityScale, ParticleRandom& random);
+
+		// spawned particles have been placed, they are live now
+		void MarkAlive() { m_alive = m_count; }
+
+		// move live particles along, apply friction and force, and kill
+		// the ones older than lifetime
+		void Integrate(float time, float lifetime, const ParticleForces& forces,
+			ParticleRandom& random);
+
+		float*	px() { return m_px.data(); }
+		float*	py() { return m_py.data(); }
+		float*	pz() { return m_pz.data(); }
+		float*	vx() { return m_vx.data(); }
+		float*	vy() { return m_vy.data(); }
+		float*	vz() { return m_vz.data(); }
+		const float*	elapsed() const { return m_elapsed.data(); }
+		const size_t*	ids() const { return m_ids.data(); }
+
+	private:
+		void Swap(int a, int b);
+		void Kill(int i);
+
+		int		m_alive;
+		int		m_count;
+
+		std::vector<float>	m_px, m_py, m_pz;
+		std::vector<float>	m_vx, m_vy, m_vz;
+		std::vector<float>	m_elapsed;
+		std::vector<size_t>	m_ids;
+
+		// per tick randoms, drawn before integrating
+		std::vector<float>	m_friction;
+		std::vector<float>	m_fx, m_fy, m_fz;
+	};
+}
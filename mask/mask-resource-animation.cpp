@@ -22,57 +22,7 @@
 #include "plugin/exceptions.h"
 #include "plugin/plugin.h"
 #include "plugin/utils.h"
-
-
-float	Mask::Resource::AnimationChannel::GetValue(int frame) {
-	float v = 0.0f;
-
-	if (frame < 0) {
-		switch (preState) {
-		case CONSTANT:
-			if (values.size() > 0)
-				v = values[0];
-			break;
-		case LINEAR:
-			// todo
-			if (values.size() > 0)
-				v = values[0];
-			break;
-		case REPEAT:
-			while (frame < 0)
-				frame += (int)values.size();
-			if (frame < values.size())
-				v = values[frame];
-			break;
-		}
-	}
-	else if (frame >= values.size()) {
-		switch (postState) {
-		case CONSTANT:
-			if (values.size() > 0)
-				v = values[values.size() - 1];
-			break;
-		case LINEAR:
-			// TODO
-			if (values.size() > 0)
-				v = values[values.size() - 1];
-			break;
-		case REPEAT:
-			if (values.size() > 0) {
-				frame = frame % values.size();
-				v = values[frame];
-			}
-			break;
-		}
-	}
-	else {
-		v = values[frame];
-	}
-
-	return v;
-}
-
-
+#include <cstring>
 
 
 Mask::Resource::Animation::Animation(Mask::MaskData* parent, std::string name, obs_data_t* data)
@@ -151,28 +101,56 @@ Mask::Resource::Animation::Animation(Mask::MaskData* parent, std::string name, o
 		}
 		channel.postState = AnimationBehaviourFromString(obs_data_get_string(chand, S_POSTSTATE));
 
-		if (!obs_data_has_user_value(chand, S_VALUES)) {
+		// keyframes, or one value per frame from older masks
+		bool haveKeys = obs_data_has_user_value(chand, S_KEYS);
+		const char* keysName = haveKeys ? S_KEYS : S_VALUES;
+		if (!obs_data_has_user_value(chand, keysName)) {
 			obs_data_release(chand);
 			obs_data_release(channels);
 			PLOG_ERROR("Animation '%s' channel has no values.", name.c_str());
 			throw std::logic_error("Animation channel has no values.");
 		}
-		const char* base64data = obs_data_get_string(chand, S_VALUES);
+		const char* base64data = obs_data_get_string(chand, keysName);
 		if (base64data[0] == '\0') {
 			obs_data_release(chand);
 			obs_data_release(channels);
 			PLOG_ERROR("Animation '%s' channel has empty values data.", name.c_str());
 			throw std::logic_error("Animation channel has empty values data.");
 		}
+		const uint8_t* blob;
+		size_t blobSize;
 		std::vector<uint8_t> decoded;
-		base64_decodeZ(base64data, decoded);
-		size_t numFloats = decoded.size() / sizeof(float);
-		channel.values.assign((float*)decoded.data(), (float*)decoded.data() + numFloats);
+		if (!parent->GetBlob(base64data, &blob, &blobSize)) {
+			base64_decodeZ(base64data, decoded);
+			blob = decoded.data();
+			blobSize = decoded.size();
+		}
+		Keyframes::Curve curve;
+		if (haveKeys) {
+			if (!Keyframes::Decode(blob, blobSize, &curve)) {
+				obs_data_release(chand);
+				obs_data_release(channels);
+				PLOG_ERROR("Animation '%s' channel has invalid keys.", name.c_str());
+				throw std::logic_error("Animation channel has invalid keys.");
+			}
+		}
+		else {
+			std::vector<float> values(blobSize / sizeof(float));
+			memcpy(values.data(), blob, values.size() * sizeof(float));
+			Keyframes::FromSamples(values.data(), values.size(), 0.0f, &curve);
+		}
+		obs_data_release(chand);
+
+		// nothing to animate
+		if (!channel.item)
+			continue;
 
+		m_curves.Add(curve, (Keyframes::Extrapolation)channel.preState,
+			(Keyframes::Extrapolation)channel.postState);
 		m_channels.emplace_back(channel);
-		obs_data_release(chand);
 	}
 	obs_data_release(channels);
+	m_values.resize(m_channels.size());
 }
 
 Mask::Resource::Animation::~Animation() {}
@@ -186,8 +164,8 @@ void Mask::Resource::Animation::Update(Mask::Part* part, float time) {
 	m_parent->instanceDatas.Push(m_id);
 
 	// get our instance data
-	std::shared_ptr<AnimationInstanceData> instData =
-		m_parent->instanceDatas.GetData<AnimationInstanceData>();
+	AnimationInstanceData* instData =
+		m_parent->instanceDatas.GetData(m_instanceData);
 
 	// time has elapsed
 	instData->elapsed += time * m_speed;
@@ -208,13 +186,12 @@ void Mask::Resource::Animation::Update(Mask::Part* part, float time) {
 		}
 	}
 
-	// process animation channels
-	int frame = (int)(instData->elapsed * m_fps);
-	for (int i = 0; i < m_channels.size(); i++) {
+	// process animation channels, all curves at once
+	float frame = instData->elapsed * m_fps;
+	m_curves.Evaluate(frame, m_values.data());
+	for (size_t i = 0; i < m_channels.size(); i++) {
 		AnimationChannel& ch = m_channels[i];
-		if (ch.item != nullptr) {
-			ch.item->SetAnimatableValue(ch.GetValue(frame), ch.type);
-		}
+		ch.item->SetAnimatableValue(m_values[i], ch.type);
 	}
 
 	m_parent->instanceDatas.Pop();
@@ -229,8 +206,8 @@ void Mask::Resource::Animation::Seek(float t) {
 	m_parent->instanceDatas.Push(m_id);
 
 	// get our instance data
-	std::shared_ptr<AnimationInstanceData> instData =
-		m_parent->instanceDatas.GetData<AnimationInstanceData>();
+	AnimationInstanceData* instData =
+		m_parent->instanceDatas.GetData(m_instanceData);
 
 	// reset time
 	instData->elapsed = t;
@@ -242,8 +219,8 @@ float   Mask::Resource::Animation::GetPosition() {
 	m_parent->instanceDatas.Push(m_id);
 
 	// get our instance data
-	std::shared_ptr<AnimationInstanceData> instData =
-		m_parent->instanceDatas.GetData<AnimationInstanceData>();
+	AnimationInstanceData* instData =
+		m_parent->instanceDatas.GetData(m_instanceData);
 
 	m_parent->instanceDatas.Pop();
 
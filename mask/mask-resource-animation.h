@@ -19,6 +19,7 @@
 #pragma once
 #include "mask-resource.h"
 #include "mask-instance-data.h"
+#include "mask-keyframes.h"
 #include <vector>
 extern "C" {
 #pragma warning( push )
@@ -32,6 +33,7 @@ namespace Mask {
 
 	namespace Resource {
 
+		// same order as Keyframes::Extrapolation
 		enum AnimationBehaviour : uint32_t {
 			CONSTANT,
 			LINEAR,
@@ -94,14 +96,13 @@ namespace Mask {
 			void Reset() override {}
 		};
 
+		// the keys of a channel are curve <index> of the
+		// animation's curve set
 		struct AnimationChannel {
 			std::shared_ptr<IAnimatable>	item;
 			AnimationChannelType			type;
 			AnimationBehaviour				preState;
 			AnimationBehaviour				postState;
-			std::vector<float>				values;
-
-			float	GetValue(int frame);
 		};
 
 
@@ -138,13 +139,17 @@ namespace Mask {
 			const char* const S_PRESTATE = "pre-state";
 			const char* const S_POSTSTATE = "post-state";
 			const char* const S_VALUES = "values";
+			const char* const S_KEYS = "keys";
 
 		protected:
 			float							m_speed;
 			float							m_duration;
 			float							m_fps;
 			std::vector<AnimationChannel>	m_channels;
+			Keyframes::CurveSet				m_curves;
+			std::vector<float>				m_values;
 			bool							m_stopOnLastFrame;
+			InstanceHandle<AnimationInstanceData>	m_instanceData;
 
 			AnimationChannelType AnimationTypeFromString(const std::string& s);
 			AnimationBehaviour AnimationBehaviourFromString(const std::string& s);
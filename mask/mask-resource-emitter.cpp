@@ -185,9 +185,19 @@ Mask::Resource::Emitter::Emitter(Mask::MaskData* parent, std::string name, obs_d
 		m_inverseRate = obs_data_get_bool(data, S_INVERSE_RATE);
 	}
 
-	// Seed rand
-	time_t seconds_since_epoch = ::time(0);
-	srand((unsigned int)seconds_since_epoch);
+	// the model's material is set up once for a whole batch of
+	// particles, unless it has per particle state
+	m_batched = m_model->GetMaterial() && !m_model->GetMaterial()->HasSequences();
+
+	// per tick ranges for the particle store
+	m_forces.frictionMin = m_frictionMin;
+	m_forces.frictionMax = m_frictionMax;
+	m_forces.forceMin[0] = m_forceMin.x;
+	m_forces.forceMin[1] = m_forceMin.y;
+	m_forces.forceMin[2] = m_forceMin.z;
+	m_forces.forceMax[0] = m_forceMax.x;
+	m_forces.forceMax[1] = m_forceMax.y;
+	m_forces.forceMax[2] = m_forceMax.z;
 }
 
 Mask::Resource::Emitter::~Emitter() {
@@ -198,31 +208,32 @@ Mask::Resource::Type Mask::Resource::Emitter::GetType() {
 	return Mask::Resource::Type::Emitter;
 }
 
-float Mask::Resource::Emitter::RandFloat(float min, float max) {
-	float a = (float)rand() / (float)RAND_MAX;
-	return a * (max - min) + min; 
-}
-
-
 void Mask::Resource::Emitter::Update(Mask::Part* part, float time) {
 
 	m_parent->instanceDatas.Push(m_id);
 
 	// get our instance data
-	std::shared_ptr<EmitterInstanceData> instData =
-		m_parent->instanceDatas.GetData<EmitterInstanceData>();
+	EmitterInstanceData* instData =
+		m_parent->instanceDatas.GetData(m_instanceData);
 	instData->Init(m_numParticles, this);
+	ParticleStore& particles = instData->particles;
 
-	// update our model
-	Particle* p = instData->particles;
-	for (int i = 0; i < m_numParticles; i++, p++) {
-		if (p->state == Particle::State::ALIVE) {
-			m_parent->instanceDatas.Push(p->id);
+	// update our model, once per particle when they don't share it
+	if (m_batched) {
+		m_model->Update(part, time);
+	}
+	else {
+		const size_t* ids = particles.ids();
+		for (int i = 0; i < particles.NumAlive(); i++) {
+			m_parent->instanceDatas.Push(ids[i]);
 			m_model->Update(part, time);
 			m_parent->instanceDatas.Pop();
 		}
 	}
 
+	// Update particles
+	particles.Integrate(time, m_lifetime, m_forces, instData->random);
+
 	// use scale to control emission
 	bool zeroScale = false;
 	if (part->global.x.x < 0.000001f &&
@@ -231,7 +242,7 @@ void Mask::Resource::Emitter::Update(Mask::Part* part, float time) {
 		zeroScale = true;
 	}
 
-	// Emit particle?
+	// Emit particles?
 	if (!zeroScale)
 		instData->elapsed += time;
 	if (instData->delta_time < instData->elapsed && !zeroScale) {
@@ -239,65 +250,20 @@ void Mask::Resource::Emitter::Update(Mask::Part* part, float time) {
 		int numToEmit = 1;
 		if (instData->delta_time > 0.000001f)
 			numToEmit = (int)(instData->elapsed / instData->delta_time);
-		while (numToEmit-- > 0) {
-			// find dead particle
-			p = instData->particles;
-			int idx = 0;
-			for (idx = 0; idx < m_numParticles; idx++, p++) {
-				if (p->state == Particle::State::DEAD)
-					break;
-			}
-			if (idx < m_numParticles) {
-				// actually spawn a new particle
-				instData->elapsed = 0.0f;
-				p->elapsed = 0.0f;
-				p->state = Particle::State::SPAWNED;
-
-				// we will set up transform when rendering
-				vec3_zero(&p->position);
-				vec3_set(&p->velocity,
-					RandFloat(m_initialVelocityMin.x, m_initialVelocityMax.x) * time,
-					RandFloat(m_initialVelocityMin.y, m_initialVelocityMax.y) * time,
-					RandFloat(m_initialVelocityMin.z, m_initialVelocityMax.z) * time);
-			}
-		}
+
+		// we will set up transform when rendering
+		float vmin[3] = { m_initialVelocityMin.x, m_initialVelocityMin.y, m_initialVelocityMin.z };
+		float vmax[3] = { m_initialVelocityMax.x, m_initialVelocityMax.y, m_initialVelocityMax.z };
+		if (particles.Emit(numToEmit, vmin, vmax, time, instData->random) > 0)
+			instData->elapsed = 0.0f;
 
 		// random emit rate
 		if (m_inverseRate)
 			// seconds between particles
-			instData->delta_time = RandFloat(m_rateMin, m_rateMax);
+			instData->delta_time = instData->random.Float(m_rateMin, m_rateMax);
 		else
 			// particles / second
-			instData->delta_time = 1.0f / RandFloat(m_rateMin, m_rateMax);
-	}
-
-	// Update particles
-	p = instData->particles;
-	for (int i = 0; i < m_numParticles; i++, p++) {
-		if (p->state == Particle::State::ALIVE) {
-			p->elapsed += time;
-			if (p->elapsed > m_lifetime) {
-				// kill particle
-				p->state = Particle::State::DEAD;
-				continue;
-			}
-
-			// velocity
-			vec3 v;
-			vec3_mulf(&v, &p->velocity, time);
-			vec3_add(&p->position, &p->position, &v);
-			// friction
-			vec3_mulf(&p->velocity, &p->velocity, 
-				RandFloat(m_frictionMin, m_frictionMax));
-			// force
-			vec3 f;
-			vec3_set(&f,
-				RandFloat(m_forceMin.x, m_forceMax.x),
-				RandFloat(m_forceMin.y, m_forceMax.y),
-				RandFloat(m_forceMin.z, m_forceMax.z));
-			vec3_mulf(&f, &f, time);
-			vec3_add(&p->velocity, &p->velocity, &f);
-		}
+			instData->delta_time = 1.0f / instData->random.Float(m_rateMin, m_rateMax);
 	}
 
 	m_parent->instanceDatas.Pop();
@@ -312,37 +278,93 @@ void Mask::Resource::Emitter::Render(Mask::Part* part) {
 	gs_matrix_get(&global);
 
 	// get our instance data
-	std::shared_ptr<EmitterInstanceData> instData =
-		m_parent->instanceDatas.GetData<EmitterInstanceData>();
-	if (instData->particles == nullptr) {
+	EmitterInstanceData* instData =
+		m_parent->instanceDatas.GetData(m_instanceData);
+	if (instData->handles.empty()) {
+		m_parent->instanceDatas.Pop();
+		return;
+	}
+	ParticleStore& particles = instData->particles;
+
+	// first time spawned
+	if (m_worldSpace) {
+		float* px = particles.px();
+		float* py = particles.py();
+		float* pz = particles.pz();
+		float* vx = particles.vx();
+		float* vy = particles.vy();
+		float* vz = particles.vz();
+		for (int i = particles.NumAlive(); i < particles.Count(); i++) {
+			px[i] = global.t.x;
+			py[i] = global.t.y;
+			pz[i] = global.t.z;
+			vec3 v;
+			vec3_set(&v, vx[i], vy[i], vz[i]);
+			vec3_transform(&v, &v, &global);
+			vx[i] = v.x;
+			vy[i] = v.y;
+			vz[i] = v.z;
+		}
+	}
+	particles.MarkAlive();
+
+	if (m_batched) {
+		RenderBatch(part, global, *instData);
 		m_parent->instanceDatas.Pop();
 		return;
 	}
 
 	// add particles as sorted draw objects 
-	Particle* p = instData->particles;
-	for (int i = 0; i < m_numParticles; i++, p++) {
-		if (p->state != Particle::State::DEAD) {
-			// first time spawned
-			if (p->state == Particle::State::SPAWNED) {
-				if (m_worldSpace) {
-					p->position.x = global.t.x;
-					p->position.y = global.t.y;
-					p->position.z = global.t.z;
-					vec3_transform(&(p->velocity), &(p->velocity), &global);
-				}
-				p->state = Particle::State::ALIVE;
-			}
-			p->sortDrawPart = part;
-			m_parent->instanceDatas.Push(p->id);
-			m_parent->AddSortedDrawObject(p);
-			m_parent->instanceDatas.Pop();
-		}
+	const size_t* ids = particles.ids();
+	for (int i = 0; i < particles.Count(); i++) {
+		Particle* p = &instData->handles[i];
+		p->sortDrawPart = part;
+		m_parent->instanceDatas.Push(ids[i]);
+		m_parent->AddSortedDrawObject(p);
+		m_parent->instanceDatas.Pop();
 	}
 
 	m_parent->instanceDatas.Pop();
 }
 
+void Mask::Resource::Emitter::RenderBatch(Mask::Part* part, const matrix4& global,
+	EmitterInstanceData& instData) {
+	// same transform Particle::SortedRender builds on the gs stack
+	matrix4 rot;
+	matrix4_identity(&rot);
+	matrix4_rotate_aa4f(&rot, &rot, 0.0f, 0.0f, 1.0f, M_PI);
+	matrix4_rotate_aa4f(&rot, &rot, 1.0f, 0.0f, 0.0f, M_PI);
+
+	vec3 offset;
+	vec3_zero(&offset);
+	if (!m_worldSpace)
+		vec3_set(&offset, global.t.x, global.t.y, global.t.z);
+
+	ParticleStore& particles = instData.particles;
+	const float* px = particles.px();
+	const float* py = particles.py();
+	const float* pz = particles.pz();
+	const float* elapsed = particles.elapsed();
+
+	instData.batch.sortDrawPart = part;
+	matrix4 world;
+	for (int i = 0; i < particles.Count(); i++) {
+		float lambda = elapsed[i] / m_lifetime;
+		float s = lambda * (m_scaleEnd - m_scaleStart) + m_scaleStart;
+		float alpha = lambda * (m_alphaEnd - m_alphaStart) + m_alphaStart;
+
+		matrix4_identity(&world);
+		matrix4_scale3f(&world, &world, s, s, s);
+		matrix4_mul(&world, &world, &rot);
+		matrix4_translate3f(&world, &world,
+			px[i] + offset.x, py[i] + offset.y, pz[i] + offset.z);
+
+		uint32_t instance = m_parent->AddDrawInstance(&world, alpha);
+		m_parent->AddSortedDrawInstance(&instData.batch,
+			pz[i] + offset.z + m_zSortOffset, instance);
+	}
+}
+
 bool Mask::Resource::Emitter::IsDepthOnly() {
 	return false;
 }
@@ -354,7 +376,7 @@ bool Mask::Resource::Emitter::IsOpaque() {
 
 
 float Mask::Resource::Particle::SortDepth() {
-	float z = position.z;
+	float z = store->pz()[index];
 	if (!emitter->m_worldSpace) {
 		matrix4 m;
 		gs_matrix_get(&m);
@@ -369,7 +391,7 @@ float Mask::Resource::Particle::SortDepth() {
 void Mask::Resource::Particle::SortedRender() {
 
 	// global alpha
-	std::shared_ptr<AlphaInstanceData> aid =
+	AlphaInstanceData* aid =
 		emitter->GetParent()->instanceDatas.GetData<AlphaInstanceData>
 		(AlphaInstanceDataId);
 
@@ -381,14 +403,14 @@ void Mask::Resource::Particle::SortedRender() {
 	gs_matrix_push();
 	gs_matrix_identity();
 
-	gs_matrix_translate(&position);
+	gs_matrix_translate3f(store->px()[index], store->py()[index], store->pz()[index]);
 	if (!emitter->m_worldSpace) {
 		gs_matrix_translate3f(m.t.x, m.t.y, m.t.z);
 	}
 	gs_matrix_rotaa4f(1.0f, 0.0f, 0.0f, M_PI);
 	gs_matrix_rotaa4f(0.0f, 0.0f, 1.0f, M_PI);
 
-	float lambda = elapsed / emitter->m_lifetime;
+	float lambda = store->elapsed()[index] / emitter->m_lifetime;
 	float s = lambda * (emitter->m_scaleEnd - emitter->m_scaleStart) + emitter->m_scaleStart;
 	gs_matrix_scale3f(s, s, s);
 	aid->alpha = lambda * (emitter->m_alphaEnd - emitter->m_alphaStart) + emitter->m_alphaStart;
@@ -399,3 +421,9 @@ void Mask::Resource::Particle::SortedRender() {
 	gs_matrix_pop();
 	aid->alpha = saved_alpha;
 }
+
+void Mask::Resource::ParticleBatch::SortedRender() {
+	// the mesh draws every particle instance, with its own
+	// transform and alpha
+	emitter->m_model->DirectRender(sortDrawPart);
+}
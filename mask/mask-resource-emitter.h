@@ -19,6 +19,7 @@
 #pragma once
 #include "mask-resource.h"
 #include "mask-resource-model.h"
+#include "mask-particles.h"
 extern "C" {
 	#pragma warning( push )
 	#pragma warning( disable: 4201 )
@@ -26,74 +27,68 @@ extern "C" {
 	#include <libobs/obs-module.h>
 	#pragma warning( pop )
 }
-#include <time.h>
+#include <vector>
 
 namespace Mask {
 	namespace Resource {
 
 		class Emitter;
 
+		// Particle : sorted draw handle for one particle slot
+		// - the particle itself lives in the emitter's ParticleStore
 		class Particle : public SortedDrawObject {
 		public:
-			enum State : uint8_t {
-				DEAD,
-				SPAWNED,
-				ALIVE,
-				NUM_STATES
-			};
-
-			std::size_t		id;
-			vec3			position;
-			vec3			velocity;
 			Emitter*		emitter;
-			float			elapsed;
-			State			state;
+			ParticleStore*	store;
+			int				index;
 
-			Particle* next;
-
-			Particle() : state(DEAD), emitter(nullptr) {}
+			Particle() : emitter(nullptr), store(nullptr), index(0) {}
 
 			virtual float	SortDepth() override;
 			virtual void	SortedRender() override;
 		};
 
+		// ParticleBatch : sorted draw object for all particles of an
+		// emitter instance, each particle is one draw instance
+		class ParticleBatch : public SortedDrawObject {
+		public:
+			Emitter*	emitter;
+
+			ParticleBatch() : emitter(nullptr) {}
+
+			// depth is given per particle
+			virtual float	SortDepth() override { return 0.0f; }
+			virtual void	SortedRender() override;
+		};
+
 		struct EmitterInstanceData : public InstanceData {
-			Particle*	particles;
-			int			numParticles;
+			ParticleStore			particles;
+			ParticleRandom			random;
+			std::vector<Particle>	handles;
+			ParticleBatch			batch;
 			float		elapsed;
 			float		delta_time;
 
-			EmitterInstanceData() : particles(nullptr), 
-				numParticles(0), elapsed(0.0f), delta_time(0.0f) {}
+			EmitterInstanceData() : elapsed(0.0f), delta_time(0.0f) {}
 
 			inline void Init(int num_particles, Emitter* e) {
-				numParticles = num_particles;
 				// only init once
-				if (particles != nullptr)
+				if (!handles.empty() || num_particles <= 0)
 					return;
-				particles = new Particle[numParticles];
-				Particle* p = particles;
-				std::hash<int> hasher;
-				for (int i = 0; i < numParticles; i++,p++) {
-					p->id = hasher(i);
-					p->emitter = e;
+				particles.Init(num_particles);
+				random.Seed((uint32_t)os_gettime_ns() ^ (uint32_t)(uintptr_t)this);
+				batch.emitter = e;
+				handles.resize(num_particles);
+				for (int i = 0; i < num_particles; i++) {
+					handles[i].emitter = e;
+					handles[i].store = &particles;
+					handles[i].index = i;
 				}
 			}
 
 			void Reset() override {
 				elapsed = 0.0f;
-				if (particles == nullptr)
-					return;
-				Particle* p = particles;
-				for (int i = 0; i < numParticles; i++, p++) {
-					p->state = Particle::DEAD;
-				}
-			}
-
-			~EmitterInstanceData() {
-				if (particles) {
-					delete[] particles;
-				}
+				particles.Reset();
 			}
 		};
 
@@ -134,8 +129,9 @@ namespace Mask {
 			const char* const S_Z_SORT_OFFSET = "z-sort-offset";
 
 		protected:
-			// allow Particle class to access protected vars
+			// allow Particle classes to access protected vars
 			friend class Particle;
+			friend class ParticleBatch;
 
 			float		m_rateMin, m_rateMax;
 			float		m_lifetime;
@@ -148,9 +144,14 @@ namespace Mask {
 			float		m_zSortOffset;
 			bool		m_worldSpace;
 			bool		m_inverseRate;
+			// particles drawn as instances of one batch
+			bool		m_batched;
+			ParticleForces	m_forces;
 			std::shared_ptr<Model> m_model;
+			InstanceHandle<EmitterInstanceData>	m_instanceData;
 
-			static	float RandFloat(float min, float max);
+			void RenderBatch(Mask::Part* part, const matrix4& global,
+				EmitterInstanceData& instData);
 		};
 	}
 }
@@ -17,15 +17,27 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
  */
 
+#define NOMINMAX
 #include "mask-resource-image.h"
 #include "plugin/exceptions.h"
 #include "plugin/plugin.h"
 #include "plugin/utils.h"
+#include "mask.h"
+#include <algorithm>
+
+#pragma warning( push )
+#pragma warning( disable: 4127 )
+#pragma warning( disable: 4201 )
+#pragma warning( disable: 4244 )
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#pragma warning( pop )
 
 static const unsigned int MAX_MIP_LEVELS = 32;
 
-Mask::Resource::Image::Image(Mask::MaskData* parent, std::string name, obs_data_t* data, Cache *cache)
-	: IBase(parent, name), m_width(0), m_height(0), m_fmt(GS_RGBA), m_mipLevels(-1), m_is_cubemap(false), m_cache(cache) {
+Mask::Resource::Image::Image(Mask::MaskData* parent, std::string name, obs_data_t* data, Cache *cache, bool createGS)
+	: IBase(parent, name), m_width(0), m_height(0), m_fmt(GS_RGBA), m_mipLevels(-1), m_is_cubemap(false), m_cache(cache),
+	m_compressed(false), m_compression(BlockCompression::BC1), m_contentHash(0) {
 
 	char mipdat[128];
 	snprintf(mipdat, sizeof(mipdat), S_MIP_DATA, 0);
@@ -43,6 +55,16 @@ Mask::Resource::Image::Image(Mask::MaskData* parent, std::string name, obs_data_
 		// else ch_fmt_str == "int8" -> default = GS_RGBA
 	}
 
+	if (obs_data_has_user_value(data, S_COMPRESSION)) {
+		const char* comp = obs_data_get_string(data, S_COMPRESSION);
+		if (!BlockCompression::ParseFormat(comp, &m_compression)) {
+			PLOG_ERROR("Image '%s' has unsupported compression '%s'.", name.c_str(), comp);
+			throw std::logic_error("Image has unsupported compression.");
+		}
+		m_compressed = true;
+		m_fmt = (m_compression == BlockCompression::BC1) ? GS_DXT1 : GS_DXT5;
+	}
+
 	// Could be PNG data or raw texture data. See which.
 
 	// PNG DATA?
@@ -53,8 +75,18 @@ Mask::Resource::Image::Image(Mask::MaskData* parent, std::string name, obs_data_
 			throw std::logic_error("Image has empty data.");
 		}
 
-		// save for later
-		m_tempFile = Utils::Base64ToTempFile(base64data);
+		// decode in memory, no temp file
+		const uint8_t* blob;
+		size_t blobSize;
+		std::vector<uint8_t> decoded;
+		if (!parent || !parent->GetBlob(base64data, &blob, &blobSize)) {
+			base64_decodeZ(base64data, decoded);
+			blob = decoded.data();
+			blobSize = decoded.size();
+		}
+		m_contentHash = Utils::hash64(blob, blobSize);
+		if (!LoadCachedTexture())
+			DecodeImageData(blob, blobSize);
 	}
 
 	// RAW DATA?
@@ -84,7 +116,7 @@ Mask::Resource::Image::Image(Mask::MaskData* parent, std::string name, obs_data_
 		m_mipLevels = (int)obs_data_get_int(data, S_MIP_LEVELS);
 
 		// check format
-		if (bpp == 1) {
+		if (bpp == 1 && !m_compressed) {
 			m_fmt = GS_R8;
 		}
 		else if (bpp != 4) {
@@ -96,9 +128,6 @@ Mask::Resource::Image::Image(Mask::MaskData* parent, std::string name, obs_data_
 		if (m_mipLevels > MAX_MIP_LEVELS)
 			m_mipLevels = MAX_MIP_LEVELS;
 
-		int w = m_width;
-		int h = m_height;
-
 		for (int i = 0; i < m_mipLevels; i++) {
 			snprintf(mipdat, sizeof(mipdat), S_MIP_DATA, i);
 			const char* base64data = obs_data_get_string(data, mipdat);
@@ -106,19 +135,15 @@ Mask::Resource::Image::Image(Mask::MaskData* parent, std::string name, obs_data_
 				PLOG_ERROR("Image '%s' has empty data.", name.c_str());
 				throw std::logic_error("Image has empty data.");
 			}
-			std::vector<uint8_t> decoded;
-			base64_decodeZ(base64data, decoded);
-			m_decoded_mips.emplace_back(decoded);
-			if (decoded.size() != (w * h * bpp)) {
-				size_t ds = decoded.size();
-
+			size_t ds = LoadMip(base64data);
+			size_t expected = MipSize(i, bpp, sizeof(uint8_t));
+			if (ds != expected) {
 				PLOG_ERROR("Image '%s' size doesnt add up. Should be %d but is %d bytes",
-					name.c_str(), (w*h*bpp), ds);
+					name.c_str(), (int)expected, (int)ds);
 				throw std::logic_error("Image size doesnt add up.");
 			}
-			w /= 2;
-			h /= 2;
 		}
+		LoadCachedTexture();
 	}
 	else if (obs_data_has_user_value(data, side_mipdat)) {
 		m_is_cubemap = true;
@@ -147,7 +172,7 @@ Mask::Resource::Image::Image(Mask::MaskData* parent, std::string name, obs_data_
 		m_mipLevels = (int)obs_data_get_int(data, S_MIP_LEVELS);
 
 		// check format
-		if (bpp == 1) {
+		if (bpp == 1 && !m_compressed) {
 			m_fmt = GS_R8;
 		}
 		else if (bpp != 4) {
@@ -159,9 +184,8 @@ Mask::Resource::Image::Image(Mask::MaskData* parent, std::string name, obs_data_
 		if (m_mipLevels > MAX_MIP_LEVELS)
 			m_mipLevels = MAX_MIP_LEVELS;
 
-		int w, h;
 		size_t fmt_size;
-		if (m_fmt == GS_RGBA)
+		if (m_fmt == GS_RGBA || m_compressed)
 			fmt_size = sizeof(uint8_t);
 		else if (m_fmt == GS_RGBA32F)
 			fmt_size = sizeof(float);
@@ -174,8 +198,6 @@ Mask::Resource::Image::Image(Mask::MaskData* parent, std::string name, obs_data_
 
 		for (size_t side = 0; side < 6; side++)
 		{
-			w = m_width;
-			h = m_height;
 			for (int i = 0; i < m_mipLevels; i++) {
 				snprintf(side_mipdat, sizeof(side_mipdat), S_SIDE_MIP_DATA, side, i);
 				const char* base64data = obs_data_get_string(data, side_mipdat);
@@ -183,20 +205,16 @@ Mask::Resource::Image::Image(Mask::MaskData* parent, std::string name, obs_data_
 					PLOG_ERROR("Image '%s' has empty data.", name.c_str());
 					throw std::logic_error("Image has empty data.");
 				}
-				std::vector<uint8_t> decoded;
-				base64_decodeZ(base64data, decoded);
-				m_decoded_mips.emplace_back(decoded);
-				if (decoded.size() != (w * h * bpp * fmt_size)) {
-					size_t ds = decoded.size();
-
+				size_t ds = LoadMip(base64data);
+				size_t expected = MipSize(i, bpp, fmt_size);
+				if (ds != expected) {
 					PLOG_ERROR("Image '%s' size doesnt add up. Should be %d but is %d bytes",
-						name.c_str(), (w*h*bpp), ds);
+						name.c_str(), (int)expected, (int)ds);
 					throw std::logic_error("Image size doesnt add up.");
 				}
-				w /= 2;
-				h /= 2;
 			}
 		}
+		LoadCachedTexture();
 	}
 	else {
 		PLOG_ERROR("Image '%s' has no data.", name.c_str());
@@ -204,42 +222,172 @@ Mask::Resource::Image::Image(Mask::MaskData* parent, std::string name, obs_data_
 	}
 
 
-	// temp file?
-	if (m_tempFile.length() > 0) {
-		m_Texture = std::make_shared<GS::Texture>(m_tempFile, m_cache);
-		Utils::DeleteTempFile(m_tempFile);
-		m_tempFile.clear();
+	if (createGS)
+		CreateGS();
+}
+
+void Mask::Resource::Image::CreateGS() {
+	if (m_Texture || m_mipData.empty())
+		return;
+
+	try {
+		CreateTexture();
+	}
+	catch (const std::runtime_error&) {
+		if (!m_compressed)
+			throw;
+		// no block compression support, upload it uncompressed
+		PLOG_WARNING("Image '%s' could not be created compressed, decompressing.", m_name.c_str());
+		DecompressMips();
+		CreateTexture();
+	}
+	m_mipData.clear();
+	m_decoded_mips.clear();
+}
+
+void Mask::Resource::Image::CreateTexture() {
+	// cached by content, so identical images in other masks share it
+	if (m_is_cubemap) {
+		m_Texture = std::make_shared<GS::Texture>(m_contentKey, m_width, m_fmt, m_mipLevels, m_mipData.data(), 0, m_cache);
 	}
 	else {
-		if (m_is_cubemap) {
-			const uint8_t* sides_mips[MAX_MIP_LEVELS * 6];
-			for (size_t side = 0; side < 6; side++)
-			{
-				for (int i = 0; i < m_mipLevels; i++) {
-					sides_mips[side * m_mipLevels + i] = m_decoded_mips[side * m_mipLevels + i].data();
-				}
-			}
-			m_Texture = std::make_shared<GS::Texture>(m_name, m_width, m_fmt, m_mipLevels, sides_mips, 0, m_cache);
-			m_decoded_mips.clear();
-		}
-		else {
-			const uint8_t* mips[MAX_MIP_LEVELS];
-			for (int i = 0; i < m_mipLevels; i++) {
-				mips[i] = m_decoded_mips[i].data();
-			}
-			m_Texture = std::make_shared<GS::Texture>(m_width, m_height, m_fmt, m_mipLevels, mips, 0, m_cache);
-			m_decoded_mips.clear();
-		}
+		m_Texture = std::make_shared<GS::Texture>(m_contentKey, m_width, m_height, m_fmt, m_mipLevels, m_mipData.data(), 0, m_cache);
 	}
 }
 
+size_t Mask::Resource::Image::MipSize(int level, int bpp, size_t fmt_size) {
+	int w = m_width >> level;
+	int h = m_height >> level;
+	if (m_compressed)
+		return BlockCompression::ImageSize(m_compression, w, h);
+	return (size_t)w * h * bpp * fmt_size;
+}
+
+void Mask::Resource::Image::DecompressMips() {
+	// cubemap mips are stored side by side
+	std::vector<std::vector<uint8_t>> decoded;
+	std::vector<const uint8_t*> mips;
+	for (size_t i = 0; i < m_mipData.size(); i++) {
+		int level = (int)(i % m_mipLevels);
+		int w = std::max(m_width >> level, 1);
+		int h = std::max(m_height >> level, 1);
+		decoded.emplace_back((size_t)w * h * 4);
+		BlockCompression::Decompress(m_compression, m_mipData[i], w, h, decoded.back().data());
+		mips.push_back(decoded.back().data());
+	}
+	m_decoded_mips.swap(decoded);
+	m_mipData.swap(mips);
+	m_fmt = GS_RGBA;
+	m_compressed = false;
+}
+
+size_t Mask::Resource::Image::GetMemorySize() {
+	size_t bytes = 0;
+	for (auto& mip : m_decoded_mips)
+		bytes += mip.size();
+	if (!m_Texture || m_width <= 0 || m_height <= 0)
+		return bytes;
+
+	size_t w = (size_t)m_width;
+	size_t h = (size_t)m_height;
+	size_t bpp = gs_get_format_bpp(m_fmt);
+	for (int i = 0; i < std::max(m_mipLevels, 1); i++) {
+		bytes += w * h * bpp / 8 * (m_is_cubemap ? 6 : 1);
+		w = std::max<size_t>(w / 2, 1);
+		h = std::max<size_t>(h / 2, 1);
+	}
+	return bytes;
+}
+
+void Mask::Resource::Image::DecodeImageData(const uint8_t* data, size_t size) {
+	cv::Mat img = cv::imdecode(cv::Mat(1, (int)size, CV_8UC1, (void*)data),
+		cv::IMREAD_UNCHANGED);
+	if (img.empty()) {
+		PLOG_ERROR("Image '%s' data could not be decoded.", m_name.c_str());
+		throw std::logic_error("Image data could not be decoded.");
+	}
+
+	// 8 bit BGRA, same as loading the file through libobs
+	if (img.depth() == CV_16U)
+		img.convertTo(img, CV_8U, 1.0 / 257.0);
+	else if (img.depth() != CV_8U)
+		img.convertTo(img, CV_8U, 255.0);
+	if (img.channels() == 1)
+		cv::cvtColor(img, img, cv::COLOR_GRAY2BGRA);
+	else if (img.channels() == 3)
+		cv::cvtColor(img, img, cv::COLOR_BGR2BGRA);
+	if (!img.isContinuous())
+		img = img.clone();
+
+	m_width = img.cols;
+	m_height = img.rows;
+	m_fmt = GS_BGRA;
+	m_mipLevels = 1;
+	m_decoded_mips.emplace_back(img.data, img.data + img.total() * img.elemSize());
+	m_mipData.push_back(m_decoded_mips.back().data());
+}
+
+size_t Mask::Resource::Image::LoadMip(const char* value) {
+	// compiled masks hand us the raw mip straight from the mapped file
+	const uint8_t* blob;
+	size_t blobSize;
+	if (m_parent && m_parent->GetBlob(value, &blob, &blobSize)) {
+		m_contentHash = Utils::hash64(blob, blobSize, m_contentHash);
+		m_mipData.push_back(blob);
+		return blobSize;
+	}
+
+	// moving the vector keeps its buffer, so data() stays valid
+	std::vector<uint8_t> decoded;
+	base64_decodeZ(value, decoded);
+	m_contentHash = Utils::hash64(decoded.data(), decoded.size(), m_contentHash);
+	m_decoded_mips.emplace_back(std::move(decoded));
+	m_mipData.push_back(m_decoded_mips.back().data());
+	return m_decoded_mips.back().size();
+}
+
+bool Mask::Resource::Image::LoadCachedTexture() {
+	// the same bytes are a different texture in another shape or format
+	int64_t shape[] = { m_width, m_height, (int64_t)m_fmt, m_mipLevels,
+		m_is_cubemap ? 1 : 0, m_compressed ? (int64_t)m_compression : -1 };
+	uint64_t hash = Utils::hash64(shape, sizeof(shape), m_contentHash);
+	m_contentKey = std::string(m_is_cubemap ? "cube:" : "image:") +
+		Utils::hash64ToString(hash);
+	if (!m_cache)
+		return false;
+
+	gs_texture_t* tex = nullptr;
+	m_cache->load(CacheableType::Texture, m_contentKey, (void**)&tex);
+	if (!tex)
+		return false;
+
+	// same pixels already on the gpu, no need to upload again
+	m_Texture = std::make_shared<GS::Texture>(m_contentKey, tex, m_cache);
+	m_mipData.clear();
+	m_decoded_mips.clear();
+	return true;
+}
+
 Mask::Resource::Image::Image(Mask::MaskData* parent, std::string name, std::string filename, Cache *cache)
-	: IBase(parent, name), m_cache(cache) {
+	: IBase(parent, name), m_cache(cache), m_is_cubemap(false), m_width(0), m_height(0),
+	m_mipLevels(0), m_fmt(GS_RGBA), m_compressed(false), m_compression(BlockCompression::BC1),
+	m_contentHash(0) {
 
 	m_Texture = std::make_shared<GS::Texture>(filename, m_cache);
 }
 
 
+Mask::Resource::Image::Image(Mask::MaskData* parent, std::string name, Cache *cache)
+	: IBase(parent, name), m_cache(cache), m_is_cubemap(true), m_width(0), m_height(0),
+	m_mipLevels(0), m_fmt(GS_RGBA), m_compressed(false), m_compression(BlockCompression::BC1),
+	m_contentHash(0), m_pendingDefault(name) {
+
+	gs_texture_t* tex = nullptr;
+	m_cache->load_permanent("empty_cubemap", (void**)&tex);
+	if (tex)
+		m_Texture = std::make_shared<GS::Texture>(tex, false);
+}
+
 Mask::Resource::Image::~Image() {}
 
 Mask::Resource::Type Mask::Resource::Image::GetType() {
@@ -253,34 +401,19 @@ void Mask::Resource::Image::Update(Mask::Part* part, float time) {
 
 void Mask::Resource::Image::Render(Mask::Part* part) {
 	UNUSED_PARAMETER(part);
-	if (m_Texture == nullptr) {
-
-		// temp file?
-		if (m_tempFile.length() > 0) {
-			m_Texture = std::make_shared<GS::Texture>(m_tempFile, m_cache);
-			Utils::DeleteTempFile(m_tempFile);
-			m_tempFile.clear();
+	if (!m_pendingDefault.empty()) {
+		std::shared_ptr<IBase> res;
+		if (!m_cache->load_default(m_pendingDefault, res)) {
+			// failed to load, stay empty
+			m_pendingDefault.clear();
 		}
-		else {
-			if (m_is_cubemap) {
-				const uint8_t* sides_mips[MAX_MIP_LEVELS*6];
-				for (size_t side = 0; side < 6; side++)
-				{
-					for (int i = 0; i < m_mipLevels; i++) {
-						sides_mips[side * m_mipLevels + i] = m_decoded_mips[side * m_mipLevels + i].data();
-					}
-				}
-				m_Texture = std::make_shared<GS::Texture>(m_name, m_width, m_fmt, m_mipLevels, sides_mips, 0, m_cache);
-				m_decoded_mips.clear();
-			}
-			else {
-				const uint8_t* mips[MAX_MIP_LEVELS];
-				for (int i = 0; i < m_mipLevels; i++) {
-					mips[i] = m_decoded_mips[i].data();
-				}
-				m_Texture = std::make_shared<GS::Texture>(m_width, m_height, m_fmt, m_mipLevels, mips, 0, m_cache);
-				m_decoded_mips.clear();
-			}
+		else if (res) {
+			std::shared_ptr<Image> img = std::dynamic_pointer_cast<Image>(res);
+			if (img && img->GetTexture())
+				m_Texture = img->GetTexture();
+			m_pendingDefault.clear();
 		}
 	}
+	if (m_Texture == nullptr)
+		CreateGS();
 }
@@ -19,6 +19,7 @@
 
 #pragma once
 #include "mask-resource.h"
+#include "mask-block-compression.h"
 #include "gs/gs-texture.h"
 #include "mask.h"
 #include "mask-resource.h"
@@ -40,14 +41,19 @@ namespace Mask {
 	namespace Resource {
 		class Image : public IBase {
 		public:
-			Image(Mask::MaskData* parent, std::string name, obs_data_t* data, Cache *cache);
+			Image(Mask::MaskData* parent, std::string name, obs_data_t* data, Cache *cache, bool createGS = true);
 			Image(Mask::MaskData* parent, std::string name, std::string filename, Cache *cache);
+			// stand-in for a default environment map that is still loading,
+			// renders with an empty cubemap until the real one is there
+			Image(Mask::MaskData* parent, std::string name, Cache *cache);
 			virtual ~Image();
 
 			virtual Type GetType() override;
 			virtual std::shared_ptr<GS::Texture> GetTexture() { return m_Texture; }
 			virtual void Update(Mask::Part* part, float time) override;
 			virtual void Render(Mask::Part* part) override;
+			virtual void CreateGS() override;
+			virtual size_t GetMemorySize() override;
 
 			void SwapTexture(gs_texture* tex, bool mineToDestroy = false) {
 				m_Texture = std::make_shared<GS::Texture>(tex, mineToDestroy);
@@ -62,6 +68,7 @@ namespace Mask {
 			const char* const S_SIDE_MIP_DATA = "side-%d-mip-data-%d";
 			const char* const S_BPP = "bpp";
 			const char* const S_CHANNEL_FORMAT = "channel-format";
+			const char* const S_COMPRESSION = "compression";
 			
 
 		protected:
@@ -73,8 +80,30 @@ namespace Mask {
 			int				m_width, m_height;
 			int				m_mipLevels;
 			gs_color_format m_fmt;
-			std::string		m_tempFile;
+			// mips are BC1/BC3 blocks (m_fmt is GS_DXT1/GS_DXT5)
+			bool			m_compressed;
+			BlockCompression::Format m_compression;
 			std::vector<std::vector<uint8_t>> m_decoded_mips;
+			std::vector<const uint8_t*> m_mipData;
+
+			// identical images share one texture through the cache
+			uint64_t		m_contentHash;
+			std::string		m_contentKey;
+
+			// name of the default image this one stands in for
+			std::string		m_pendingDefault;
+
+			// decode (or map) one mip level, returns its size in bytes
+			size_t LoadMip(const char* value);
+			// decode PNG (or any imdecode format) bytes into one mip level
+			void DecodeImageData(const uint8_t* data, size_t size);
+			// use the cached texture for m_contentHash, if there is one
+			bool LoadCachedTexture();
+			// bytes of one mip level
+			size_t MipSize(int level, int bpp, size_t fmt_size);
+			// decompress block compressed mips, for gpus that can't take them
+			void DecompressMips();
+			void CreateTexture();
 		};
 	}
 }
@@ -89,6 +89,7 @@ namespace Mask {
 
 		protected:
 			LightInstanceData m_idat;
+			InstanceHandle<LightInstanceData> m_instanceData;
 
 			LightType GetLightType(obs_data_t* data);
 		};
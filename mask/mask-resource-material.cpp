@@ -55,6 +55,7 @@ static const char* const PARAM_WORLD = "World";
 static const char* const PARAM_TEXMAT = "TexMat";
 static const char* const PARAM_ALPHA = "alpha";
 static const char* const PARAM_NUMBONES = "numBones";
+static const char* const PARAM_BONES = "bones";
 static const char* const PARAM_NUMLIGHTS = "numLights";
 
 static const char* const PARAM_NUM_RENDER_LAYERS = "numRenderLayers";
@@ -64,7 +65,8 @@ static const char* const PARAM_RENDER_LAYER = "renderLayer";
 
 Mask::Resource::Material::Material(Mask::MaskData* parent, std::string name, obs_data_t* data)
 	: IBase(parent, name), m_effect(nullptr), m_looping(false), m_currentTechnique(nullptr),
-	m_samplerState(nullptr), m_depthOnly(false), m_static(false), m_opaque(true), m_alphaWrite(true), m_rotationDisable(false) {
+	m_samplerState(nullptr), m_depthOnly(false), m_static(false), m_opaque(true), m_alphaWrite(true), m_rotationDisable(false),
+	m_loopAlpha(1.0f) {
 
 	std::hash<std::string> hasher;
 	char temp[64];
@@ -357,7 +359,7 @@ Mask::Resource::Type Mask::Resource::Material::GetType() {
 void Mask::Resource::Material::Update(Mask::Part* part, float time) {
 	// update our image params
 	m_parent->instanceDatas.Push(m_id);
-	for (auto kv : m_imageParameters) {
+	for (const auto& kv : m_imageParameters) {
 		kv.second->Update(part, time);
 	}
 	m_parent->instanceDatas.Pop();
@@ -375,60 +377,47 @@ bool Mask::Resource::Material::Loop(Mask::Part* part, BonesList* bones) {
 
 		m_effect->Render(part);
 
+		// get the effect object, and (re)bind its parameters
+		gs_effect_t* eff = m_effect->GetEffect()->GetObject();
+		if (m_bindings.effect != eff)
+			Bind(eff);
+
 		// Apply Parameters
-		for (auto kv : m_parameters) {
-			try {
-				auto el = m_effect->GetEffect()->GetParameterByName(kv.first);
-
-				switch (kv.second.type) {
-				case GS::EffectParameter::Type::Float:
-					el.SetFloat(kv.second.floatValue);
-					break;
-				case GS::EffectParameter::Type::Float2:
-					el.SetFloat2(kv.second.floatArray[0],
-						kv.second.floatArray[1]);
-					break;
-				case GS::EffectParameter::Type::Float3:
-					el.SetFloat3(kv.second.floatArray[0],
-						kv.second.floatArray[1],
-						kv.second.floatArray[2]);
-					break;
-				case GS::EffectParameter::Type::Float4:
-					el.SetFloat4(kv.second.floatArray[0],
-						kv.second.floatArray[1], 
-						kv.second.floatArray[2], 
-						kv.second.floatArray[3]);
-					break;
-				case GS::EffectParameter::Type::Integer:
-					el.SetInteger(kv.second.intValue);
-					break;
-				case GS::EffectParameter::Type::Integer2:
-					el.SetInteger2(kv.second.intArray[0],
-						kv.second.intArray[1]);
-					break;
-				case GS::EffectParameter::Type::Integer3:
-					el.SetInteger3(kv.second.intArray[0],
-						kv.second.intArray[1], 
-						kv.second.intArray[2]);
-					break;
-				case GS::EffectParameter::Type::Integer4:
-					el.SetInteger4(kv.second.intArray[0],
-						kv.second.intArray[1],
-						kv.second.intArray[2],
-						kv.second.intArray[3]);
-					break;
-				case GS::EffectParameter::Type::Matrix:
-					el.SetMatrix(kv.second.matrix);
-					break;
-				}
-			}
-			catch (...) {
+		for (const ValueBinding& vb : m_bindings.values) {
+			const Parameter& v = *vb.value;
+			switch (v.type) {
+			case GS::EffectParameter::Type::Float:
+				gs_effect_set_float(vb.param, v.floatValue);
+				break;
+			case GS::EffectParameter::Type::Float2:
+				gs_effect_set_val(vb.param, v.floatArray, sizeof(float_t) * 2);
+				break;
+			case GS::EffectParameter::Type::Float3:
+				gs_effect_set_val(vb.param, v.floatArray, sizeof(float_t) * 3);
+				break;
+			case GS::EffectParameter::Type::Float4:
+				gs_effect_set_val(vb.param, v.floatArray, sizeof(float_t) * 4);
+				break;
+			case GS::EffectParameter::Type::Integer:
+				gs_effect_set_int(vb.param, v.intValue);
+				break;
+			case GS::EffectParameter::Type::Integer2:
+				gs_effect_set_val(vb.param, v.intArray, sizeof(int32_t) * 2);
+				break;
+			case GS::EffectParameter::Type::Integer3:
+				gs_effect_set_val(vb.param, v.intArray, sizeof(int32_t) * 3);
+				break;
+			case GS::EffectParameter::Type::Integer4:
+				gs_effect_set_val(vb.param, v.intArray, sizeof(int32_t) * 4);
+				break;
+			case GS::EffectParameter::Type::Matrix:
+				gs_effect_set_matrix4(vb.param, &v.matrix);
+				break;
+			default:
+				break;
 			}
 		}
 
-		// get the effect object
-		gs_effect_t* eff = m_effect->GetEffect()->GetObject();
-
 		// Set up the sampler state
 		// TODO: move this to gs::effectparameter?
 		if (!m_samplerState) {
@@ -448,91 +437,59 @@ bool Mask::Resource::Material::Loop(Mask::Part* part, BonesList* bones) {
 		gs_set_cull_mode(m_culling);
 
 		// set up image params (image/sequence)
-		bool texmatset = false;
 		bool is_instance_visible = true;
-		for (auto tex_type_ent : Mask::Resource::Effect::g_textureTypes) {
-			try {
-				auto kv = m_imageParameters.find(tex_type_ent.first);
-				if (m_imageParameters.find(tex_type_ent.first) != m_imageParameters.end())
-				{
-					auto el = m_effect->GetEffect()->GetParameterByName(kv->first);
-					if (kv->second->GetType() == Type::Image) {
-						std::shared_ptr<Image> img = std::dynamic_pointer_cast<Image>(kv->second);
-						img->Render(part);
-						el.SetTexture(img->GetTexture());
-						el.SetSampler(m_samplerState);
-					}
-					else if (kv->second->GetType() == Type::Sequence) {
-						std::shared_ptr<Sequence> seq = std::dynamic_pointer_cast<Sequence>(kv->second);
-						seq->Render(part);
-						std::shared_ptr<Image> img = seq->GetImage();
-						el.SetTexture(img->GetTexture());
-						el.SetSampler(m_samplerState);
-
-						// set up texture matrix
-						// NOTE: there is no gs_effect_set_matrix3. bummer.
-						// - might be better as translate/scale/rot (vec2/vec2/float)
-						matrix4 texmat;
-						seq->SetTextureMatrix(part, &texmat);
-						gs_eparam_t* effparm = gs_effect_get_param_by_name(eff, PARAM_TEXMAT);
-						texmatset = true;
-						if (effparm)
-							gs_effect_set_matrix4(effparm, &texmat);
-
-						// should we delay rendering?
-						is_instance_visible = seq->IsInstancePlaying();
-					}
-				}
-				else
-				{
-					gs_eparam_t* param = gs_effect_get_param_by_name(m_effect->GetEffect()->GetObject(), tex_type_ent.first.c_str());
-					gs_texture_t *tex = nullptr;
-					m_parent->GetCache()->load_permanent("empty_texture", (void**)&tex);
-					if (param && tex)
-					{
-						gs_effect_set_texture(param, tex);
-						gs_effect_set_next_sampler(param, m_samplerState);
-					}
+		for (const TextureBinding& tb : m_bindings.textures) {
+			std::shared_ptr<GS::Texture> tex;
+			if (tb.sequence) {
+				tb.sequence->Render(part);
+				std::shared_ptr<Image> img = tb.sequence->GetImage();
+				if (img)
+					tex = img->GetTexture();
+
+				// set up texture matrix
+				// NOTE: there is no gs_effect_set_matrix3. bummer.
+				// - might be better as translate/scale/rot (vec2/vec2/float)
+				if (m_bindings.texMat) {
+					matrix4 texmat;
+					tb.sequence->SetTextureMatrix(part, &texmat);
+					gs_effect_set_matrix4(m_bindings.texMat, &texmat);
 				}
 
+				// should we delay rendering?
+				is_instance_visible = tb.sequence->IsInstancePlaying();
+			}
+			else {
+				tb.image->Render(part);
+				tex = tb.image->GetTexture();
 			}
-			catch (...) {
+			gs_effect_set_texture(tb.param, tex ? tex->GetObject() : nullptr);
+			gs_effect_set_next_sampler(tb.param, m_samplerState);
+		}
+		if (m_bindings.emptyTexture) {
+			for (gs_eparam_t* param : m_bindings.emptyTextures) {
+				gs_effect_set_texture(param, m_bindings.emptyTexture);
+				gs_effect_set_next_sampler(param, m_samplerState);
 			}
 		}
 
 		// attach video texture
-		gs_eparam_t* param = gs_effect_get_param_by_name(m_effect->GetEffect()->GetObject(), PARAM_VIDEO_LIGHTING_TEX);
-		gs_texture_t *tex = nullptr;
-		if (m_use_video_lighting)
-			tex = m_parent->GetVideoLightingTexture();
-		else
-			m_parent->GetCache()->load_permanent("empty_texture", (void**)&tex);
-		if (param && tex)
-		{
-			gs_effect_set_texture(param, tex);
-			gs_effect_set_next_sampler(param, m_samplerState);
+		if (m_bindings.videoLightingTex) {
+			gs_texture_t *tex = m_use_video_lighting ?
+				m_parent->GetVideoLightingTexture() : m_bindings.emptyTexture;
+			if (tex) {
+				gs_effect_set_texture(m_bindings.videoLightingTex, tex);
+				gs_effect_set_next_sampler(m_bindings.videoLightingTex, m_samplerState);
+			}
 		}
 
 		// attach render layer params from the model resource and mask data
-		if (part != nullptr && part->resources.size() > 0) {
-			gs_eparam_t* param_num_layers = gs_effect_get_param_by_name(eff, PARAM_NUM_RENDER_LAYERS);
-			gs_eparam_t* param_layer = gs_effect_get_param_by_name(eff, PARAM_RENDER_LAYER);
-			std::shared_ptr<SortedDrawObject> model = std::dynamic_pointer_cast<SortedDrawObject>(part->resources[0]);
-			if (param_num_layers && param_layer)
-			{
-				if (model)
-				{
-					gs_effect_set_int(param_num_layers, m_parent->GetNumRenderLayers());
-					gs_effect_set_int(param_layer, model->m_render_layer);
-				}
-				else
-				{
-					// use default render layer for model types that don't have
-					// SortedDrawObject interface, like emitter
-					gs_effect_set_int(param_num_layers, m_parent->GetNumRenderLayers());
-					gs_effect_set_int(param_layer, 0);
-				}
-			}
+		if (part != nullptr && part->resources.size() > 0 &&
+			m_bindings.numRenderLayers && m_bindings.renderLayer) {
+			// use default render layer for model types that don't have
+			// SortedDrawObject interface, like emitter
+			SortedDrawObject* model = dynamic_cast<SortedDrawObject*>(part->resources[0].get());
+			gs_effect_set_int(m_bindings.numRenderLayers, m_parent->GetNumRenderLayers());
+			gs_effect_set_int(m_bindings.renderLayer, model ? model->m_render_layer : 0);
 		}
 
 		// set params for lighting
@@ -542,12 +499,11 @@ bool Mask::Resource::Material::Loop(Mask::Part* part, BonesList* bones) {
 		SetSkinningParameters(bones);
 
 		// set global alpha
-		gs_eparam_t* effparm = gs_effect_get_param_by_name(eff, PARAM_ALPHA);
-		if (effparm) {
-			std::shared_ptr<AlphaInstanceData> aid =
-				m_parent->instanceDatas.GetData<AlphaInstanceData>
-				(AlphaInstanceDataId);
-			gs_effect_set_float(effparm, is_instance_visible ? aid->alpha : 0.0);
+		if (m_bindings.alpha) {
+			AlphaInstanceData* aid =
+				m_parent->instanceDatas.GetData(m_alphaData, AlphaInstanceDataId);
+			m_loopAlpha = is_instance_visible ? aid->alpha : 0.0f;
+			gs_effect_set_float(m_bindings.alpha, m_loopAlpha);
 		}
 
 		// get the technique
@@ -593,21 +549,101 @@ gs_address_mode Mask::Resource::Material::StringToAddressMode(std::string s) {
 	return GS_ADDRESS_CLAMP; 
 }
 
-void Mask::Resource::Material::SetLightingParameters(Mask::Part* part) {
-	UNUSED_PARAMETER(part);
-	// get the effect object
-	gs_effect_t* eff = m_effect->GetEffect()->GetObject();
-	
-	gs_eparam_t* param;
+void Mask::Resource::Material::Bind(gs_effect_t* eff) {
+	m_bindings = Bindings();
+	m_bindings.effect = eff;
+	if (!eff)
+		return;
 
-	// Set up world matrix for lighting 
-	param = gs_effect_get_param_by_name(eff, PARAM_WORLD);
-	if (param) {
+	// parameter values, skipping ones the effect doesn't have
+	// (or has with another type)
+	for (const auto& kv : m_parameters) {
+		gs_eparam_t* param = gs_effect_get_param_by_name(eff, kv.first.c_str());
+		if (!param || GS::EffectParameter(param).GetType() != kv.second.type)
+			continue;
+		m_bindings.values.push_back(ValueBinding{ param, &kv.second });
+	}
+
+	// textures, in g_textureTypes order
+	m_parent->GetCache()->load_permanent("empty_texture", (void**)&m_bindings.emptyTexture);
+	for (const auto& tt : Mask::Resource::Effect::g_textureTypes) {
+		gs_eparam_t* param = gs_effect_get_param_by_name(eff, tt.first.c_str());
+		if (!param || GS::EffectParameter(param).GetType() != GS::EffectParameter::Type::Texture)
+			continue;
+		auto kv = m_imageParameters.find(tt.first);
+		if (kv == m_imageParameters.end()) {
+			m_bindings.emptyTextures.push_back(param);
+			continue;
+		}
+		TextureBinding tb = { param, nullptr, nullptr };
+		if (kv->second->GetType() == Type::Image)
+			tb.image = static_cast<Image*>(kv->second.get());
+		else if (kv->second->GetType() == Type::Sequence)
+			tb.sequence = static_cast<Sequence*>(kv->second.get());
+		else
+			continue;
+		m_bindings.textures.push_back(tb);
+	}
+
+	m_bindings.videoLightingTex = gs_effect_get_param_by_name(eff, PARAM_VIDEO_LIGHTING_TEX);
+	m_bindings.texMat = gs_effect_get_param_by_name(eff, PARAM_TEXMAT);
+	m_bindings.numRenderLayers = gs_effect_get_param_by_name(eff, PARAM_NUM_RENDER_LAYERS);
+	m_bindings.renderLayer = gs_effect_get_param_by_name(eff, PARAM_RENDER_LAYER);
+	m_bindings.world = gs_effect_get_param_by_name(eff, PARAM_WORLD);
+	m_bindings.alpha = gs_effect_get_param_by_name(eff, PARAM_ALPHA);
+	m_bindings.numLights = gs_effect_get_param_by_name(eff, PARAM_NUMLIGHTS);
+	m_bindings.numBones = gs_effect_get_param_by_name(eff, PARAM_NUMBONES);
+	m_bindings.bones = gs_effect_get_param_by_name(eff, PARAM_BONES);
+
+	char temp[64];
+	for (size_t i = 0; i < m_bindings.lights.size(); i++) {
+		LightBinding& lb = m_bindings.lights[i];
+		snprintf(temp, sizeof(temp), "light%dType", (int)i);
+		lb.type = gs_effect_get_param_by_name(eff, temp);
+		snprintf(temp, sizeof(temp), "light%dPosition", (int)i);
+		lb.position = gs_effect_get_param_by_name(eff, temp);
+		snprintf(temp, sizeof(temp), "light%dDirection", (int)i);
+		lb.direction = gs_effect_get_param_by_name(eff, temp);
+		snprintf(temp, sizeof(temp), "light%dAttenuation", (int)i);
+		lb.attenuation = gs_effect_get_param_by_name(eff, temp);
+		snprintf(temp, sizeof(temp), "light%dAmbient", (int)i);
+		lb.ambient = gs_effect_get_param_by_name(eff, temp);
+		snprintf(temp, sizeof(temp), "light%dDiffuse", (int)i);
+		lb.diffuse = gs_effect_get_param_by_name(eff, temp);
+		snprintf(temp, sizeof(temp), "light%dSpecular", (int)i);
+		lb.specular = gs_effect_get_param_by_name(eff, temp);
+		snprintf(temp, sizeof(temp), "light%dAngle", (int)i);
+		lb.angle = gs_effect_get_param_by_name(eff, temp);
+	}
+}
+
+void Mask::Resource::Material::SetInstanceParameters(float alpha) {
+	// world matrix for lighting follows the instance
+	if (m_bindings.world) {
 		// go obs. need to transpose matrices sent to shaders from gs.
 		matrix4 w;
 		gs_matrix_get(&w);
 		matrix4_transpose(&w, &w);
-		gs_effect_set_matrix4(param, &w);
+		gs_effect_set_matrix4(m_bindings.world, &w);
+	}
+	if (m_bindings.alpha)
+		gs_effect_set_float(m_bindings.alpha, m_loopAlpha * alpha);
+}
+
+bool Mask::Resource::Material::HasSequences() {
+	for (const auto& kv : m_imageParameters) {
+		if (kv.second->GetType() == Type::Sequence)
+			return true;
+	}
+	return false;
+}
+
+void Mask::Resource::Material::SetLightingParameters(Mask::Part* part) {
+	UNUSED_PARAMETER(part);
+
+	// Set up world matrix for lighting 
+	if (m_bindings.world) {
+		SetInstanceParameters();
 	}
 	else {
 		// No World matrix param - assume this effect doesn't support
@@ -617,106 +653,58 @@ void Mask::Resource::Material::SetLightingParameters(Mask::Part* part) {
 
 
 	// Look for light instance data
-	char temp[64];
 	int numLights = 0;
 	for (int i = 0; i < 8; i++) {
 
-		std::shared_ptr<LightInstanceData> lightData =
+		LightInstanceData* lightData =
 			m_parent->instanceDatas.FindDataDontCreate<LightInstanceData>(m_lightIds[i]);
 		if (!lightData)
 			break;
 
 		numLights++;
 
-		// light type
-		snprintf(temp, sizeof(temp), "light%dType", i);
-		param = gs_effect_get_param_by_name(eff, temp);
-		if (param)
-			gs_effect_set_int(param, (int)lightData->lightType);
-		
-		// position
-		snprintf(temp, sizeof(temp), "light%dPosition", i);
-		param = gs_effect_get_param_by_name(eff, temp);
-		if (param)
-			gs_effect_set_vec3(param, &lightData->position);
-
-		// direction
-		snprintf(temp, sizeof(temp), "light%dDirection", i);
-		param = gs_effect_get_param_by_name(eff, temp);
-		if (param)
-			gs_effect_set_vec3(param, &lightData->direction);
-
-		// attenuation
-		snprintf(temp, sizeof(temp), "light%dAttenuation", i);
-		param = gs_effect_get_param_by_name(eff, temp);
-		if (param) { 
+		const LightBinding& lb = m_bindings.lights[i];
+		if (lb.type)
+			gs_effect_set_int(lb.type, (int)lightData->lightType);
+		if (lb.position)
+			gs_effect_set_vec3(lb.position, &lightData->position);
+		if (lb.direction)
+			gs_effect_set_vec3(lb.direction, &lightData->direction);
+		if (lb.attenuation) {
 			vec3 att;
 			vec3_set(&att, lightData->att0, lightData->att1, lightData->att2);
-			gs_effect_set_vec3(param, &att);
+			gs_effect_set_vec3(lb.attenuation, &att);
 		}
-		 
-		// ambient color
-		snprintf(temp, sizeof(temp), "light%dAmbient", i);
-		param = gs_effect_get_param_by_name(eff, temp);
-		if (param) 
-			gs_effect_set_vec3(param, &lightData->ambient);
-		
-		// diffuse color
-		snprintf(temp, sizeof(temp), "light%dDiffuse", i);
-		param = gs_effect_get_param_by_name(eff, temp);
-		if (param)
-			gs_effect_set_vec3(param, &lightData->diffuse);
-		
-		// specular color 
-		snprintf(temp, sizeof(temp), "light%dSpecular", i);
-		param = gs_effect_get_param_by_name(eff, temp);
-		if (param)
-			gs_effect_set_vec3(param, &lightData->specular); 
-		 
-		// spot angle
-		snprintf(temp, sizeof(temp), "light%dAngle", i);
-		param = gs_effect_get_param_by_name(eff, temp);
-		if (param)
-			gs_effect_set_float(param, lightData->outerAngle / 2.0f);
+		if (lb.ambient)
+			gs_effect_set_vec3(lb.ambient, &lightData->ambient);
+		if (lb.diffuse)
+			gs_effect_set_vec3(lb.diffuse, &lightData->diffuse);
+		if (lb.specular)
+			gs_effect_set_vec3(lb.specular, &lightData->specular);
+		if (lb.angle)
+			gs_effect_set_float(lb.angle, lightData->outerAngle / 2.0f);
 	} 
 
 	// num lights
-	if (numLights > 0) {
-		param = gs_effect_get_param_by_name(eff, PARAM_NUMLIGHTS);
-		if (param)
-			gs_effect_set_int(param, numLights);
-	}
+	if (numLights > 0 && m_bindings.numLights)
+		gs_effect_set_int(m_bindings.numLights, numLights);
 }
 
 
 void Mask::Resource::Material::SetSkinningParameters(
 	Mask::Resource::BonesList* bones) {
-	// get the effect object
-	gs_effect_t* eff = m_effect->GetEffect()->GetObject();
-	gs_eparam_t* param;
-
-	if (bones == nullptr || bones->numBones < 1) {
-		// numBones
-		param = gs_effect_get_param_by_name(eff, PARAM_NUMBONES);
-		if (param)
-			gs_effect_set_int(param, 0);
+	int nb = (bones == nullptr) ? 0 : bones->numBones;
+	if (nb < 1) {
+		if (m_bindings.numBones)
+			gs_effect_set_int(m_bindings.numBones, 0);
 		return;
 	}
 
-	char temp[64];
-	int nb = bones->numBones;
-
-	// numBones
-	param = gs_effect_get_param_by_name(eff, PARAM_NUMBONES);
-	if (param)
-		gs_effect_set_int(param, nb);
-
-	// bone matrices
-	for (int i = 0; i < nb; i++) {
-		snprintf(temp, sizeof(temp), "bone%d", i);
-		param = gs_effect_get_param_by_name(eff, temp);
-		if (param) {
-			gs_effect_set_matrix4(param, bones->bones[i]);
-		}
-	}
+	if (m_bindings.numBones)
+		gs_effect_set_int(m_bindings.numBones, nb);
+
+	// the whole palette in one go
+	if (m_bindings.bones)
+		gs_effect_set_val(m_bindings.bones, bones->bones,
+			sizeof(matrix4) * MAX_BONES_PER_SKIN);
 }
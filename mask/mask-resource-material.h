@@ -20,6 +20,7 @@
 #include "mask-resource.h"
 #include "mask-resource-effect.h"
 #include "mask-resource-image.h"
+#include "mask-instance-data.h"
 #include "gs/gs-effect.h"
 #include <string>
 #include <vector>
@@ -29,6 +30,7 @@ namespace Mask {
 	namespace Resource {
 
 		struct BonesList;
+		class Sequence;
 
 		class Material : public IBase {
 		public:
@@ -40,6 +42,12 @@ namespace Mask {
 			virtual void Render(Mask::Part* part) override;
 
 			bool Loop(Mask::Part* part, BonesList* bones = nullptr);
+			// between the draws of an instanced draw, after the
+			// matrix changed. alpha scales the material's alpha.
+			void SetInstanceParameters(float alpha = 1.0f);
+			// sequences keep per instance state, so instances of this
+			// material can't share one material setup
+			bool HasSequences();
 
 			bool IsDepthOnly() override { return m_depthOnly; }
 			bool IsStatic() override { return m_static; }
@@ -60,6 +68,47 @@ namespace Mask {
 				};
 			};
 
+			// effect parameters, looked up once per effect object so
+			// drawing only has to set values
+			struct ValueBinding {
+				gs_eparam_t*		param;
+				const Parameter*	value;
+			};
+			struct TextureBinding {
+				gs_eparam_t*	param;
+				// one of these, owned by m_imageParameters
+				Image*			image;
+				Sequence*		sequence;
+			};
+			struct LightBinding {
+				gs_eparam_t*	type;
+				gs_eparam_t*	position;
+				gs_eparam_t*	direction;
+				gs_eparam_t*	attenuation;
+				gs_eparam_t*	ambient;
+				gs_eparam_t*	diffuse;
+				gs_eparam_t*	specular;
+				gs_eparam_t*	angle;
+			};
+			struct Bindings {
+				gs_effect_t*				effect = nullptr;
+				std::vector<ValueBinding>	values;
+				std::vector<TextureBinding>	textures;
+				// texture slots with no image get the empty texture
+				std::vector<gs_eparam_t*>	emptyTextures;
+				gs_texture_t*				emptyTexture = nullptr;
+				gs_eparam_t*				videoLightingTex = nullptr;
+				gs_eparam_t*				texMat = nullptr;
+				gs_eparam_t*				numRenderLayers = nullptr;
+				gs_eparam_t*				renderLayer = nullptr;
+				gs_eparam_t*				world = nullptr;
+				gs_eparam_t*				alpha = nullptr;
+				gs_eparam_t*				numLights = nullptr;
+				gs_eparam_t*				numBones = nullptr;
+				std::array<LightBinding, 8>	lights = {};
+				gs_eparam_t*				bones = nullptr;
+			};
+
 		protected:
 			std::shared_ptr<Effect> m_effect;
 			std::string m_technique;
@@ -87,10 +136,14 @@ namespace Mask {
 			bool m_opaque;
 			bool m_alphaWrite;
 			bool m_use_video_lighting;
+			float m_loopAlpha;
+			Bindings m_bindings;
+			InstanceHandle<AlphaInstanceData> m_alphaData;
 
 			gs_address_mode StringToAddressMode(std::string s);
 			void SetLightingParameters(Mask::Part* part);
 			void SetSkinningParameters(BonesList* bones);
+			void Bind(gs_effect_t* eff);
 		};
 	}
 }
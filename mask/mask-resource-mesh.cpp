@@ -30,6 +30,7 @@
 #include <opencv2/opencv.hpp>
 #include "mask.h"
 #include "mask-resource-model.h"
+#include "mask-resource-material.h"
 
 extern "C" {
 	#pragma warning( push )
@@ -46,10 +47,14 @@ static const char* const S_VERTEX_BUFFER = "vertex-buffer";
 static const char* const S_INDEX_BUFFER = "index-buffer";
 static const char* const S_CENTER = "center";
 
-Mask::Resource::Mesh::Mesh(Mask::MaskData* parent, std::string name, obs_data_t* data)
-	: IBase(parent, name), m_part(nullptr) {
+Mask::Resource::Mesh::Mesh(Mask::MaskData* parent, std::string name, obs_data_t* data, bool createGS)
+	: IBase(parent, name), m_part(nullptr), m_rawVertices(nullptr), m_rawIndices(nullptr),
+	m_numIndices(0), m_cache(parent->GetCache()), m_sharedBuffers(nullptr) {
 
 	// We could be an embedded OBJ file, or raw geometry
+	const uint8_t* objData = nullptr;
+	size_t objSize = 0;
+	std::vector<uint8_t> decodedObj;
 
 	// Raw geometry?
 	if (obs_data_has_user_value(data, S_VERTEX_BUFFER)) {
@@ -59,12 +64,23 @@ Mask::Resource::Mesh::Mesh(Mask::MaskData* parent, std::string name, obs_data_t*
 			PLOG_ERROR("Mesh '%s' has empty vertex data.", name.c_str());
 			throw std::logic_error("Mesh has empty vertex data.");
 		}
-		std::vector<uint8_t> decodedVertices;
-		base64_decode(vertex64data, decodedVertices);
-		// add extra to buffer size to allow for alignment
-		size_t vertBuffSize = zlib_size(decodedVertices) + 16;
-		m_rawVertices = new uint8_t[vertBuffSize];
-		zlib_decode(decodedVertices, (uint8_t*)ALIGN_16(m_rawVertices));
+		const uint8_t* blob;
+		size_t blobSize;
+		size_t vertBuffSize;
+		if (parent->GetBlob(vertex64data, &blob, &blobSize)) {
+			// compiled mask: already inflated, just copy out of the
+			// mapping since the vertex buffer fixes up its pointers in place
+			vertBuffSize = blobSize;
+			m_rawVertices = new uint8_t[blobSize + 16];
+			memcpy((uint8_t*)ALIGN_16(m_rawVertices), blob, blobSize);
+		}
+		else {
+			// decode and inflate straight into the aligned buffer
+			vertBuffSize = base64_decodeZ_size(vertex64data);
+			// add extra to buffer size to allow for alignment
+			m_rawVertices = new uint8_t[vertBuffSize + 16];
+			base64_decodeZ(vertex64data, (uint8_t*)ALIGN_16(m_rawVertices), vertBuffSize);
+		}
 
 		// Index Buffer
 		if (!obs_data_has_user_value(data, S_INDEX_BUFFER)) {
@@ -76,13 +92,31 @@ Mask::Resource::Mesh::Mesh(Mask::MaskData* parent, std::string name, obs_data_t*
 			PLOG_ERROR("Mesh '%s' has empty index buffer data.", name.c_str());
 			throw std::logic_error("Mesh has empty index buffer data.");
 		}
-		std::vector<uint8_t> decodedIndices;
-		base64_decode(index64data, decodedIndices);
-		size_t idxBuffSize = zlib_size(decodedIndices);
-		m_numIndices = (int)(idxBuffSize / sizeof(uint32_t));
-		// add extra to buffer size to allow for alignment
-		m_rawIndices = new uint8_t[idxBuffSize + 16];
-		zlib_decode(decodedIndices, (uint8_t*)ALIGN_16(m_rawIndices));
+		size_t idxBuffSize;
+		if (parent->GetBlob(index64data, &blob, &blobSize)) {
+			idxBuffSize = blobSize;
+			m_numIndices = (int)(blobSize / sizeof(uint32_t));
+			m_rawIndices = new uint8_t[blobSize + 16];
+			memcpy((uint8_t*)ALIGN_16(m_rawIndices), blob, blobSize);
+		}
+		else {
+			idxBuffSize = base64_decodeZ_size(index64data);
+			m_numIndices = (int)(idxBuffSize / sizeof(uint32_t));
+			// add extra to buffer size to allow for alignment
+			m_rawIndices = new uint8_t[idxBuffSize + 16];
+			base64_decodeZ(index64data, (uint8_t*)ALIGN_16(m_rawIndices), idxBuffSize);
+		}
+
+		// the vertex buffer memory image stores offsets, not pointers,
+		// so identical meshes are identical bytes
+		uint64_t hash = Utils::hash64((const uint8_t*)ALIGN_16(m_rawVertices), vertBuffSize);
+		hash = Utils::hash64((const uint8_t*)ALIGN_16(m_rawIndices), idxBuffSize, hash);
+		if (LoadCachedBuffers(hash)) {
+			delete[] m_rawVertices;
+			delete[] m_rawIndices;
+			m_rawVertices = nullptr;
+			m_rawIndices = nullptr;
+		}
 	}
 	
 	// OBJ data?
@@ -96,7 +130,11 @@ Mask::Resource::Mesh::Mesh(Mask::MaskData* parent, std::string name, obs_data_t*
 			PLOG_ERROR("Mesh '%s' has empty data.", name.c_str());
 			throw std::logic_error("Mesh has empty data.");
 		}
-		m_tempFile = Utils::Base64ToTempFile(base64data);
+		if (!parent->GetBlob(base64data, &objData, &objSize)) {
+			base64_decodeZ(base64data, decodedObj);
+			objData = decodedObj.data();
+			objSize = decodedObj.size();
+		}
 	}
 
 	// center?
@@ -107,24 +145,88 @@ Mask::Resource::Mesh::Mesh(Mask::MaskData* parent, std::string name, obs_data_t*
 	}
 	vec4_set(&m_center, center.x, center.y, center.z, 1.0f);
 
-	// create GS resources
-	if (m_tempFile.length() > 0) {
-		LoadObj(m_tempFile);
-		Utils::DeleteTempFile(m_tempFile);
-		m_tempFile.clear();
-	}
-	else {
-		m_VertexBuffer = std::make_shared<GS::VertexBuffer>(m_rawVertices);
-		m_IndexBuffer = std::make_shared<GS::IndexBuffer>(m_rawIndices, m_numIndices);
+	if (objData && !LoadCachedBuffers(Utils::hash64(objData, objSize))) {
+		LoadObj(objData, objSize);
 	}
+
+	// create GS resources
+	if (createGS)
+		CreateGS();
 } 
 
 Mask::Resource::Mesh::Mesh(Mask::MaskData* parent, std::string name, std::string file)
-	: IBase(parent, name), m_part(nullptr) {
+	: IBase(parent, name), m_part(nullptr), m_rawVertices(nullptr), m_rawIndices(nullptr),
+	m_numIndices(0), m_cache(nullptr), m_sharedBuffers(nullptr) {
 	LoadObj(file);
+	CreateGS();
+}
+
+Mask::Resource::Mesh::~Mesh() {
+	// never handed to GS
+	delete[] m_rawVertices;
+	delete[] m_rawIndices;
+
+	if (m_sharedBuffers)
+		m_cache->try_destroy_resource(m_contentKey, m_sharedBuffers,
+			CacheableType::MeshBuffers);
+}
+
+bool Mask::Resource::Mesh::LoadCachedBuffers(uint64_t contentHash) {
+	m_contentKey = "mesh:" + Utils::hash64ToString(contentHash);
+	if (!m_cache)
+		return false;
+
+	m_cache->load(CacheableType::MeshBuffers, m_contentKey, (void**)&m_sharedBuffers);
+	if (!m_sharedBuffers)
+		return false;
+
+	// same geometry already on the gpu
+	m_VertexBuffer = m_sharedBuffers->vertices;
+	m_IndexBuffer = m_sharedBuffers->indices;
+	return true;
+}
+
+void Mask::Resource::Mesh::CreateGS() {
+	if (m_VertexBuffer)
+		return;
+
+	if (m_rawVertices) {
+		// the buffers take ownership of the raw data
+		m_VertexBuffer = std::make_shared<GS::VertexBuffer>(m_rawVertices);
+		m_IndexBuffer = std::make_shared<GS::IndexBuffer>(m_rawIndices, m_numIndices);
+		m_rawVertices = nullptr;
+		m_rawIndices = nullptr;
+	}
+	else if (m_objIndices.size() > 0) {
+		m_VertexBuffer = std::make_shared<GS::VertexBuffer>(m_objVertices);
+		m_IndexBuffer = std::make_shared<GS::IndexBuffer>(m_objIndices);
+		m_objVertices = std::vector<GS::Vertex>();
+		m_objIndices = std::vector<uint32_t>();
+	}
+	else
+		return;
+
+	// share with identical meshes loaded later
+	if (m_cache && !m_contentKey.empty()) {
+		MeshBuffers* buffers = new MeshBuffers();
+		buffers->vertices = m_VertexBuffer;
+		buffers->indices = m_IndexBuffer;
+		if (m_cache->add(CacheableType::MeshBuffers, m_contentKey, buffers, GetMemorySize()))
+			m_sharedBuffers = buffers;
+		else
+			delete buffers;
+	}
 }
 
-Mask::Resource::Mesh::~Mesh() {}
+size_t Mask::Resource::Mesh::GetMemorySize() {
+	size_t bytes = m_objVertices.size() * sizeof(GS::Vertex) +
+		m_objIndices.size() * sizeof(uint32_t);
+	if (m_VertexBuffer)
+		bytes += m_VertexBuffer->size() * sizeof(GS::Vertex);
+	if (m_IndexBuffer)
+		bytes += m_IndexBuffer->size() * sizeof(uint32_t);
+	return bytes;
+}
 
 Mask::Resource::Type Mask::Resource::Mesh::GetType() {
 	return Mask::Resource::Type::Mesh;
@@ -146,12 +248,36 @@ void Mask::Resource::Mesh::Render(Mask::Part* part) {
 	return;
 }
 
+void Mask::Resource::Mesh::RenderInstances(Material* material, bool faceOnly) {
+	gs_load_vertexbuffer(m_VertexBuffer->get());
+	gs_load_indexbuffer(m_IndexBuffer->get());
+
+	size_t instances = m_parent->GetNumDrawInstances();
+	for (size_t i = 0; i < instances; i++) {
+		float alpha = m_parent->GetDrawInstanceAlpha(i);
+		if (instances > 1 || alpha != 1.0f) {
+			m_parent->SetDrawInstance(i, faceOnly);
+			material->SetInstanceParameters(alpha);
+		}
+		gs_draw(gs_draw_mode::GS_TRIS, 0, (uint32_t)m_IndexBuffer->size());
+	}
+}
+
 static std::string GetBaseDir(const std::string &filepath) {
 	if (filepath.find_last_of("/\\") != std::string::npos)
 		return filepath.substr(0, filepath.find_last_of("/\\"));
 	return "";
 }
 
+// read-only istream over a block of memory (no copy)
+class MemoryStreamBuf : public std::streambuf {
+public:
+	MemoryStreamBuf(const uint8_t* data, size_t size) {
+		char* p = (char*)data;
+		setg(p, p, p + size);
+	}
+};
+
 void Mask::Resource::Mesh::LoadObj(std::string file) {
 	std::vector<tinyobj::shape_t> shapes;
 	std::vector<tinyobj::material_t> materials;
@@ -163,16 +289,38 @@ void Mask::Resource::Mesh::LoadObj(std::string file) {
 		blog(LOG_ERROR, err.c_str());
 		return;
 	}
+	BuildObj(attrib, shapes);
+}
+
+void Mask::Resource::Mesh::LoadObj(const uint8_t* data, size_t size) {
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+	tinyobj::attrib_t attrib;
+	std::string err;
+	MemoryStreamBuf buf(data, size);
+	std::istream stream(&buf);
+	// embedded OBJs have no mtl files to go with them
+	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, &stream)) {
+		blog(LOG_ERROR, "Unable to load OBJ data for mesh: %s", m_name.c_str());
+		blog(LOG_ERROR, err.c_str());
+		return;
+	}
+	BuildObj(attrib, shapes);
+}
 
-	// Create GPU mesh from tinyobj format.
+void Mask::Resource::Mesh::BuildObj(const tinyobj::attrib_t& attrib,
+	const std::vector<tinyobj::shape_t>& shapes) {
+	// Convert from tinyobj format, GS buffers are made in CreateGS.
 	char keybuff[128];
-	std::vector<GS::Vertex> vertices;
+	std::vector<GS::Vertex>& vertices = m_objVertices;
 	std::vector<std::string> vertexKeys;
-	std::vector<uint32_t> indices;
+	std::vector<uint32_t>& indices = m_objIndices;
+	vertices.clear();
+	indices.clear();
 	for (size_t i = 0; i < shapes.size(); i++) {
-		tinyobj::shape_t& shape = shapes[i];
+		const tinyobj::shape_t& shape = shapes[i];
 		for (size_t j = 0; j < shape.mesh.indices.size(); j++) {
-			tinyobj::index_t& index = shape.mesh.indices[j];
+			const tinyobj::index_t& index = shape.mesh.indices[j];
 
 			snprintf(keybuff, sizeof(keybuff), "%d-%d-%d", index.vertex_index, index.normal_index,
 				index.texcoord_index);
@@ -219,12 +367,6 @@ void Mask::Resource::Mesh::LoadObj(std::string file) {
 		vertices[idx1].tangent = CalculateTangent(vertices[idx1], vertices[idx2], vertices[idx0]);
 		vertices[idx2].tangent = CalculateTangent(vertices[idx2], vertices[idx0], vertices[idx1]);
 	}
-
-	// Create Vertex Buffer
-	m_VertexBuffer = std::make_shared<GS::VertexBuffer>(vertices);
-
-	// Create Index Buffer
-	m_IndexBuffer = std::make_shared<GS::IndexBuffer>(indices);
 }
 
 
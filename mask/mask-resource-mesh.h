@@ -20,19 +20,34 @@
 #include "mask-resource.h"
 #include "gs/gs-vertexbuffer.h"
 #include "gs/gs-indexbuffer.h"
+#include <tiny_obj_loader.h>
 
 namespace Mask {
 	namespace Resource {
+		// gpu buffers, shared through the cache between
+		// meshes with identical content
+		struct MeshBuffers {
+			std::shared_ptr<GS::VertexBuffer>	vertices;
+			std::shared_ptr<GS::IndexBuffer>	indices;
+		};
+
+		class Material;
+
 		class Mesh : public IBase {
 		public:
 			Mesh(Mask::MaskData* parent, std::string name, std::string file);
-			Mesh(Mask::MaskData* parent, std::string name, obs_data_t* data);
+			Mesh(Mask::MaskData* parent, std::string name, obs_data_t* data, bool createGS = true);
 			virtual ~Mesh();
 
 			virtual Type GetType() override;
 
 			virtual void Update(Mask::Part* part, float time) override;
 			virtual void Render(Mask::Part* part) override;
+			// one draw per instance of the current draw command, with
+			// the world (or just the face) transform and alpha of each
+			void RenderInstances(Material* material, bool faceOnly = false);
+			virtual void CreateGS() override;
+			virtual size_t GetMemorySize() override;
 
 			std::shared_ptr<GS::VertexBuffer> GetVertexBuffer() {
 				return m_VertexBuffer;
@@ -44,6 +59,11 @@ namespace Mask {
 
 		private:
 			void LoadObj(std::string file);
+			void LoadObj(const uint8_t* data, size_t size);
+			void BuildObj(const tinyobj::attrib_t& attrib,
+				const std::vector<tinyobj::shape_t>& shapes);
+			// use the cached buffers for content, if there are any
+			bool LoadCachedBuffers(uint64_t contentHash);
 
 		protected:
 			std::shared_ptr<GS::VertexBuffer>	m_VertexBuffer;
@@ -54,10 +74,16 @@ namespace Mask {
 			std::shared_ptr<Mask::Part>			m_part;
 
 			// for delayed gs creation
-			std::string				m_tempFile;
 			uint8_t*				m_rawVertices;
 			uint8_t*				m_rawIndices;
 			int						m_numIndices;
+			std::vector<GS::Vertex>	m_objVertices;
+			std::vector<uint32_t>	m_objIndices;
+
+			// identical meshes share buffers through the cache
+			Cache*					m_cache;
+			std::string				m_contentKey;
+			MeshBuffers*			m_sharedBuffers;
 
 			vec3 CalculateTangent(const GS::Vertex& v1,
 				const GS::Vertex& v2, const GS::Vertex& v3);
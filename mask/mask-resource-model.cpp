@@ -116,7 +116,7 @@ void Mask::Resource::Model::DirectRender(Mask::Part* part) {
 
 	m_parent->instanceDatas.Push(m_id);
 	while (m_material->Loop(part)) {
-		m_mesh->Render(part);
+		m_mesh->RenderInstances(m_material.get());
 	}
 	m_parent->instanceDatas.Pop();
 }
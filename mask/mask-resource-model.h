@@ -39,6 +39,7 @@ namespace Mask {
 			virtual bool IsDepthOnly() override;
 			virtual bool IsStatic() override;
 			virtual bool IsRotationDisabled() override;
+			virtual bool CanDrawInstanced() override { return true; }
 
 			virtual float	SortDepth() override;
 			virtual void	SortedRender() override;
@@ -90,6 +90,7 @@ namespace Mask {
 			float					m_delay;
 			Mode					m_mode;
 			bool					m_randomStart;
+			InstanceHandle<SequenceInstanceData>	m_instanceData;
 
 			Mode StringToMode(std::string m);
 			bool IsMultiFrameMode() {
@@ -48,14 +48,6 @@ static const char* const S_DEPTH_BIAS = "depth-bias";
 Mask::Resource::SkinnedModel::SkinnedModel(Mask::MaskData* parent, std::string name, obs_data_t* data)
 	: IBase(parent, name) {
 
-	// cache hash ids for bones 
-	std::hash<std::string> hasher;
-	char temp[64];
-	for (int i = 0; i < 8; i++) {
-		snprintf(temp, sizeof(temp), "bone%d", i);
-		m_boneIds[i] = hasher(temp);
-	}
-
 	// Material
 	if (!obs_data_has_user_value(data, S_MATERIAL)) {
 		PLOG_ERROR("Skinned Model '%s' has no material.", name.c_str());
@@ -187,8 +179,19 @@ Mask::Resource::SkinnedModel::SkinnedModel(Mask::MaskData* parent, std::string n
 
 		for (obs_data_item_t* itm2 = obs_data_first(skinBonesData); itm2; obs_data_item_next(&itm2)) {
 			int boneIdx = (int)obs_data_item_get_int(itm2);
+			if (boneIdx < 0 || boneIdx >= (int)m_bones.size()) {
+				PLOG_ERROR("Skinned Model '%s' skin has a bad bone index.", name.c_str());
+				throw std::logic_error("Skinned Model skin has a bad bone index.");
+			}
 			skin.bones.push_back(boneIdx);
 		}
+		if ((int)skin.bones.size() > MAX_BONES_PER_SKIN) {
+			PLOG_ERROR("Skinned Model '%s' skin has more than %d bones.", name.c_str(), MAX_BONES_PER_SKIN);
+			throw std::logic_error("Skinned Model skin has too many bones.");
+		}
+		skin.palette.resize(MAX_BONES_PER_SKIN);
+		for (matrix4& m : skin.palette)
+			matrix4_identity(&m);
 
 		m_skins.emplace_back(skin);
 		obs_data_release(skinData);
@@ -239,6 +242,11 @@ void Mask::Resource::SkinnedModel::Update(Mask::Part* part, float time) {
 		// need to transpose, since we are passing to a shader
 		matrix4_transpose(&bone.global, &bone.global);
 	}
+	// and the skin palettes, so drawing just uploads them
+	for (Skin& skin : m_skins) {
+		for (size_t j = 0; j < skin.bones.size(); j++)
+			matrix4_copy(&skin.palette[j], &m_bones[skin.bones[j]].global);
+	}
 	m_parent->instanceDatas.Pop();
 }
 
@@ -267,14 +275,11 @@ void Mask::Resource::SkinnedModel::DirectRender(Mask::Part* part) {
 	for (unsigned int i = 0; i < m_skins.size(); i++) {
 		const Skin& skin = m_skins[i];
 
-		// set up bones list
 		bone_list.numBones = (int)skin.bones.size();
-		for (int j = 0; j < skin.bones.size(); j++) {
-			bone_list.bones[j] = &(m_bones[skin.bones[j]].global);
-		}
+		bone_list.bones = skin.palette.data();
 		// draw
 		while (m_material->Loop(part, &bone_list)) {
-			skin.mesh->Render(part);
+			skin.mesh->RenderInstances(m_material.get(), true);
 		}
 	}
 	m_parent->instanceDatas.Pop();
@@ -28,11 +28,14 @@
 namespace Mask {
 	namespace Resource {
 
-		static const int MAX_BONES_PER_SKIN = 8;
+		// size of the bone palette in the effects
+		static const int MAX_BONES_PER_SKIN = 64;
 
+		// a skin's bone palette, MAX_BONES_PER_SKIN matrices
+		// transposed for the shader
 		struct BonesList {
-			int											numBones;
-			std::array<matrix4*, MAX_BONES_PER_SKIN>	bones;
+			int				numBones;
+			const matrix4*	bones;
 		};
 
 		class SkinnedModel : public IBase, public SortedDrawObject {
@@ -46,6 +49,7 @@ namespace Mask {
 			virtual bool IsDepthOnly() override;
 			virtual bool IsStatic() override;
 			virtual bool IsRotationDisabled() override;
+			virtual bool CanDrawInstanced() override { return true; }
 
 			virtual float	SortDepth() override;
 			virtual void	SortedRender() override;
@@ -74,13 +78,13 @@ namespace Mask {
 			struct Skin {
 				std::shared_ptr<Mesh>	mesh;
 				std::vector<int>		bones;
+				// bone matrices, gathered once per update
+				std::vector<matrix4>	palette;
 			};
 
 			std::vector<Bone>			m_bones;
 			std::vector<Skin>			m_skins;
 			std::shared_ptr<Material>	m_material;
-
-			std::array<size_t, 8>		m_boneIds;
 		};
 	}
 }
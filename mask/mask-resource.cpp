@@ -111,6 +111,24 @@ std::shared_ptr<Mask::Resource::IBase> Mask::Resource::IBase::Load(Mask::MaskDat
 	return nullptr;
 }
 
+std::shared_ptr<Mask::Resource::IBase> Mask::Resource::IBase::Decode(Mask::MaskData* parent, std::string name, obs_data_t* data, Cache *cache) {
+	static const char* const S_TYPE = "type";
+
+	if (!obs_data_has_user_value(data, S_TYPE))
+		return nullptr;
+
+	// images and meshes don't reference other resources, and all
+	// their heavy lifting (base64, zlib, png, obj) is CPU only
+	std::string type = obs_data_get_string(data, S_TYPE);
+	if (type == "image") {
+		return std::make_shared<Mask::Resource::Image>(parent, name, data, cache, false);
+	}
+	else if (type == "mesh") {
+		return std::make_shared<Mask::Resource::Mesh>(parent, name, data, false);
+	}
+	return nullptr;
+}
+
 std::shared_ptr<Mask::Resource::IBase> Mask::Resource::IBase::LoadDefault(Mask::MaskData* parent, std::string name, Cache *cache) {
 	std::shared_ptr<Mask::Resource::IBase> p(nullptr);
 
@@ -151,7 +169,11 @@ std::shared_ptr<Mask::Resource::IBase> Mask::Resource::IBase::LoadDefault(Mask::
 		// load templates file
 		char* f = obs_module_file("resources/templates.json");
 		g_templates = obs_data_create_from_json_file(f);
-		cache->add_permanent(CacheableType::OBSData, "templates", g_templates);
+		if (!cache->add_permanent(CacheableType::OBSData, "templates", g_templates)) {
+			// another thread loaded them first
+			obs_data_release(g_templates);
+			cache->load_permanent("templates", (void **)&g_templates);
+		}
 		bfree(f);
 	}
 
@@ -194,9 +216,64 @@ std::shared_ptr<Mask::Resource::IBase> Mask::Resource::IBase::LoadDefault(Mask::
 // Cache Pools
 // ------------------------------------------------------------------------- //
 
-const size_t Mask::Resource::Cache::POOL_SIZE = 10;
+const size_t Mask::Resource::Cache::DEFAULT_BUDGET = 256 * 1024 * 1024;
+
+// compiled shaders don't report their size, count them as this much
+static const size_t EFFECT_SIZE_ESTIMATE = 64 * 1024;
+
+Mask::Resource::Cache::Cache() : m_budget(DEFAULT_BUDGET), m_active_bytes(0),
+	m_idle(DEFAULT_BUDGET), m_hits(0), m_misses(0), m_evictions(0) {}
+
+std::string Mask::Resource::Cache::make_key(CacheableType resource_type, const std::string& name) {
+	return std::to_string((int)resource_type) + ":" + name;
+}
+
+size_t Mask::Resource::Cache::estimate_size(CacheableType resource_type, void *resource) {
+	if (resource == nullptr)
+		return 0;
+
+	switch (resource_type)
+	{
+	case CacheableType::Texture:
+	{
+		// top mip level only, callers that know better pass the size
+		gs_texture_t *texture = reinterpret_cast<gs_texture_t*>(resource);
+		size_t bytes = 0;
+		obs_enter_graphics();
+		switch (gs_get_texture_type(texture)) {
+		case GS_TEXTURE_2D:
+			bytes = (size_t)gs_texture_get_width(texture) *
+				gs_texture_get_height(texture) *
+				gs_get_format_bpp(gs_texture_get_color_format(texture)) / 8;
+			break;
+		case GS_TEXTURE_3D:
+			bytes = (size_t)gs_voltexture_get_width(texture) *
+				gs_voltexture_get_height(texture) *
+				gs_voltexture_get_depth(texture) *
+				gs_get_format_bpp(gs_voltexture_get_color_format(texture)) / 8;
+			break;
+		case GS_TEXTURE_CUBE:
+		{
+			size_t size = gs_cubetexture_get_size(texture);
+			bytes = size * size * 6 *
+				gs_get_format_bpp(gs_cubetexture_get_color_format(texture)) / 8;
+		}
+		break;
+		}
+		obs_leave_graphics();
+		return bytes;
+	}
+	case CacheableType::Effect:
+		return EFFECT_SIZE_ESTIMATE;
+	case CacheableType::OBSData:
+	case CacheableType::MeshBuffers:
+		break;
+	}
+	return 0;
+}
 
 bool Mask::Resource::Cache::add_permanent(CacheableType resource_type, std::string name, void *resource) {
+	std::unique_lock<std::mutex> lock(m_mutex);
 	auto pool_it = permanent_cache.find(name);
 	if (pool_it == permanent_cache.end()) {
 		permanent_cache[name] = std::make_pair(resource_type, resource);
@@ -205,123 +282,73 @@ bool Mask::Resource::Cache::add_permanent(CacheableType resource_type, std::stri
 	return false;
 }
 
-bool Mask::Resource::Cache::add(CacheableType resource_type, std::string name, void *resource) {
-	auto pool_it = pool_map.find(resource_type);
-	if (pool_it == pool_map.end()) {
-		pool_map[resource_type] = CachePool();
-		pool_it = pool_map.find(resource_type);
-	}
-	CachePool &pool = pool_it->second;
+bool Mask::Resource::Cache::add(CacheableType resource_type, std::string name, void *resource, size_t bytes) {
+	if (resource == nullptr)
+		return false;
+	if (bytes == 0)
+		bytes = estimate_size(resource_type, resource);
 
-	auto it = pool.find(name);
-	if (it != pool.end()) {
-		if (it->second.resource != nullptr)
-		{
-			if (it->second.active_count == 0) {
-				// no one is using the old one
-				// probably a name clash from an older mask load
-				// can safely replace
-				//blog(LOG_DEBUG, "Caching resource (replacing inactive older version): %s", name.c_str());
-				pool[name] = CacheItem(resource);
-				return true;
-			}
-			else
-				throw "Incorrect use of add before calling load";
-		}
-		else {
-			//blog(LOG_DEBUG, "Caching resource (re-bind): %s", name.c_str());
-			pool[name] = CacheItem(resource);
-			return true;
-		}
-	}
-	else if (pool.size() < POOL_SIZE)
+	std::vector<CacheItem> evicted;
+	bool added = false;
 	{
-		//blog(LOG_DEBUG, "Caching resource: %s", name.c_str());
-		pool[name] = CacheItem(resource);
-		return true;
-	}
-	else
-	{
-		// remove the least re-used resource
-		auto min_it = pool.begin();
-		size_t min_ref = min_it->second.use_count;
-		for (auto it = pool.begin(); it != pool.end(); it++)
-		{
-			if (min_ref > it->second.use_count)
-			{
-				min_ref = it->second.use_count;
-				min_it = it;
-			}
-		}
-		// if the least re-used resource is actively used
-		// by 2 or more, we cannot remove it
-		// let's search for the currently least active resource
-		if (min_it->second.active_count > 2)
-		{
-			min_it = pool.begin();
-			min_ref = min_it->second.active_count;
-			for (auto it = pool.begin(); it != pool.end(); it++)
-			{
-				if (min_ref > it->second.active_count)
-				{
-					min_ref = it->second.active_count;
-					min_it = it;
-				}
-			}
-		}
-
-		//blog(LOG_DEBUG, "Pool full. Removing least used/active resource: %s, #active = %d, #use = %d",
-		//	min_it->first.c_str(), min_it->second.active_count, min_it->second.use_count);
+		std::unique_lock<std::mutex> lock(m_mutex);
+		std::string key = make_key(resource_type, name);
 
-		if (min_it->second.active_count == 1)
-		{
-			// only remove from the pool
-			// the one active user will
-			// correctly destruct the resource
-			pool.erase(min_it);
-		}
-		else if (min_it->second.active_count == 0)
-		{
-			// no one were using this resource
-			// let's destruct it ourselves
-			destruct_by_type(min_it->second.resource, resource_type);
-			pool.erase(min_it);
+		// another loader got there first. the caller keeps
+		// its own copy, and try_destroy_resource frees it.
+		if (m_active.find(key) != m_active.end()) {
+			PLOG_DEBUG("Resource cache: '%s' is already cached.", name.c_str());
 		}
-		else
-		{
-			// sorry we cannot cache
-			// the pool is full and
-			// no one can leave it currently
-			//blog(LOG_DEBUG, "Caching failed because the pool is full, and no one is willing to leave. Resource: %s", name.c_str());
-			return false;
+		else {
+			// an idle one with the same name is from an older mask load
+			CacheItem old;
+			if (m_idle.take(key, old))
+				evicted.push_back(old);
+
+			CacheItem item;
+			item.type = resource_type;
+			item.resource = resource;
+			item.bytes = bytes;
+			item.active_count = 1;
+			m_active[key] = item;
+			m_active_bytes += bytes;
+			trim(evicted);
+			added = true;
 		}
-
-		//blog(LOG_DEBUG, "Caching resource: %s", name.c_str());
-
-		pool[name] = CacheItem(resource);
-
-		return true;
 	}
+	destruct_items(evicted);
+	return added;
 }
 
 void Mask::Resource::Cache::load(CacheableType resource_type, std::string name, void **resource_ptr) {
-	auto pool_it = pool_map.find(resource_type);
-	if (pool_it == pool_map.end()) {
-		*resource_ptr = nullptr;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	std::string key = make_key(resource_type, name);
+
+	auto it = m_active.find(key);
+	if (it != m_active.end()) {
+		it->second.active_count++;
+		*resource_ptr = it->second.resource;
+		m_hits++;
 		return;
 	}
-	CachePool &pool = pool_it->second;
-	if (pool.find(name) != pool.end()) {
-		//blog(LOG_DEBUG, "Re-using resource: %s", name.c_str());
-		pool[name].active_count++;
-		pool[name].use_count++;
-		*resource_ptr = pool[name].resource;
+
+	// wake up an idle one
+	CacheItem item;
+	if (m_idle.take(key, item)) {
+		item.active_count = 1;
+		m_active[key] = item;
+		m_active_bytes += item.bytes;
+		*resource_ptr = item.resource;
+		m_hits++;
+		return;
 	}
-	else
-		*resource_ptr = nullptr;
+
+	*resource_ptr = nullptr;
+	m_misses++;
 }
 
 void Mask::Resource::Cache::load_permanent(std::string name, void **resource_ptr) {
+	std::unique_lock<std::mutex> lock(m_mutex);
 	auto item = permanent_cache.find(name);
 	if (item != permanent_cache.end()) {
 		*resource_ptr = item->second.second;
@@ -330,6 +357,41 @@ void Mask::Resource::Cache::load_permanent(std::string name, void **resource_ptr
 		*resource_ptr = nullptr;
 }
 
+void Mask::Resource::Cache::reserve_default(const std::string& name) {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_defaults[name] = nullptr;
+}
+
+void Mask::Resource::Cache::add_default(const std::string& name, std::shared_ptr<IBase> resource) {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (resource)
+		m_defaults[name] = resource;
+	else
+		m_defaults.erase(name);
+}
+
+bool Mask::Resource::Cache::load_default(const std::string& name, std::shared_ptr<IBase>& resource) {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto it = m_defaults.find(name);
+	if (it == m_defaults.end())
+		return false;
+	resource = it->second;
+	return true;
+}
+
+void Mask::Resource::Cache::clear_defaults() {
+	// resources hand their gpu objects back to us when they go,
+	// so release them outside the lock
+	std::map<std::string, std::shared_ptr<IBase>> defaults;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		defaults.swap(m_defaults);
+	}
+	obs_enter_graphics();
+	defaults.clear();
+	obs_leave_graphics();
+}
+
 void Mask::Resource::Cache::destruct_by_type(void *resource, CacheableType resource_type) {
 	if (resource == nullptr) return;
 
@@ -365,49 +427,117 @@ void Mask::Resource::Cache::destruct_by_type(void *resource, CacheableType resou
 		obs_data_release(data);
 	}
 	break;
+	case CacheableType::MeshBuffers:
+	{
+		MeshBuffers *buffers = reinterpret_cast<MeshBuffers*>(resource);
+		delete buffers;
+	}
+	break;
 	}
 	obs_leave_graphics();
 }
 
 void Mask::Resource::Cache::try_destroy_resource(std::string name, void *resource, CacheableType resource_type) {
-	// only destroy if the resource is not managed by the pool
-	auto pool_it = pool_map.find(resource_type);
-	if (pool_it == pool_map.end()) return;
-	CachePool &pool = pool_it->second;
-
-	auto it = pool.find(name);
-	if (it == pool.end()) {
-		destruct_by_type(resource, resource_type);
+	if (resource == nullptr) return;
+
+	std::vector<CacheItem> evicted;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		auto it = m_active.find(make_key(resource_type, name));
+		if (it == m_active.end() || it->second.resource != resource) {
+			// not managed by the cache
+			lock.unlock();
+			destruct_by_type(resource, resource_type);
+			return;
+		}
+
+		if (--it->second.active_count == 0) {
+			// last user is done, keep it around until
+			// the budget needs the room
+			CacheItem item = it->second;
+			m_active_bytes -= item.bytes;
+			std::string key = it->first;
+			m_active.erase(it);
+			m_idle.put(key, item, item.bytes, evicted);
+			trim(evicted);
+		}
 	}
-	else {
-		//blog(LOG_DEBUG, "Delaying destroying managed resource: %s, #active = %d", name.c_str(), it->second.active_count);
-		it->second.active_count--;
+	destruct_items(evicted);
+}
+
+void Mask::Resource::Cache::trim(std::vector<CacheItem>& evicted) {
+	// idle items get whatever the items in use leave over
+	size_t before = evicted.size();
+	size_t idle_budget = m_budget > m_active_bytes ? m_budget - m_active_bytes : 0;
+	m_idle.set_budget(idle_budget, evicted);
+	m_evictions += evicted.size() - before;
+}
+
+void Mask::Resource::Cache::destruct_items(std::vector<CacheItem>& items) {
+	if (items.empty())
+		return;
+	obs_enter_graphics();
+	for (auto &item : items)
+		destruct_by_type(item.resource, item.type);
+	obs_leave_graphics();
+	items.clear();
+}
+
+void Mask::Resource::Cache::set_budget(size_t bytes) {
+	std::vector<CacheItem> evicted;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_budget = bytes;
+		trim(evicted);
 	}
+	destruct_items(evicted);
+}
+
+size_t Mask::Resource::Cache::get_budget() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_budget;
+}
+
+Mask::Resource::Cache::Stats Mask::Resource::Cache::get_stats() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	Stats stats;
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	stats.evictions = m_evictions;
+	stats.idle_items = m_idle.size();
+	stats.idle_bytes = m_idle.cost();
+	stats.items = m_active.size() + stats.idle_items;
+	stats.bytes = m_active_bytes + stats.idle_bytes;
+	return stats;
 }
 
 void Mask::Resource::Cache::destroy() {
-	obs_enter_graphics();
+	clear_defaults();
 
-	// destroy pool-managed caches
-	for (auto &pool_ent : pool_map)
+	std::vector<CacheItem> items;
+	std::vector<PermanentResource> permanent;
 	{
-		CachePool &pool = pool_ent.second;
-		for (auto &ent : pool) {
-			//blog(LOG_DEBUG, "Cache Destroy: destroying managed resource: %s", ent.first.c_str());
-			destruct_by_type(ent.second.resource, pool_ent.first);
-			ent.second.resource = nullptr;
-		}
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (auto &ent : m_active)
+			items.push_back(ent.second);
+		m_active.clear();
+		m_active_bytes = 0;
+		m_idle.clear(items);
+		for (auto &ent : permanent_cache)
+			permanent.push_back(ent.second);
+		permanent_cache.clear();
 	}
 
+	obs_enter_graphics();
+
+	// destroy pool-managed resources
+	destruct_items(items);
+
 	// destroy permanent cache
-	for (auto &ent : permanent_cache) {
-		//blog(LOG_DEBUG, "Cache Destroy: destroying permanent resource: %s", ent.first.c_str());
-		// ent.second = pair<CacheableType, void *resource>
-		destruct_by_type(ent.second.second, ent.second.first);
-		ent.second.second = nullptr;
+	for (auto &ent : permanent) {
+		// ent = pair<CacheableType, void *resource>
+		destruct_by_type(ent.second, ent.first);
 	}
 
 	obs_leave_graphics();
-
 }
-
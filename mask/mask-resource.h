@@ -22,7 +22,10 @@
 #include <map>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
+#include "plugin/lru-cache.h"
 extern "C" {
 	#pragma warning( push )
 	#pragma warning( disable: 4201 )
@@ -36,6 +39,8 @@ namespace Mask {
 	class Part;
 
 	namespace Resource {
+		class IBase;
+
 		enum class Type : uint32_t {
 			Image,
 			Sequence,
@@ -51,43 +56,43 @@ namespace Mask {
 			Animation,
 		};
 
+		// Cache : shared gpu resources (textures, effects), by name
+		//
+		// - users load() a resource, or create it and add() it, and
+		//   hand it back with try_destroy_resource() when done
+		// - resources nobody is using stay cached (idle), and are
+		//   evicted least recently used first once the cache goes
+		//   over its byte budget. resources in use are never evicted.
+		// - thread safe. gpu objects are destroyed outside the lock.
+		//
 		class Cache {
 		public:
-			// each cache pool will try to cap at this number
-			static const size_t POOL_SIZE;
-
-			struct CacheItem {
-				// if a resource is used many times
-				// we should try to keep it in the pool
-				size_t use_count;
-				// if we want a resource to leave the pool
-				// the number of instances this resource is
-				// actively used in will tell us if it is safe
-				// for it to leave the pool.
-				// e.g. if no one is using it, no one will
-				// care. if one is using it, that
-				// resource will take care of destructing
-				// but if two are using it, it
-				// is unsafe, as both of them will try to
-				// destruct the same resource
-				size_t active_count;
-				void *resource;
-				CacheItem():resource(nullptr) {}
-				CacheItem(void *resource) :resource(resource) {
-					active_count = use_count = 1;
-				}
-			};
-			// map < resource name, cache item >
-			using CachePool = std::map<std::string, CacheItem>;
+			// default budget for the whole cache
+			static const size_t DEFAULT_BUDGET;
 
 			enum class CacheableType {
 				Texture,
 				Effect,
-				OBSData
+				OBSData,
+				MeshBuffers
 			};
 			using PermanentResource = std::pair<CacheableType, void*>;
-			 
-			bool add(CacheableType resource_type, std::string name, void *resource);
+
+			struct Stats {
+				size_t hits;
+				size_t misses;
+				size_t evictions;
+				// everything cached, in use or idle
+				size_t items;
+				size_t bytes;
+				size_t idle_items;
+				size_t idle_bytes;
+			};
+
+			Cache();
+
+			// bytes = 0 estimates the size from the resource
+			bool add(CacheableType resource_type, std::string name, void *resource, size_t bytes = 0);
 			bool add_permanent(CacheableType resource_type, std::string name, void *resource);
 
 			void load(CacheableType resource_type, std::string name, void **resource_ptr);
@@ -96,9 +101,45 @@ namespace Mask {
 			void destruct_by_type(void *resource, CacheableType resource_type);
 			void try_destroy_resource(std::string name, void *resource, CacheableType resource_type);
 			void destroy();
+
+			void set_budget(size_t bytes);
+			size_t get_budget();
+			Stats get_stats();
+
+			// Default resources preloaded in the background (environment
+			// maps), shared by every mask. A reserved name is still loading,
+			// load_default then returns true with a null resource. Adding a
+			// null resource drops the reservation.
+			void reserve_default(const std::string& name);
+			void add_default(const std::string& name, std::shared_ptr<IBase> resource);
+			bool load_default(const std::string& name, std::shared_ptr<IBase>& resource);
+			void clear_defaults();
+
 		private:
-			std::map<CacheableType, CachePool> pool_map;
-			std::map<std::string, PermanentResource> permanent_cache;
+			struct CacheItem {
+				CacheableType	type;
+				void*			resource;
+				size_t			bytes;
+				// number of users, only items nobody uses can leave
+				size_t			active_count;
+			};
+			using IdleCache = Utils::LRUCache<std::string, CacheItem>;
+
+			std::mutex									m_mutex;
+			size_t										m_budget;
+			size_t										m_active_bytes;
+			std::map<std::string, CacheItem>			m_active;
+			IdleCache									m_idle;
+			std::map<std::string, PermanentResource>	permanent_cache;
+			std::map<std::string, std::shared_ptr<IBase>>	m_defaults;
+			size_t										m_hits;
+			size_t										m_misses;
+			size_t										m_evictions;
+
+			static std::string make_key(CacheableType resource_type, const std::string& name);
+			static size_t estimate_size(CacheableType resource_type, void *resource);
+			void trim(std::vector<CacheItem>& evicted);
+			void destruct_items(std::vector<CacheItem>& items);
 		};
 
 		class IBase {
@@ -106,6 +147,10 @@ namespace Mask {
 			using CacheableType = Cache::CacheableType;
 			static std::shared_ptr<IBase> Load(Mask::MaskData* parent, std::string name, obs_data_t* data, Cache *cache);
 			static std::shared_ptr<IBase> LoadDefault(Mask::MaskData* parent, std::string name, Cache *cache);
+			// CPU-only part of Load, safe to run on a worker thread. Returns
+			// nullptr for types that can't be decoded ahead of time. Call
+			// CreateGS() on the loading thread before using the resource.
+			static std::shared_ptr<IBase> Decode(Mask::MaskData* parent, std::string name, obs_data_t* data, Cache *cache);
 
 		protected:
 			IBase(Mask::MaskData* parent, std::string name);
@@ -122,6 +167,12 @@ namespace Mask {
 			virtual bool IsDepthOnly() { return false; }
 			virtual bool IsStatic() { return false; }
 			virtual bool IsRotationDisabled() { return false; }
+			// draws every face of a draw command itself, with the
+			// state bound once. see MaskData::SetDrawInstance
+			virtual bool CanDrawInstanced() { return false; }
+			virtual void CreateGS() {}
+			// approximate gpu + cpu bytes held by this resource
+			virtual size_t GetMemorySize() { return 0; }
 
 		protected:
 			Mask::MaskData* m_parent;
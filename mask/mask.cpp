@@ -17,7 +17,9 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
  */
 
+#define NOMINMAX
 #include "mask.h"
+#include "mask-resource-image.h"
 #include "mask-resource-model.h"
 #include "mask-resource-material.h"
 #include "mask-resource-animation.h"
@@ -27,6 +29,8 @@
 #include "plugin/plugin.h"
 #include "plugin/utils.h"
 
+#include <algorithm>
+#include <atomic>
 #include <set>
 
 static float FOVA(float aspect) {
@@ -37,7 +41,7 @@ static float FOVA(float aspect) {
 Mask::Part::Part(std::shared_ptr<Part> p_parent,
 	std::shared_ptr<Resource::IBase> p_resource) :
 	parent(p_parent), 
-	localdirty(true), dirty(true), isquat(false) {
+	localdirty(true), isquat(false) {
 	vec3_zero(&position);
 	vec3_zero(&rotation);
 	vec3_set(&scale, 1, 1, 1);
@@ -101,24 +105,32 @@ static const char* const JSON_INTRO_FADE_TIME = "intro_fade_time";
 static const char* const JSON_INTRO_DURATION = "intro_duration";
 
 
-static const int NUM_DRAW_BUCKETS = 1024;
-static const float BUCKETS_MAX_Z = 10.0f;
-static const float BUCKETS_MIN_Z = -100.0f;
+static const unsigned int MAX_DECODE_THREADS = 8;
 
-Mask::MaskData::MaskData(Cache *cache) : m_data(nullptr), m_morph(nullptr),
-m_cache(cache), m_elapsedTime(0.0f) {
-	m_drawBuckets = new Mask::SortedDrawObject*[NUM_DRAW_BUCKETS];
-	ClearSortedDrawObjects();
+Mask::MaskData::MaskData(Cache *cache) : m_partGraphDirty(true), m_data(nullptr),
+m_currentDraw(nullptr), m_morph(nullptr), m_cache(cache), m_elapsedTime(0.0f) {
 	m_vidLightTex = nullptr;
 	m_num_render_layers = 1;
 	m_num_render_orders = 1;
 }
 
 Mask::MaskData::~MaskData() {
-	delete[] m_drawBuckets;
 	Clear();
 }
 
+bool Mask::MaskData::GetBlob(const char* value, const uint8_t** data, size_t* size) {
+	if (!m_binary)
+		return false;
+	return m_binary->GetBlob(value, data, size);
+}
+
+size_t Mask::MaskData::GetMemorySize() {
+	size_t bytes = 0;
+	for (auto &kv : m_resources)
+		bytes += kv.second->GetMemorySize();
+	return bytes;
+}
+
 bool Mask::MaskData::NeedsPBRLighting() {
 	for (auto &kv : m_resources) {
 		if (kv.second->GetType() == Resource::Type::Material)
@@ -132,11 +144,14 @@ bool Mask::MaskData::NeedsPBRLighting() {
 
 void Mask::MaskData::Clear() {
 	m_parts.clear();
+	m_partGraphDirty = true;
 	m_resources.clear();
+	m_decodedResources.clear();
 	if (m_data) {
 		obs_data_release(m_data);
 		m_data = nullptr;
 	}
+	m_binary.reset();
 	m_morph = nullptr;
 }
 
@@ -145,7 +160,20 @@ void Mask::MaskData::Load(const std::string& file) {
 		obs_data_release(m_data);
 		m_data = nullptr;
 	}
-	m_data = obs_data_create_from_json_file(file.c_str());
+	m_binary.reset();
+	if (MappedMaskFile::IsCompiled(file)) {
+		try {
+			m_binary = std::make_unique<MappedMaskFile>(file);
+		}
+		catch (const std::exception& e) {
+			PLOG_ERROR("Cannot load compiled mask '%s': %s", file.c_str(), e.what());
+			throw std::ios_base::failure(file);
+		}
+		m_data = obs_data_create_from_json(m_binary->GetJson());
+	}
+	else {
+		m_data = obs_data_create_from_json_file(file.c_str());
+	}
 	if (!m_data)
 		throw std::ios_base::failure(file);
 
@@ -202,6 +230,9 @@ void Mask::MaskData::Load(const std::string& file) {
 	// yield
 	::Sleep(0);
 
+	// Decode images and meshes in parallel first, GetResource picks them up
+	DecodeResources();
+
 	// Loading is implemented through lazy loading. Only things that are used by
 	// parts and referenced resources will be available, which should improve
 	// load speed and also reduce memory footprint.
@@ -257,6 +288,9 @@ void Mask::MaskData::Load(const std::string& file) {
 		obs_data_release(resources);
 	}
 
+	// decoded, but never referenced
+	m_decodedResources.clear();
+
 	// iterate resources and renumber render layer and order
 	// this will help with both avoid illegal order numbers
 	// and wasting space when layers/orders have gap between them
@@ -309,6 +343,75 @@ void Mask::MaskData::Load(const std::string& file) {
 
 }
 
+// DecodeResources
+//
+// Images and meshes don't depend on other resources, so their CPU
+// work (base64, zlib, png, obj, tangents) is done here on a few worker
+// threads. GS objects are still made one at a time on the loading
+// thread, when GetResource first asks for the resource.
+//
+void Mask::MaskData::DecodeResources() {
+	m_decodedResources.clear();
+
+	struct Job {
+		std::string name;
+		obs_data_t* data;
+		std::shared_ptr<Resource::IBase> resource;
+	};
+	std::vector<Job> jobs;
+
+	obs_data_t* resources = obs_data_get_obj(m_data, JSON_RESOURCES);
+	if (!resources)
+		return;
+	for (obs_data_item_t* el = obs_data_first(resources); el; obs_data_item_next(&el)) {
+		obs_data_t* resd = obs_data_item_get_obj(el);
+		if (!resd)
+			continue;
+		std::string type = obs_data_get_string(resd, JSON_TYPE);
+		if (type == "image" || type == "mesh")
+			jobs.push_back({ obs_data_item_get_name(el), resd, nullptr });
+		else
+			obs_data_release(resd);
+	}
+	obs_data_release(resources);
+	if (jobs.size() == 0)
+		return;
+
+	std::atomic<size_t> next(0);
+	auto worker = [&]() {
+		for (size_t i = next++; i < jobs.size(); i = next++) {
+			try {
+				jobs[i].resource = Resource::IBase::Decode(this, jobs[i].name,
+					jobs[i].data, GetCache());
+			}
+			catch (...) {
+				// GetResource will load it (and report it) the slow way
+			}
+		}
+	};
+
+	// this thread works too
+	unsigned int numThreads = std::max(1U, std::thread::hardware_concurrency());
+	numThreads = std::min(numThreads, std::min(MAX_DECODE_THREADS, (unsigned int)jobs.size()));
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < numThreads; i++) {
+		threads.emplace_back([&worker]() {
+			// same as the mask loading thread
+			SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+			worker();
+		});
+	}
+	worker();
+	for (auto& t : threads)
+		t.join();
+
+	for (auto& job : jobs) {
+		if (job.resource)
+			m_decodedResources[job.name] = job.resource;
+		obs_data_release(job.data);
+	}
+}
+
 void Mask::MaskData::AddResource(const std::string& name, std::shared_ptr<Mask::Resource::IBase> resource) {
 	if (name.length() == 0)
 		throw std::invalid_argument("name must be at least one character long");
@@ -344,6 +447,18 @@ std::shared_ptr<Mask::Resource::IBase> Mask::MaskData::GetResource(const std::st
 		}
 	}
 
+	// Preloaded default resources (environment maps), or a stand-in
+	// while they are still loading
+	{
+		std::shared_ptr<Mask::Resource::IBase> p;
+		if (GetCache()->load_default(name, p)) {
+			if (!p)
+				p = std::make_shared<Mask::Resource::Image>(this, name, GetCache());
+			this->AddResource(res_name, p);
+			return p;
+		}
+	}
+
 	// Default Resources
 	std::shared_ptr<Mask::Resource::IBase> p = Resource::IBase::LoadDefault(this, name, GetCache());
 	if (p) {
@@ -361,6 +476,22 @@ std::shared_ptr<Mask::Resource::IBase> Mask::MaskData::GetResource(const std::st
 		return p;
 	}
 
+	// Decoded ahead of time?
+	auto dr = m_decodedResources.find(res_name);
+	if (dr != m_decodedResources.end()) {
+		std::shared_ptr<Mask::Resource::IBase> res = dr->second;
+		m_decodedResources.erase(dr);
+		try {
+			res->CreateGS();
+		}
+		catch (...) {
+			PLOG_DEBUG("Resource %s has THROWN AN EXCEPTION. MASK DID NOT LOAD CORRECTLY.", res_name.c_str());
+			return nullptr;
+		}
+		this->AddResource(res_name, res);
+		return res;
+	}
+
 	// yield
 	::Sleep(0);
 
@@ -475,6 +606,7 @@ void Mask::MaskData::AddPart(const std::string& name, std::shared_ptr<Mask::Part
 	part->hash_id = hasher(name);
 	part->name = name;
 	m_parts.emplace(name, part);
+	m_partGraphDirty = true;
 }
 
 std::shared_ptr<Mask::Part> Mask::MaskData::GetPart(const std::string& name) {
@@ -536,6 +668,7 @@ std::shared_ptr<Mask::Part> Mask::MaskData::RemovePart(const std::string& name)
 	if (kv != m_parts.end()) {
 		el = kv->second;
 		m_parts.erase(kv);
+		m_partGraphDirty = true;
 	}
 	return el;
 }
@@ -559,46 +692,63 @@ std::shared_ptr<Mask::Part> Mask::MaskData::GetPart(int index) {
 
 
 
-void  Mask::MaskData::ClearSortedDrawObjects() {
-	SortedDrawObject** sdo = m_drawBuckets;
-	for (unsigned int i = 0; i < NUM_DRAW_BUCKETS; i++) {
-		*sdo = nullptr;
-		sdo++;
+void  Mask::MaskData::AddSortedDrawObject(SortedDrawObject* obj) {
+	// only called while a draw command is being submitted, the
+	// object is drawn later with that command's faces
+	if (!m_currentDraw)
+		return;
+
+	obj->instanceId = instanceDatas.CurrentId();
+
+	// one sorted command per face, at that face's depth, so an
+	// instanced draw still sorts correctly against other faces.
+	// neighbours in the sorted list batch back together.
+	for (uint32_t instance : m_currentInstances) {
+		gs_matrix_push();
+		gs_matrix_set(&m_drawInstances[instance].world);
+		float z = obj->SortDepth() + obj->m_depth_bias;
+		gs_matrix_pop();
+
+		// render order, then back to front
+		uint64_t key = ((uint64_t)SortKeyInt(obj->m_render_order) << 32) | SortKeyFloat(z);
+
+		DrawCommand& cmd = m_sortedDrawList.add(key);
+		cmd.part = obj->sortDrawPart;
+		cmd.resource = dynamic_cast<Resource::IBase*>(obj);
+		cmd.sorted = obj;
+		cmd.instanceId = obj->instanceId;
+		cmd.firstInstance = instance;
+		cmd.numInstances = 1;
+		cmd.batch = true;
 	}
 }
 
-void  Mask::MaskData::AddSortedDrawObject(SortedDrawObject* obj) {
-	float z = obj->SortDepth() + obj->m_depth_bias;
-	if (z > BUCKETS_MAX_Z)
-		z = BUCKETS_MAX_Z;
-	if (z < BUCKETS_MIN_Z)
-		z = BUCKETS_MIN_Z;
-	z = (z - BUCKETS_MIN_Z) / (BUCKETS_MAX_Z - BUCKETS_MIN_Z);
-	int idx = (int)(z * (float)(NUM_DRAW_BUCKETS - 1));
-
-	if (m_drawBuckets[idx] != nullptr)
-	{
-		float z2=m_drawBuckets[idx]->SortDepth();
-		if (z < z2)
-		{
-			// add new obj before current
-			obj->nextDrawObject = m_drawBuckets[idx];
-			m_drawBuckets[idx] = obj;
-		}
-		else
-		{
-			// add it after current
-			obj->nextDrawObject = m_drawBuckets[idx]->nextDrawObject;
-			m_drawBuckets[idx]->nextDrawObject = obj;
-		}
-	}
-	else {
-		obj->nextDrawObject = m_drawBuckets[idx]; // which is nullptr
-		m_drawBuckets[idx] = obj;
-	}
+uint32_t Mask::MaskData::AddDrawInstance(const matrix4* world, float alpha) {
+	m_drawInstances.emplace_back();
+	DrawInstance& inst = m_drawInstances.back();
+	matrix4_copy(&inst.face, world);
+	matrix4_copy(&inst.world, world);
+	inst.alpha = alpha;
+	return (uint32_t)m_drawInstances.size() - 1;
+}
+
+void Mask::MaskData::AddSortedDrawInstance(SortedDrawObject* obj, float depth, uint32_t instance) {
+	if (!m_currentDraw)
+		return;
 
 	obj->instanceId = instanceDatas.CurrentId();
 
+	float z = depth + obj->m_depth_bias;
+	uint64_t key = ((uint64_t)SortKeyInt(obj->m_render_order) << 32) | SortKeyFloat(z);
+
+	DrawCommand& cmd = m_sortedDrawList.add(key);
+	cmd.part = obj->sortDrawPart;
+	cmd.resource = dynamic_cast<Resource::IBase*>(obj);
+	cmd.sorted = obj;
+	cmd.instanceId = obj->instanceId;
+	cmd.firstInstance = instance;
+	cmd.numInstances = 1;
+	cmd.batch = true;
 }
 
 void Mask::MaskData::Decompose(const matrix4 *src, vec3 *s, matrix4 *R, vec3 *t)
@@ -632,190 +782,230 @@ void Mask::MaskData::Decompose(const matrix4 *src, vec3 *s, matrix4 *R, vec3 *t)
 
 }
 
-void  Mask::MaskData::PartCalcMatrix(Part *part) {
-
-	// Only if we're dirty
-	if (part->dirty) {
-		Mask::Part* current_part = part;
-
-		// pre-check dirty status for the local chain
-		// we check if *any* of local transform nodes are dirty
-		// if there's one, we will recalculate the local matrix
-		bool local_chain_dirty = true;
-		Mask::Part* temp_part = part;
-		do {
-			if (temp_part->localdirty) {
-				local_chain_dirty = true;
-				break;
+void Mask::MaskData::BuildPartGraph() {
+	m_partList.clear();
+	m_partNodes.clear();
+	m_partChains.clear();
+
+	std::unordered_map<Part*, int> index;
+	for (auto& kv : m_parts) {
+		m_partList.push_back(kv.second.get());
+		if (kv.second->local_to.length() == 0)
+			AddPartNode(kv.second.get(), index);
+	}
+
+	// everything gets calculated on the next update
+	for (auto& node : m_partNodes)
+		node.part->localdirty = true;
+	for (Part* part : m_partChains)
+		part->localdirty = true;
+
+	m_partChanged.resize(m_partNodes.size());
+	m_partGraphDirty = false;
+}
+
+int Mask::MaskData::AddPartNode(Part* part, std::unordered_map<Part*, int>& index) {
+	auto it = index.find(part);
+	if (it != index.end())
+		return it->second;
+	// guards against parent loops
+	index.emplace(part, -1);
+
+	// the local chain: parents that are local transformations
+	// for this part get folded into its local matrix
+	PartNode node;
+	node.part = part;
+	node.chainBegin = (uint32_t)m_partChains.size();
+	Part* parent = part->parent.get();
+	while (parent && parent->local_to.length() > 0 && parent->local_to == part->name) {
+		m_partChains.push_back(parent);
+		parent = parent->parent.get();
+	}
+	node.chainEnd = (uint32_t)m_partChains.size();
+
+	// parents first
+	node.parent = parent ? AddPartNode(parent, index) : -1;
+
+	int which = (int)m_partNodes.size();
+	m_partNodes.push_back(node);
+	index[part] = which;
+	return which;
+}
+
+void Mask::MaskData::UpdatePartTransforms() {
+	for (size_t i = 0; i < m_partNodes.size(); i++) {
+		const PartNode& node = m_partNodes[i];
+		Part* part = node.part;
+
+		bool localChanged = part->localdirty;
+		for (uint32_t c = node.chainBegin; c < node.chainEnd && !localChanged; c++)
+			localChanged = m_partChains[c]->localdirty;
+		bool parentChanged = node.parent >= 0 && m_partChanged[node.parent];
+
+		m_partChanged[i] = localChanged || parentChanged;
+		if (!m_partChanged[i])
+			continue;
+
+		if (localChanged) {
+			PartCalcLocal(part);
+			for (uint32_t c = node.chainBegin; c < node.chainEnd; c++) {
+				Part* local = m_partChains[c];
+				PartCalcLocal(local);
+				matrix4_mul(&part->local, &part->local, &local->local);
 			}
-			temp_part = temp_part->parent.get();
-		}
-		while (temp_part && temp_part->local_to.length() > 0 && temp_part->local_to == part->name);
-
-
-		if (local_chain_dirty) {
-			do {
-				// Calculate local matrix
-				matrix4_identity(&current_part->local);
-
-				matrix4_scale3f(&current_part->local, &current_part->local,
-					current_part->scale.x, current_part->scale.y, current_part->scale.z);
-				if (current_part->isquat) {
-					matrix4 qm;
-					matrix4_from_quat(&qm, &current_part->qrotation);
-					matrix4_mul(&current_part->local, &current_part->local, &qm);
-				}
-				else {
-					matrix4_rotate_aa4f(&current_part->local, &current_part->local,
-						1.0f, 0.0f, 0.0f, current_part->rotation.x);
-					matrix4_rotate_aa4f(&current_part->local, &current_part->local,
-						0.0f, 1.0f, 0.0f, current_part->rotation.y);
-					matrix4_rotate_aa4f(&current_part->local, &current_part->local,
-						0.0f, 0.0f, 1.0f, current_part->rotation.z);
-				}
-				matrix4_translate3f(&current_part->local, &current_part->local,
-					current_part->position.x, current_part->position.y, current_part->position.z);
-
-				current_part->localdirty = false;
-
-				// a local child node?
-				if (current_part != part)
-					matrix4_mul(&part->local, &part->local, &current_part->local);
-
-				current_part = current_part->parent.get();
-
-			} while (current_part && current_part->local_to.length() > 0 && current_part->local_to == part->name);
 		}
-		// Calculate global
-		matrix4_copy(&part->global, &part->local);
-		if (current_part) {
-			PartCalcMatrix(current_part);
-			if (part->inherit_type == Part::Inherit_RSrs) {
-				matrix4_mul(&part->global, &part->global, &current_part->global);
-			}
-			else {
-				/*
-					The other two types of inherit types are more complex, and need
-					several matrix decompositions. The details of the process can
-					be seen in FBX SDK example here:
-					http://help.autodesk.com/cloudhelp/2018/ENU/FBX-Developer-Help/cpp_ref/_transformations_2main_8cxx-example.html
-
-					Naming reference:
-					L: Local
-					G: Global
-					P: Parent
-					M: Matrix
-					v: Vector
-					R: rotation
-					T: translation
-				*/
-
-				// Local Matrix
-				const matrix4 &LM = part->local;
-				vec3 ls_v, lt_v;
-				matrix4 LR, LS;
-				Decompose(&LM, &ls_v, &LR, &lt_v);
-
-				matrix4_identity(&LS);
-				matrix4_scale(&LS, &LS, &ls_v);
-
-				// Parent Global Matrix
-				const matrix4 &PGM = current_part->global;
-				vec3 pgs_v, pgt_v;
-				matrix4 PGR;
-				Decompose(&PGM, &pgs_v, &PGR, &pgt_v);
-
-				// pgs_v will have scale information
-				// if we need to have shear information as well
-				// we'll have to find PGS matrix using the following:
-				// PGS = PGM * inv_PGT * inv_PGR
-				matrix4 PGS;
-				matrix4_identity(&PGS);
-				matrix4_scale(&PGS, &PGS, &pgs_v);
-
-				// Global Rotation x Scale Matrix
-				matrix4 GSR;
-				matrix4_identity(&GSR);
-
-				if (part->inherit_type == Part::Inherit_Rrs) {
-					
-					// Parent Local Matrix
-					const matrix4 &PLM = current_part->local;
-					vec3 pls_v, plt_v;
-					matrix4 PLR;
-					Decompose(&PLM, &pls_v, &PLR, &plt_v);
-
-					matrix4 PGS_nolocal;
-					matrix4_scale3f(&PGS_nolocal, &PGS, 1 / pls_v.x, 1 / pls_v.y, 1 / pls_v.z);
-
-					// GSR = LS x PGS_nolocal x LR x PGR
-					matrix4_mul(&GSR, &GSR, &LS);
-					matrix4_mul(&GSR, &GSR, &PGS_nolocal);
-					matrix4_mul(&GSR, &GSR, &LR);
-					matrix4_mul(&GSR, &GSR, &PGR);
-				}
-				else if (part->inherit_type == Part::Inherit_RrSs) {
-					// GSR = LS x PGS x LR x PGR
-					matrix4_mul(&GSR, &GSR, &LS);
-					matrix4_mul(&GSR, &GSR, &PGS);
-					matrix4_mul(&GSR, &GSR, &LR);
-					matrix4_mul(&GSR, &GSR, &PGR);
-				}
-
-				vec3 gt_v;
-				matrix4 GT;
-				vec3_transform(&gt_v, &lt_v, &PGM);
-
-				matrix4_identity(&GT);
-				matrix4_translate3v(&GT, &GT, &gt_v);
-
-				matrix4_mul(&part->global, &GSR, &GT);
+		PartCalcGlobal(part, node.parent >= 0 ? m_partNodes[node.parent].part : nullptr);
+	}
 
-			}
+	// cleared afterwards, a part can be in more than one chain
+	for (auto& node : m_partNodes)
+		node.part->localdirty = false;
+	for (Part* part : m_partChains)
+		part->localdirty = false;
+}
+
+void Mask::MaskData::PartCalcLocal(Part* part) {
+	matrix4_identity(&part->local);
+
+	matrix4_scale3f(&part->local, &part->local,
+		part->scale.x, part->scale.y, part->scale.z);
+	if (part->isquat) {
+		// animated rotations are interpolated per component
+		quat q;
+		quat_norm(&q, &part->qrotation);
+		matrix4 qm;
+		matrix4_from_quat(&qm, &q);
+		matrix4_mul(&part->local, &part->local, &qm);
+	}
+	else {
+		matrix4_rotate_aa4f(&part->local, &part->local,
+			1.0f, 0.0f, 0.0f, part->rotation.x);
+		matrix4_rotate_aa4f(&part->local, &part->local,
+			0.0f, 1.0f, 0.0f, part->rotation.y);
+		matrix4_rotate_aa4f(&part->local, &part->local,
+			0.0f, 0.0f, 1.0f, part->rotation.z);
+	}
+	matrix4_translate3f(&part->local, &part->local,
+		part->position.x, part->position.y, part->position.z);
+}
+
+void Mask::MaskData::PartCalcGlobal(Part* part, const Part* parent) {
+	matrix4_copy(&part->global, &part->local);
+	if (!parent)
+		return;
+
+	if (part->inherit_type == Part::Inherit_RSrs) {
+		matrix4_mul(&part->global, &part->global, &parent->global);
+	}
+	else {
+		/*
+			The other two types of inherit types are more complex, and need
+			several matrix decompositions. The details of the process can
+			be seen in FBX SDK example here:
+			http://help.autodesk.com/cloudhelp/2018/ENU/FBX-Developer-Help/cpp_ref/_transformations_2main_8cxx-example.html
+
+			Naming reference:
+			L: Local
+			G: Global
+			P: Parent
+			M: Matrix
+			v: Vector
+			R: rotation
+			T: translation
+		*/
+
+		// Local Matrix
+		const matrix4 &LM = part->local;
+		vec3 ls_v, lt_v;
+		matrix4 LR, LS;
+		Decompose(&LM, &ls_v, &LR, &lt_v);
+
+		matrix4_identity(&LS);
+		matrix4_scale(&LS, &LS, &ls_v);
+
+		// Parent Global Matrix
+		const matrix4 &PGM = parent->global;
+		vec3 pgs_v, pgt_v;
+		matrix4 PGR;
+		Decompose(&PGM, &pgs_v, &PGR, &pgt_v);
+
+		// pgs_v will have scale information
+		// if we need to have shear information as well
+		// we'll have to find PGS matrix using the following:
+		// PGS = PGM * inv_PGT * inv_PGR
+		matrix4 PGS;
+		matrix4_identity(&PGS);
+		matrix4_scale(&PGS, &PGS, &pgs_v);
+
+		// Global Rotation x Scale Matrix
+		matrix4 GSR;
+		matrix4_identity(&GSR);
+
+		if (part->inherit_type == Part::Inherit_Rrs) {
+			
+			// Parent Local Matrix
+			const matrix4 &PLM = parent->local;
+			vec3 pls_v, plt_v;
+			matrix4 PLR;
+			Decompose(&PLM, &pls_v, &PLR, &plt_v);
+
+			matrix4 PGS_nolocal;
+			matrix4_scale3f(&PGS_nolocal, &PGS, 1 / pls_v.x, 1 / pls_v.y, 1 / pls_v.z);
+
+			// GSR = LS x PGS_nolocal x LR x PGR
+			matrix4_mul(&GSR, &GSR, &LS);
+			matrix4_mul(&GSR, &GSR, &PGS_nolocal);
+			matrix4_mul(&GSR, &GSR, &LR);
+			matrix4_mul(&GSR, &GSR, &PGR);
+		}
+		else if (part->inherit_type == Part::Inherit_RrSs) {
+			// GSR = LS x PGS x LR x PGR
+			matrix4_mul(&GSR, &GSR, &LS);
+			matrix4_mul(&GSR, &GSR, &PGS);
+			matrix4_mul(&GSR, &GSR, &LR);
+			matrix4_mul(&GSR, &GSR, &PGR);
 		}
-		part->dirty = false;
+
+		vec3 gt_v;
+		matrix4 GT;
+		vec3_transform(&gt_v, &lt_v, &PGM);
+
+		matrix4_identity(&GT);
+		matrix4_translate3v(&GT, &GT, &gt_v);
+
+		matrix4_mul(&part->global, &GSR, &GT);
+
 	}
 }
 
 void Mask::MaskData::Tick(float time) {
+	if (m_partGraphDirty)
+		BuildPartGraph();
+
 	// update animations with the first Part
-	Part* p = nullptr;
-	for (auto aakv : m_animations) {
+	Part* p = m_partList.empty() ? nullptr : m_partList[0];
+	for (auto& aakv : m_animations) {
 		if (aakv.second) {
-			if (!p) {
-				for (auto kv : m_parts) {
-					p = kv.second.get();
-					break;
-				}
-			}
 			aakv.second->Update(p, time);
 		}
 	}
 
-	// mark parts dirty
-	for (auto kv : m_parts) {
-		kv.second->dirty = true;
-	}
-	// calculate transforms 
-	for (auto kv : m_parts) {
-		if (kv.second->local_to.length() == 0)
-		{
-			PartCalcMatrix(kv.second.get());
-		}
-	}
+	// calculate transforms
+	UpdatePartTransforms();
+
 	// update part resources
-	for (auto kv : m_parts) {
-		instanceDatas.Push(kv.second->hash_id);
-		for (auto it = kv.second->resources.begin();
-			it != kv.second->resources.end(); it++) {
-			(*it)->Update(kv.second.get(), time);
+	for (Part* part : m_partList) {
+		instanceDatas.Push(part->hash_id);
+		for (auto it = part->resources.begin();
+			it != part->resources.end(); it++) {
+			(*it)->Update(part, time);
 		}
 		instanceDatas.Pop();
 	}
 	
 	// DO INTRO ANIMATION FADING
 	if (m_isIntroAnim) {
-		std::shared_ptr<Mask::AlphaInstanceData> aid =
+		Mask::AlphaInstanceData* aid =
 			instanceDatas.GetData<Mask::AlphaInstanceData>(Mask::AlphaInstanceDataId);
 
 		float DF = m_introDuration - m_introFadeTime;
@@ -842,19 +1032,134 @@ void Mask::MaskData::Tick(float time) {
 	m_elapsedTime += time;
 }
 
-void Mask::MaskData::SetTransform(const smll::ThreeDPose& pose, bool billboard)
+void Mask::MaskData::FaceTransform(matrix4* m, const smll::ThreeDPose& pose, bool billboard)
 {
-	gs_matrix_identity();
-	gs_matrix_translate3f((float)pose.translation[0],
-		(float)pose.translation[1], (float)-pose.translation[2]);
+	// same as translate then rotate on the gs matrix stack
+	matrix4_identity(m);
 	if (!billboard) {
-		gs_matrix_rotaa4f((float)pose.rotation[0], (float)pose.rotation[1],
+		matrix4_rotate_aa4f(m, m, (float)pose.rotation[0], (float)pose.rotation[1],
 			(float)-pose.rotation[2], (float)-pose.rotation[3]);
 	}
+	matrix4_translate3f(m, m, (float)pose.translation[0],
+		(float)pose.translation[1], (float)-pose.translation[2]);
+}
+
+void Mask::MaskData::AddDrawCommands(DrawList<DrawCommand>& list, uint64_t key,
+	const DrawCommand& draw, const smll::DetectionResults& faces,
+	bool startPose, bool billboard, bool instanced) {
+	DrawCommand* cmd = nullptr;
+	for (int i = 0; i < faces.length; i++) {
+		// one command for all faces when instanced, otherwise
+		// fall back to one per face
+		if (!cmd || !instanced) {
+			cmd = &list.add(key);
+			*cmd = draw;
+			cmd->firstInstance = (uint32_t)m_drawInstances.size();
+			cmd->numInstances = 0;
+		}
+
+		m_drawInstances.emplace_back();
+		DrawInstance& inst = m_drawInstances.back();
+		FaceTransform(&inst.face, startPose ? faces[i].startPose : faces[i].pose, billboard);
+		matrix4_mul(&inst.world, &draw.part->global, &inst.face);
+		inst.alpha = 1.0f;
+		cmd->numInstances++;
+	}
+}
+
+void Mask::MaskData::BuildDrawList(const smll::DetectionResults &faces, bool depthOnly) {
+	// cpu only, no gs calls in here
+	m_drawList.clear();
+	m_sortedDrawList.clear();
+	m_drawGroups.clear();
+	m_drawInstances.clear();
+
+	DrawCommand draw;
+	draw.sorted = nullptr;
+	draw.batch = false;
+	if (m_partGraphDirty)
+		BuildPartGraph();
+	for (Part* part : m_partList) {
+		draw.part = part;
+		if (draw.part->resources.size() == 0)
+			continue;
+
+		instanceDatas.Push(draw.part->hash_id);
+		draw.instanceId = instanceDatas.CurrentId();
+		instanceDatas.Pop();
+
+		for (auto& res : draw.part->resources) {
+			if (res->IsDepthOnly() != depthOnly) continue;
+			draw.resource = res.get();
+
+			// draws of the same resource go back to back
+			auto group = m_drawGroups.emplace(draw.resource, (uint32_t)m_drawGroups.size());
+
+			// NOTE for some reason, some masks
+			// have their depth head set to static
+			bool startPose = res->IsStatic() && res->IsDepthOnly() == false;
+
+			AddDrawCommands(m_drawList, group.first->second, draw, faces, startPose,
+				res->IsRotationDisabled(), res->CanDrawInstanced());
+		}
+	}
+	m_drawList.sort();
+}
+
+void Mask::MaskData::SubmitDrawList(const DrawList<DrawCommand>& list) {
+	for (size_t i = 0; i < list.size(); i++) {
+		const DrawCommand& cmd = list[i];
+		m_currentInstances.clear();
+		for (uint32_t j = 0; j < cmd.numInstances; j++)
+			m_currentInstances.push_back(cmd.firstInstance + j);
+
+		// batch neighbours of the same object go in one draw
+		while (i + 1 < list.size() && CanBatch(cmd, list[i + 1])) {
+			const DrawCommand& next = list[++i];
+			for (uint32_t j = 0; j < next.numInstances; j++)
+				m_currentInstances.push_back(next.firstInstance + j);
+		}
+
+		const DrawInstance& inst = m_drawInstances[m_currentInstances[0]];
+		instanceDatas.PushDirect(cmd.instanceId);
+		// face transform underneath, skinned models pop back to it
+		gs_matrix_push();
+		gs_matrix_set(&inst.face);
+		gs_matrix_push();
+		gs_matrix_set(&inst.world);
+		m_currentDraw = &cmd;
+		if (cmd.sorted)
+			cmd.sorted->SortedRender();
+		else
+			cmd.resource->Render(cmd.part);
+		m_currentDraw = nullptr;
+		gs_matrix_pop();
+		gs_matrix_pop();
+		instanceDatas.Pop();
+	}
+}
+
+size_t Mask::MaskData::GetNumDrawInstances() {
+	return m_currentDraw ? m_currentInstances.size() : 1;
+}
+
+void Mask::MaskData::SetDrawInstance(size_t which, bool faceOnly) {
+	if (!m_currentDraw || which >= m_currentInstances.size())
+		return;
+	const DrawInstance& inst = m_drawInstances[m_currentInstances[which]];
+	gs_matrix_set(faceOnly ? &inst.face : &inst.world);
+}
+
+float Mask::MaskData::GetDrawInstanceAlpha(size_t which) {
+	if (!m_currentDraw || which >= m_currentInstances.size())
+		return 1.0f;
+	return m_drawInstances[m_currentInstances[which]].alpha;
 }
 
 void Mask::MaskData::Render(const smll::DetectionResults &faces, int width, int height, bool depthOnly) {
 
+	BuildDrawList(faces, depthOnly);
+
 	gs_viewport_push();
 	gs_projection_push();
 
@@ -865,8 +1170,6 @@ void Mask::MaskData::Render(const smll::DetectionResults &faces, int width, int
 	float aspect = (float)width / (float)height;
 	// using reversed-z depth with infinite far
 	gs_perspective(FOVA(aspect), aspect, 1.0, 0.0);
-	
-	ClearSortedDrawObjects();
 
 	gs_blend_state_push();
 	gs_reset_blend_state();
@@ -875,77 +1178,17 @@ void Mask::MaskData::Render(const smll::DetectionResults &faces, int width, int
 		gs_blend_type::GS_BLEND_ZERO);
 	gs_enable_color(true, true, true, true);
 
-	// save a matrix for face transforms
-	gs_matrix_push();
-
 	// OPAQUE
-	for (auto kv : m_parts) {
-		if (kv.second->resources.size() == 0)
-			continue;
-		instanceDatas.Push(kv.second->hash_id);
-		for (auto  it = kv.second->resources.begin();
-			it != kv.second->resources.end(); it++) {
-
-			if ((*it)->IsDepthOnly() != depthOnly) continue;
-
-			bool billboard = (*it)->IsRotationDisabled();
-
-			for (int i = 0; i < faces.length; i++) {
-				// NOTE for some reason, some masks
-				// have their depth head set to static
-				if ((*it)->IsStatic() && (*it)->IsDepthOnly() == false)
-					SetTransform(faces[i].startPose, billboard);
-				else
-					SetTransform(faces[i].pose, billboard);
-
-				gs_matrix_push();
-				gs_matrix_mul(&kv.second->global);
-
-				(*it)->Render(kv.second.get());
-
-				gs_matrix_pop();
-			}
-		}
-		instanceDatas.Pop();
-	}
+	// transparent resources add themselves to the sorted
+	// draw list instead of drawing here
+	SubmitDrawList(m_drawList);
 
 	// TRANSPARENT
 	gs_blend_function_separate(gs_blend_type::GS_BLEND_SRCALPHA,
 		gs_blend_type::GS_BLEND_INVSRCALPHA, gs_blend_type::GS_BLEND_ONE, gs_blend_type::GS_BLEND_INVSRCALPHA);
 
-	for (size_t current_order = 0; current_order < m_num_render_orders; current_order++)
-	{
-		for (unsigned int i = 0; i < NUM_DRAW_BUCKETS; i++) {
-			SortedDrawObject* sdo = m_drawBuckets[i];
-			Resource::IBase* res = dynamic_cast<Resource::IBase*>(sdo);
-			if (!res) continue; // skip if sdo is not a resource type
-			while (sdo) {
-				if (sdo->m_render_order == current_order)
-				{
-					Part* part = sdo->sortDrawPart;
-					instanceDatas.PushDirect(sdo->instanceId);
-					
-					bool billboard = res->IsRotationDisabled();
-
-					for (int i = 0; i < faces.length; i++) {
-						if (res->IsStatic())
-							SetTransform(faces[i].startPose, billboard);
-						else
-							SetTransform(faces[i].pose, billboard);
-
-						gs_matrix_push();
-						gs_matrix_mul(&part->global);
-						sdo->SortedRender();
-						gs_matrix_pop();
-					}
-					instanceDatas.Pop();
-				}
-				sdo = sdo->nextDrawObject;
-			}
-		}
-	}
-
-	gs_matrix_pop();
+	m_sortedDrawList.sort();
+	SubmitDrawList(m_sortedDrawList);
 
 	gs_blend_state_pop();
 
@@ -1030,13 +1273,13 @@ std::shared_ptr<Mask::Part> Mask::MaskData::LoadPart(std::string name, obs_data_
 }
 
 float	Mask::MaskData::GetGlobalAlpha() {
-	std::shared_ptr<Mask::AlphaInstanceData> aid =
+	Mask::AlphaInstanceData* aid =
 		instanceDatas.GetData<Mask::AlphaInstanceData>(Mask::AlphaInstanceDataId);
 	return aid->alpha;
 }
 
 void	Mask::MaskData::SetGlobalAlpha(float alpha) {
-	std::shared_ptr<Mask::AlphaInstanceData> aid =
+	Mask::AlphaInstanceData* aid =
 		instanceDatas.GetData<Mask::AlphaInstanceData>(Mask::AlphaInstanceDataId);
 	aid->alpha = alpha;
 }
@@ -1184,7 +1427,7 @@ bool Mask::MaskData::RenderMorphVideo(gs_texture* vidtex, uint32_t width, uint32
 
 	GetMorph();
 
-	std::shared_ptr<Mask::AlphaInstanceData> aid =
+	Mask::AlphaInstanceData* aid =
 		instanceDatas.GetData<Mask::AlphaInstanceData>(Mask::AlphaInstanceDataId);
 
 	// Add an empty morph resource if they want to use 
@@ -1220,10 +1463,7 @@ bool Mask::MaskData::RenderMorphVideo(gs_texture* vidtex, uint32_t width, uint32
 void Mask::MaskData::ResetInstanceDatas() {
 
 	// reset instance datas
-	std::vector<std::shared_ptr<InstanceData>> idatas = instanceDatas.GetInstances();
-	for (auto id : idatas) {
-		id->Reset();
-	}
+	instanceDatas.ResetInstances();
 }
 
 
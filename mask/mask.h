@@ -21,6 +21,8 @@
 #include "mask-resource.h"
 #include "mask-instance-data.h"
 #include "mask-resource-morph.h"
+#include "mask-binary.h"
+#include "mask-draw-list.h"
 #include "smll/TriangulationResult.hpp"
 #include "smll/DetectionResults.hpp"
 #include <string>
@@ -28,6 +30,7 @@
 #include <memory>
 #include <queue>
 #include <thread>
+#include <unordered_map>
 extern "C" {
 	#pragma warning( push )
 	#pragma warning( disable: 4201 )
@@ -74,7 +77,6 @@ namespace Mask {
 		// Internal
 		matrix4 local, global;
 		bool localdirty;
-		bool dirty;
 		bool isquat;
 		// FBX Inherit Type
 		// RrSs: Apply parent scaling after child scaling.
@@ -91,7 +93,6 @@ namespace Mask {
 			m_render_layer = 0;
 			m_depth_bias = 0.0;
 			sortDrawPart = nullptr;
-			nextDrawObject = nullptr;
 			instanceId = 0;
 		}
 		virtual ~SortedDrawObject() {}
@@ -100,7 +101,6 @@ namespace Mask {
 		virtual void	SortedRender() = 0;
 
 		Part*				sortDrawPart;
-		SortedDrawObject*	nextDrawObject;
 		size_t				instanceId;
 
 		int		m_render_order;
@@ -113,6 +113,34 @@ namespace Mask {
 		class Material;
 	}
 
+	// DrawInstance : transforms of one face (or particle) in a draw
+	// command
+	// - world is the whole part * face transform, worked out on the
+	//   cpu when the draw list is built
+	// - face is kept too, skinned models only want the face transform
+	// - alpha scales the material alpha
+	struct DrawInstance {
+		matrix4				face;
+		matrix4				world;
+		float				alpha;
+	};
+
+	// DrawCommand : one resource (or sorted draw object) of one part
+	// - resources that can draw instanced get one command for all
+	//   faces, the rest get one command per face
+	// - the instances are a range of MaskData's draw instances
+	// - batch commands of the same sorted object that end up next to
+	//   each other after sorting are drawn as one
+	struct DrawCommand {
+		Part*				part;
+		Resource::IBase*	resource;
+		SortedDrawObject*	sorted;
+		size_t				instanceId;
+		uint32_t			firstInstance;
+		uint32_t			numInstances;
+		bool				batch;
+	};
+
 	class MaskData : public Resource::IAnimationControls {
 	public:
 		using Cache = Resource::Cache;
@@ -124,6 +152,10 @@ namespace Mask {
 		void Clear();
 		void Load(const std::string& file);
 
+		// compiled masks: resolve a "@blob:N" value to its bytes in
+		// the mapped file. returns false for plain (base64) values.
+		bool GetBlob(const char* value, const uint8_t** data, size_t* size);
+
 		// resources
 		void AddResource(const std::string& name, std::shared_ptr<Resource::IBase> resource);
 		std::shared_ptr<Resource::IBase> GetResource(const std::string& name, bool force_reload = false);
@@ -163,8 +195,12 @@ namespace Mask {
 		void	SetGlobalAlpha(float alpha);
 
 		// sorted draw objects
-		void ClearSortedDrawObjects();
 		void AddSortedDrawObject(SortedDrawObject* obj);
+		// one instance of a sorted draw object at its own depth. used
+		// by emitters, so particles still interleave with other
+		// transparent objects but neighbours draw together.
+		uint32_t AddDrawInstance(const matrix4* world, float alpha);
+		void AddSortedDrawInstance(SortedDrawObject* obj, float depth, uint32_t instance);
 
 		// morphs
 		Resource::Morph*	 GetMorph();
@@ -183,6 +219,12 @@ namespace Mask {
 		// rendering flags
 		bool	DrawVideoWithMask() { return m_drawVideoWithMask; }
 
+		// faces covered by the draw command being submitted. instanced
+		// resources set each one before drawing it.
+		size_t	GetNumDrawInstances();
+		void	SetDrawInstance(size_t which, bool faceOnly = false);
+		float	GetDrawInstanceAlpha(size_t which);
+
 		// global instance datas
 		MaskInstanceDatas	instanceDatas;
 		void				ResetInstanceDatas();
@@ -192,11 +234,36 @@ namespace Mask {
 
 		Cache *GetCache() { return m_cache; }
 
+		// approximate bytes held by the loaded resources
+		size_t GetMemorySize();
+
 	private:
 		std::shared_ptr<Part> LoadPart(std::string name, obs_data_t* data);
-		static void PartCalcMatrix(Part *part);
+		void DecodeResources();
+		// part transforms: the parts are flattened into evaluation
+		// order (parents first) once, then every tick updates them in
+		// one pass, skipping parts where nothing changed
+		struct PartNode {
+			Part*		part;
+			// node index of the parent, -1 for none
+			int			parent;
+			// parts that are local to this one, in m_partChains
+			uint32_t	chainBegin, chainEnd;
+		};
+		void BuildPartGraph();
+		int AddPartNode(Part* part, std::unordered_map<Part*, int>& index);
+		void UpdatePartTransforms();
+		static void PartCalcLocal(Part* part);
+		static void PartCalcGlobal(Part* part, const Part* parent);
 		static void Decompose(const matrix4 *src, vec3 *s, matrix4 *R, vec3 *t);
-		void SetTransform(const smll::ThreeDPose& pose, bool billboard);
+		static void FaceTransform(matrix4* m, const smll::ThreeDPose& pose, bool billboard);
+
+		// render: build (cpu only) and submit (gs) passes
+		void BuildDrawList(const smll::DetectionResults& faces, bool depthOnly);
+		void AddDrawCommands(DrawList<DrawCommand>& list, uint64_t key,
+			const DrawCommand& draw, const smll::DetectionResults& faces,
+			bool startPose, bool billboard, bool instanced);
+		void SubmitDrawList(const DrawList<DrawCommand>& list);
 
 		struct {
 			std::string name;
@@ -206,10 +273,23 @@ namespace Mask {
 		} m_metaData;
 		std::map<std::string, std::shared_ptr<Resource::IBase>> m_resources;
 		std::map<std::string, std::shared_ptr<Part>> m_parts;
+		std::vector<Part*>		m_partList;
+		std::vector<PartNode>	m_partNodes;
+		std::vector<Part*>		m_partChains;
+		std::vector<uint8_t>	m_partChanged;
+		bool					m_partGraphDirty;
 		std::map<std::string, std::shared_ptr<Resource::Animation>> m_animations;
+		// decoded ahead of time during Load, waiting for GetResource
+		std::map<std::string, std::shared_ptr<Resource::IBase>> m_decodedResources;
 		obs_data_t* m_data;
+		std::unique_ptr<MappedMaskFile> m_binary;
 		std::shared_ptr<Mask::Part> m_partWorld;
-		SortedDrawObject**	m_drawBuckets;
+		DrawList<DrawCommand>	m_drawList;
+		DrawList<DrawCommand>	m_sortedDrawList;
+		std::unordered_map<Resource::IBase*, uint32_t>	m_drawGroups;
+		std::vector<DrawInstance>	m_drawInstances;
+		const DrawCommand*			m_currentDraw;
+		std::vector<uint32_t>		m_currentInstances;
 		Resource::Morph*	m_morph;
 
 		// video light data
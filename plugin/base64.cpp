@@ -19,6 +19,7 @@
 #include <Windows.h>
 
 #include "base64.h"
+#include <cstring>
 #include <iostream>
 
 namespace zlib {
@@ -32,10 +33,6 @@ static const unsigned char ZLIB_BYTE2 = 156;
 
 static const std::string base64_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-static inline bool is_base64(uint8_t c) {
-	return (isalnum(c) || (c == '+') || (c == '/'));
-}
-
 std::string base64_encode(uint8_t const* buf, size_t bufLen) {
 	std::string ret;
 	int i = 0;
@@ -77,43 +74,85 @@ std::string base64_encode(uint8_t const* buf, size_t bufLen) {
 }
 
 
-void base64_decode(std::string const& encoded_string, std::vector<uint8_t>& ret) {
-	size_t in_len = encoded_string.size();
-	int i = 0;
-	int j = 0;
-	int in_ = 0;
-	uint8_t char_array_4[4], char_array_3[3];
-
-	while (in_len-- && (encoded_string[in_] != '=') && is_base64(encoded_string[in_])) {
-		char_array_4[i++] = encoded_string[in_]; in_++;
-		if (i == 4) {
-			for (i = 0; i < 4; i++)
-				char_array_4[i] = (uint8_t)base64_chars.find(char_array_4[i]);
-
-			char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-			char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-			char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-			for (i = 0; (i < 3); i++)
-				ret.push_back(char_array_3[i]);
-			i = 0;
-		}
+// decode table: 6 bit value per char, 0xff for anything that
+// isn't base64 (including '=' padding)
+static const uint8_t BAD_CHAR = 0xff;
+struct DecodeTable {
+	uint8_t v[256];
+	DecodeTable() {
+		memset(v, BAD_CHAR, sizeof(v));
+		for (uint8_t i = 0; i < 64; i++)
+			v[(uint8_t)base64_chars[i]] = i;
 	}
+};
+static const DecodeTable g_decodeTable;
 
-	if (i) {
-		for (j = i; j < 4; j++)
-			char_array_4[j] = 0;
+// chars per chunk when streaming into zlib (multiple of 4)
+static const size_t STREAM_CHUNK_CHARS = 16 * 1024;
 
-		for (j = 0; j < 4; j++)
-			char_array_4[j] = (uint8_t)base64_chars.find(char_array_4[j]);
 
-		char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-		char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-		char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+size_t base64_decoded_size(const char* inbuf, size_t inLen) {
+	// ignore padding
+	while (inLen > 0 && inbuf[inLen - 1] == '=')
+		inLen--;
+	size_t size = (inLen / 4) * 3;
+	if ((inLen % 4) > 1)
+		size += (inLen % 4) - 1;
+	return size;
+}
 
-		for (j = 0; (j < i - 1); j++)
-			ret.push_back(char_array_3[j]);
+size_t base64_decode(const char* inbuf, size_t inLen, uint8_t* outbuf) {
+	const uint8_t* t = g_decodeTable.v;
+	const uint8_t* in = (const uint8_t*)inbuf;
+	uint8_t* out = outbuf;
+	size_t i = 0;
+
+	// 8 chars -> 6 bytes, bail to the tail on any non-base64 char
+	for (; i + 8 <= inLen; i += 8) {
+		uint32_t a = t[in[i + 0]], b = t[in[i + 1]], c = t[in[i + 2]], d = t[in[i + 3]];
+		uint32_t e = t[in[i + 4]], f = t[in[i + 5]], g = t[in[i + 6]], h = t[in[i + 7]];
+		if ((a | b | c | d | e | f | g | h) & 0x80)
+			break;
+		uint32_t v0 = (a << 18) | (b << 12) | (c << 6) | d;
+		uint32_t v1 = (e << 18) | (f << 12) | (g << 6) | h;
+		out[0] = (uint8_t)(v0 >> 16);
+		out[1] = (uint8_t)(v0 >> 8);
+		out[2] = (uint8_t)v0;
+		out[3] = (uint8_t)(v1 >> 16);
+		out[4] = (uint8_t)(v1 >> 8);
+		out[5] = (uint8_t)v1;
+		out += 6;
+	}
+
+	// tail: stops at the first non-base64 char, like the original
+	uint32_t v = 0;
+	int n = 0;
+	for (; i < inLen; i++) {
+		uint8_t x = t[in[i]];
+		if (x == BAD_CHAR)
+			break;
+		v = (v << 6) | x;
+		if (++n == 4) {
+			out[0] = (uint8_t)(v >> 16);
+			out[1] = (uint8_t)(v >> 8);
+			out[2] = (uint8_t)v;
+			out += 3;
+			v = 0;
+			n = 0;
+		}
 	}
+	if (n > 1) {
+		v <<= 6 * (4 - n);
+		*out++ = (uint8_t)(v >> 16);
+		if (n > 2)
+			*out++ = (uint8_t)(v >> 8);
+	}
+	return out - outbuf;
+}
+
+void base64_decode(std::string const& encoded_string, std::vector<uint8_t>& ret) {
+	ret.resize(base64_decoded_size(encoded_string.data(), encoded_string.size()));
+	ret.resize(base64_decode(encoded_string.data(), encoded_string.size(), ret.data()));
 	// yield
 	::Sleep(0);
 }
@@ -140,28 +179,89 @@ std::string base64_encodeZ(uint8_t const* buf, size_t bufLen) {
 	return base64_encode(dest.data(), dest.size());
 }
 
-void base64_decodeZ(std::string const& encoded, std::vector<uint8_t>& decompressed) {
-	// base64 decode first
-	std::vector<uint8_t> decoded;
-	base64_decode(encoded, decoded);
-
-	// only decompress if this is zlib data
-	if (((unsigned char*)decoded.data())[0] == ZLIB_BYTE1 &&
-		((unsigned char*)decoded.data())[1] == ZLIB_BYTE2) {
+// Peek at a base64Z string: is it zlib'd, and if so how big is it
+// inflated? Only decodes the first and last few chars.
+static bool peek_zlib(const char* inbuf, size_t inLen, size_t decodedSize,
+	size_t* inflatedSize) {
+	if (decodedSize < 2 + sizeof(size_t))
+		return false;
+
+	uint8_t head[3];
+	if (base64_decode(inbuf, inLen < 4 ? inLen : 4, head) < 2 ||
+		head[0] != ZLIB_BYTE1 || head[1] != ZLIB_BYTE2)
+		return false;
+
+	// original size is stored at the end of the data
+	size_t trailer = decodedSize - sizeof(size_t);
+	size_t group = trailer / 3;
+	uint8_t tail[sizeof(size_t) + 6];
+	size_t got = base64_decode(inbuf + group * 4, inLen - group * 4, tail);
+	size_t offset = trailer - group * 3;
+	if (got < offset + sizeof(size_t))
+		return false;
+	memcpy(inflatedSize, tail + offset, sizeof(size_t));
+	return true;
+}
 
-		// get original size from end of data
-		size_t destLenT;
-		memcpy(&destLenT,
-			decoded.data() + decoded.size() - sizeof(size_t), sizeof(size_t));
+size_t base64_decodeZ_size(std::string const& encoded) {
+	size_t decodedSize = base64_decoded_size(encoded.data(), encoded.size());
+	size_t inflatedSize;
+	if (peek_zlib(encoded.data(), encoded.size(), decodedSize, &inflatedSize))
+		return inflatedSize;
+	return decodedSize;
+}
 
-		zlib::uLongf destLen = (zlib::uLongf)destLenT;
-		zlib::uLongf srcLen = (zlib::uLongf)(decoded.size() - sizeof(size_t));
+size_t base64_decodeZ(std::string const& encoded, uint8_t* outbuf, size_t outLen) {
+	const char* in = encoded.data();
+	size_t inLen = encoded.size();
+	size_t decodedSize = base64_decoded_size(in, inLen);
+
+	// not zlib data, just decode
+	size_t inflatedSize;
+	if (!peek_zlib(in, inLen, decodedSize, &inflatedSize)) {
+		if (outLen < decodedSize)
+			return 0;
+		return base64_decode(in, inLen, outbuf);
+	}
 
-		// now decompress with zlib
-		decompressed.resize(destLen);
-		zlib::uncompress((zlib::Bytef*)decompressed.data(), &destLen,
-			(zlib::Bytef*)decoded.data(), srcLen);
+	// decode a chunk at a time, straight into the inflate stream
+	zlib::z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	if (zlib::inflateInit_(&zs, ZLIB_VERSION, (int)sizeof(zs)) != Z_OK)
+		return 0;
+	zs.next_out = (zlib::Bytef*)outbuf;
+	zs.avail_out = (zlib::uInt)(outLen < inflatedSize ? outLen : inflatedSize);
+
+	uint8_t chunk[STREAM_CHUNK_CHARS / 4 * 3];
+	size_t toFeed = decodedSize - sizeof(size_t);
+	size_t pos = 0;
+	while (toFeed > 0 && pos < inLen) {
+		size_t n = inLen - pos;
+		if (n > STREAM_CHUNK_CHARS)
+			n = STREAM_CHUNK_CHARS;
+		size_t got = base64_decode(in + pos, n, chunk);
+		bool truncated = got < base64_decoded_size(in + pos, n);
+		pos += n;
+
+		// don't feed the size trailer to zlib
+		if (got > toFeed)
+			got = toFeed;
+		toFeed -= got;
+
+		zs.next_in = chunk;
+		zs.avail_in = (zlib::uInt)got;
+		int r = zlib::inflate(&zs, Z_NO_FLUSH);
+		if (r != Z_OK || truncated)
+			break;
 	}
+	size_t written = (size_t)zs.total_out;
+	zlib::inflateEnd(&zs);
+	return written;
+}
+
+void base64_decodeZ(std::string const& encoded, std::vector<uint8_t>& decompressed) {
+	decompressed.resize(base64_decodeZ_size(encoded));
+	decompressed.resize(base64_decodeZ(encoded, decompressed.data(), decompressed.size()));
 	// yield
 	::Sleep(0);
 }
@@ -26,12 +26,23 @@
 std::string base64_encode(uint8_t const* raw_bytes, size_t in_len);
 void base64_decode(std::string const& inbuf, std::vector<uint8_t>& outbuf);
 
+// Table driven decode into a caller buffer of base64_decoded_size() bytes.
+// Stops at the first non-base64 char, returns the number of bytes written.
+size_t base64_decoded_size(const char* inbuf, size_t inLen);
+size_t base64_decode(const char* inbuf, size_t inLen, uint8_t* outbuf);
+
 // Added zlib compression
 // Note: base64_decodeZ checks if data is zlib encoded, and returns 
 //       the data correctly if it is not.
 std::string base64_encodeZ(uint8_t const* buf, size_t bufLen);
 void base64_decodeZ(std::string const& inbuf, std::vector<uint8_t>& outbuf);
 
+// Decode and inflate in one pass, straight into a caller buffer
+// (no intermediate copy). base64_decodeZ_size gives the buffer size
+// needed, base64_decodeZ returns the number of bytes written.
+size_t base64_decodeZ_size(std::string const& inbuf);
+size_t base64_decodeZ(std::string const& inbuf, uint8_t* outbuf, size_t outLen);
+
 // If you need to alloc your buffer yourself (for alignment, say)
 // use base64_decode then use these methods
 size_t zlib_size(const std::vector<uint8_t>& buf);
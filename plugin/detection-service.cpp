@@ -0,0 +1,194 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#define NOMINMAX
+#include "detection-service.h"
+#include <Windows.h>
+#include <avrt.h>
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+// Windows MMCSS thread task name
+#define MM_THREAD_TASK_NAME "DisplayPostProcessing"
+
+namespace Plugin {
+
+	DetectionService& DetectionService::singleton() {
+		static DetectionService instance;
+		return instance;
+	}
+
+	DetectionService::DetectionService()
+		: m_next(0), m_generation(0) {
+	}
+
+	DetectionService::~DetectionService() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		StopWorkers(lock);
+	}
+
+	void DetectionService::Register(Client* client) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		Slot slot = { client, false, false };
+		m_clients.push_back(slot);
+		if (m_workers.size() == 0)
+			StartWorkers();
+		m_cv.notify_all();
+	}
+
+	void DetectionService::Unregister(Client* client) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true) {
+			auto it = std::find_if(m_clients.begin(), m_clients.end(),
+				[client](const Slot& s) { return s.client == client; });
+			if (it == m_clients.end())
+				return;
+			if (!it->busy) {
+				m_clients.erase(it);
+				break;
+			}
+			// wait for the worker to finish with it
+			m_cv.wait(lock);
+		}
+		if (m_next >= m_clients.size())
+			m_next = 0;
+
+		// last one out stops the workers
+		if (m_clients.size() == 0)
+			StopWorkers(lock);
+	}
+
+	void DetectionService::Notify(Client* client) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			for (auto& s : m_clients) {
+				if (s.client == client) {
+					s.pending = true;
+					break;
+				}
+			}
+		}
+		// all, since Unregister() waits on the same condition
+		m_cv.notify_all();
+	}
+
+	void DetectionService::StartWorkers() {
+		// leave some cores for obs
+		int numWorkers = (int)std::thread::hardware_concurrency() / 2;
+		numWorkers = std::min(std::max(numWorkers, 1), (int)MAX_WORKERS);
+
+		m_generation++;
+		for (int i = 0; i < numWorkers; i++) {
+			m_workers.push_back(std::thread(&DetectionService::WorkerMain,
+				this, m_generation));
+		}
+	}
+
+	void DetectionService::StopWorkers(std::unique_lock<std::mutex>& lock) {
+		// a new generation tells the current workers to exit
+		m_generation++;
+		std::vector<std::thread> workers;
+		workers.swap(m_workers);
+		m_cv.notify_all();
+
+		// join without the lock, the workers need it to exit
+		lock.unlock();
+		for (auto& t : workers)
+			t.join();
+		lock.lock();
+	}
+
+	DetectionService::Client* DetectionService::NextClient(
+		std::chrono::system_clock::time_point now,
+		std::chrono::system_clock::time_point& wakeAt) {
+		// round-robin over clients with a frame waiting, skipping
+		// clients another worker has. wakeAt gets the earliest time
+		// a throttled client becomes runnable.
+		size_t n = m_clients.size();
+		for (size_t i = 0; i < n; i++) {
+			size_t idx = (m_next + i) % n;
+			Slot& slot = m_clients[idx];
+			if (slot.busy || !slot.pending)
+				continue;
+			auto nextRun = slot.client->NextRun();
+			if (nextRun > now) {
+				wakeAt = std::min(wakeAt, nextRun);
+				continue;
+			}
+			slot.busy = true;
+			slot.pending = false;
+			m_next = (idx + 1) % n;
+			return slot.client;
+		}
+		return nullptr;
+	}
+
+	void DetectionService::ClientDone(Client* client) {
+		for (auto& s : m_clients) {
+			if (s.client == client) {
+				s.busy = false;
+				break;
+			}
+		}
+	}
+
+	void DetectionService::WorkerMain(unsigned int generation) {
+		HANDLE hTask = NULL;
+		DWORD taskIndex = 0;
+		hTask = AvSetMmThreadCharacteristics(TEXT(MM_THREAD_TASK_NAME), &taskIndex);
+
+		while (true) {
+			Client* client = nullptr;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				while (generation == m_generation) {
+					auto wakeAt = std::chrono::system_clock::time_point::max();
+					client = NextClient(std::chrono::system_clock::now(), wakeAt);
+					if (client)
+						break;
+					if (wakeAt == std::chrono::system_clock::time_point::max())
+						m_cv.wait(lock);
+					else
+						m_cv.wait_until(lock, wakeAt);
+				}
+				if (generation != m_generation)
+					break;
+			}
+
+			try {
+				client->DetectionStep();
+			}
+			catch (const std::exception& e) {
+				// keep the worker alive for the other clients
+				client->DetectionFailed(e);
+			}
+
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				ClientDone(client);
+			}
+			m_cv.notify_all();
+		}
+
+		if (hTask != NULL) {
+			AvRevertMmThreadCharacteristics(hTask);
+		}
+	}
+}
@@ -0,0 +1,97 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Plugin {
+
+	// DetectionService : process-wide face detection workers
+	//
+	// - every filter instance registers itself as a Client
+	// - a small pool of worker threads is shared by all clients,
+	//   instead of one detection thread per filter
+	// - clients are picked round-robin, and a client is only ever
+	//   run by one worker at a time, so per-source state (tracking,
+	//   frame buffers) needs no extra locking
+	// - workers sleep until a client posts a frame with Notify(),
+	//   or until a throttled client's next run time comes up
+	//
+	class DetectionService {
+	public:
+		static const int MAX_WORKERS = 4;
+
+		class Client {
+		public:
+			virtual ~Client() {}
+
+			// Do one unit of detection work, if there is any.
+			// Returns false if there was nothing to do.
+			virtual bool DetectionStep() = 0;
+
+			// Earliest time the client may be run again (speed limit).
+			virtual std::chrono::system_clock::time_point NextRun() const = 0;
+
+			// DetectionStep() threw. The service is obs free, so
+			// logging is up to the client.
+			virtual void DetectionFailed(const std::exception& e) = 0;
+		};
+
+		static DetectionService& singleton();
+
+		// Unregister blocks until the client is not running,
+		// so it is safe to destroy the client afterwards.
+		void Register(Client* client);
+		void Unregister(Client* client);
+
+		// A client has a new frame for detection
+		void Notify(Client* client);
+
+		int NumWorkers() const { return (int)m_workers.size(); }
+
+	private:
+		DetectionService();
+		~DetectionService();
+
+		struct Slot {
+			Client*	client;
+			bool	busy;
+			bool	pending;
+		};
+
+		std::mutex					m_mutex;
+		std::condition_variable		m_cv;
+		std::vector<Slot>			m_clients;
+		size_t						m_next;
+		unsigned int				m_generation;
+		std::vector<std::thread>	m_workers;
+
+		void	StartWorkers();
+		void	StopWorkers(std::unique_lock<std::mutex>& lock);
+		void	WorkerMain(unsigned int generation);
+		Client*	NextClient(std::chrono::system_clock::time_point now,
+			std::chrono::system_clock::time_point& wakeAt);
+		void	ClientDone(Client* client);
+	};
+}
@@ -59,6 +59,16 @@
 // Big enough
 #define BIG_FLOAT					    (100000.0f)
 
+// Environment maps (default resources) loaded in the background
+static const char* const kEnvironmentMaps[] = {
+	"ibl_museum_specular",
+	"ibl_museum_diffuse",
+	"ibl_mossy_forest_specular",
+	"ibl_mossy_forest_diffuse",
+	"ibl_cayley_interior_specular",
+	"ibl_cayley_interior_diffuse",
+};
+
 
 bool gs_rect_equal(const gs_rect& a, const gs_rect& b) {
 	if (a.x != b.x || a.y != b.y || a.cx != b.cx || a.cy != b.cy) {
@@ -118,8 +128,8 @@ Plugin::FaceMaskFilter::Instance::Instance(obs_data_t *data, obs_source_t *sourc
 	isActive(true), isVisible(true), videoTicked(true),
 	taskHandle(NULL), alertActivate(true),  alertDuration(10.0f),
 	alertElapsedTime(BIG_FLOAT), alertTriggered(false), alertShown(false), alertsLoaded(false),
-	demoCurrentMask(0), smllFaceDetector(nullptr), caching_done(false),
-	demoModeInDelay(false), demoModeGenPreviews(false),	demoModeSavingFrames(false), loading_mask(false),
+	demoCurrentMask(0), smllFaceDetector(nullptr),
+	demoModeInDelay(false), demoModeGenPreviews(false),	demoModeSavingFrames(false), standbyMaskReady(false), envMapCancel(false),
 	drawMask(true),	drawAlert(false), drawFaces(false), drawMorphTris(false), drawFDRect(false), drawMotionRect(false),
 	filterPreviewMode(false), autoBGRemoval(false), cartoonMode(false), testingStage(nullptr), testMode(false), antialiasing_effect(nullptr), color_grading_filter_effect(nullptr),
 	lastResultIndex(-1), sameFrameResults(false), logMode(false), lastLogMode(false), timestampInited(false), lastTimestampInited(false) {
@@ -127,10 +137,7 @@ Plugin::FaceMaskFilter::Instance::Instance(obs_data_t *data, obs_source_t *sourc
 	PLOG_DEBUG("<%" PRIXPTR "> Initializing...", this);
 	// first set both atomic flags
 	mask_load_thread_running.test_and_set();
-	detection_thread_running.test_and_set();
-
 	mask_load_thread_destructing.test_and_set();
-	detection_thread_destructing.test_and_set();
 
 	obs_enter_graphics();
 	sourceRenderTarget = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
@@ -196,6 +203,15 @@ Plugin::FaceMaskFilter::Instance::Instance(obs_data_t *data, obs_source_t *sourc
 		obs_leave_graphics();
 		m_cache.add_permanent(CacheableType::Texture, "empty_texture", empty_texture);
 
+		// stands in for environment maps that are still loading
+		const uint8_t *zero_cube[6];
+		for (int i = 0; i < 6; i++)
+			zero_cube[i] = zero_tex[0];
+		obs_enter_graphics();
+		gs_texture_t *empty_cubemap = gs_cubetexture_create(1, GS_RGBA, 1, (const uint8_t **)&zero_cube, 0);
+		obs_leave_graphics();
+		m_cache.add_permanent(CacheableType::Texture, "empty_cubemap", empty_cubemap);
+
 		delete zero_tex[0];
 	}
 
@@ -221,10 +237,18 @@ Plugin::FaceMaskFilter::Instance::Instance(obs_data_t *data, obs_source_t *sourc
 	{
 		std::unique_lock<std::mutex> lock(detection.mutex);
 		detection.facesIndex = -1;
-		detection.thread = std::thread(StaticThreadMain, this);
 		clearFramesActiveStatus();
 	}
+
+	// hand face detection to the shared workers
+	DetectionService::singleton().Register(this);
 	
+	// start loading the environment maps, masks that want them
+	// before they are done get a stand-in
+	for (const char* name : kEnvironmentMaps)
+		m_cache.reserve_default(name);
+	envMapThread = std::thread(StaticEnvMapThreadMain, this);
+
 	// start mask data loading thread
 	maskDataThread = std::thread(StaticMaskDataThreadMain, this);
 
@@ -255,9 +279,9 @@ Plugin::FaceMaskFilter::Instance::~Instance() {
 
 	PLOG_DEBUG("<%" PRIXPTR "> Signalling exit to worker Threads...", this);
 
-	// signal to mask loading and detection threads to exit
+	// signal to mask and environment map loading threads to exit
 	mask_load_thread_running.clear();
-	detection_thread_running.clear();
+	envMapCancel = true;
 
 	graphics_t *graphics = gs_get_context();
 	bool destructing_from_graphics_thread = (graphics != NULL);
@@ -273,16 +297,19 @@ Plugin::FaceMaskFilter::Instance::~Instance() {
 	{
 		std::this_thread::sleep_for(std::chrono::milliseconds(20));
 	}
-		
-	while(detection_thread_destructing.test_and_set())
-	{
-		std::this_thread::sleep_for(std::chrono::milliseconds(20));
-	}
+
+	// stop face detection, waits for any step in progress
+	DetectionService::singleton().Unregister(this);
+	if (smllFaceDetector)
+		delete smllFaceDetector;
+#if !defined(PUBLIC_RELEASE)
+	delete smllRenderer;
+#endif
 
 	// now it is safe to join
 	PLOG_DEBUG("<%" PRIXPTR "> Joining worker Threads...", this);
-	detection.thread.join();
 	maskDataThread.join();
+	envMapThread.join();
 
 	if (destructing_from_graphics_thread)
 	{
@@ -311,6 +338,11 @@ Plugin::FaceMaskFilter::Instance::~Instance() {
 		gs_stagesurface_destroy(testingStage);
 
 	maskData = nullptr;
+	standbyMaskData = nullptr;
+	{
+		std::vector<std::unique_ptr<Mask::MaskData>> evicted;
+		maskCache.clear(evicted);
+	}
 	obs_leave_graphics();
 
 	// also destroy cache
@@ -356,6 +388,9 @@ void Plugin::FaceMaskFilter::Instance::get_defaults(obs_data_t *data) {
 
 	obs_data_set_default_string(data, P_MASK, kDefaultMask);
 	obs_data_set_default_string(data, P_MASK_BROWSE, kDefaultMask);
+	obs_data_set_default_int(data, P_MASK_CACHE_SIZE, kDefaultMaskCacheSize);
+	obs_data_set_default_string(data, P_MASK_PREWARM, "");
+	obs_data_set_default_int(data, P_RESOURCE_CACHE_SIZE, kDefaultResourceCacheSize);
 
 	bfree(defMaskFolder);
 	
@@ -456,6 +491,13 @@ static void add_folder_property(obs_properties_t *props, const char* name,
 	obs_property_set_long_description(p, P_TRANSLATE(n.c_str()));
 }
 
+static void add_int_slider(obs_properties_t *props, const char* name, int min, int max, int step) {
+	obs_property_t* p = obs_properties_add_int_slider(props, name,
+		P_TRANSLATE(name), min, max, step);
+	std::string n = name; n += ".Description";
+	obs_property_set_long_description(p, P_TRANSLATE(n.c_str()));
+}
+
 static void add_float_slider(obs_properties_t *props, const char* name, float min, float max, float step) {
 	obs_property_t* p = obs_properties_add_float_slider(props, name,
 		P_TRANSLATE(name), min, max, step);
@@ -533,10 +575,9 @@ bool Plugin::FaceMaskFilter::Instance::SendSourceTextureToThread(gs_texture* sou
 		}
 	}
 
-	// Advance frame index if we copied a frame
-	if (frameSent) {
-		std::unique_lock<std::mutex> lock(detection.mutex);
-	}
+	// wake a detection worker for the new frame
+	if (frameSent)
+		DetectionService::singleton().Notify(this);
 
 	return frameSent;
 }
@@ -545,6 +586,9 @@ void Plugin::FaceMaskFilter::Instance::get_properties(obs_properties_t *props) {
 #if !defined(PUBLIC_RELEASE)
 	// mask 
 	add_json_file_property(props, P_MASK_BROWSE, NULL);
+	add_int_slider(props, P_MASK_CACHE_SIZE, 0, 2048, 16);
+	add_int_slider(props, P_RESOURCE_CACHE_SIZE, 0, 2048, 16);
+	add_text_property(props, P_MASK_PREWARM);
 
 	// ALERT PROPERTIES
 	add_bool_property(props, P_ALERT_ACTIVATE);
@@ -681,6 +725,37 @@ void Plugin::FaceMaskFilter::Instance::update(obs_data_t *data) {
 		maskFilePath = newMaskFilePath;
 	}
 
+	// resource cache
+	m_cache.set_budget((size_t)obs_data_get_int(data, P_RESOURCE_CACHE_SIZE) * 1024 * 1024);
+
+	// mask cache
+	{
+		size_t budget = (size_t)obs_data_get_int(data, P_MASK_CACHE_SIZE) * 1024 * 1024;
+		std::string newPrewarmList = obs_data_get_string(data, P_MASK_PREWARM);
+		std::vector<std::unique_ptr<Mask::MaskData>> evicted;
+		{
+			std::unique_lock<std::mutex> lock(maskCacheMutex);
+			maskCache.set_budget(budget, evicted);
+			if (newPrewarmList != prewarmList) {
+				prewarmList = newPrewarmList;
+				prewarmMasks.clear();
+				for (std::string fn : Utils::split(prewarmList, '|')) {
+					std::replace(fn.begin(), fn.end(), '/', '\\');
+					if (fn.empty())
+						continue;
+					if (fn.find('\\') == std::string::npos)
+						fn = maskFolder + "\\" + fn;
+					prewarmMasks.push_back(fn);
+				}
+			}
+		}
+		if (evicted.size() > 0) {
+			obs_enter_graphics();
+			evicted.clear();
+			obs_leave_graphics();
+		}
+	}
+
 	// Flags
 	autoBGRemoval = obs_data_get_bool(data, P_BGREMOVAL);
 	cartoonMode = obs_data_get_bool(data, P_CARTOON);
@@ -805,26 +880,8 @@ void Plugin::FaceMaskFilter::Instance::video_tick(void *ptr, float timeDelta) {
 
 void Plugin::FaceMaskFilter::Instance::video_tick(float timeDelta) {
 
-	if (!loading_mask && !caching_done)
-	{
-		// preload cubemaps in background
-		blog(LOG_DEBUG, "[FaceMask] Caching environment maps...");
-
-		Mask::Resource::IBase::LoadDefault(nullptr, "ibl_museum_specular", &m_cache);
-		Mask::Resource::IBase::LoadDefault(nullptr, "ibl_museum_diffuse", &m_cache);
-
-		Mask::Resource::IBase::LoadDefault(nullptr, "ibl_mossy_forest_specular", &m_cache);
-		Mask::Resource::IBase::LoadDefault(nullptr, "ibl_mossy_forest_diffuse", &m_cache);
-
-		Mask::Resource::IBase::LoadDefault(nullptr, "ibl_cayley_interior_specular", &m_cache);
-		Mask::Resource::IBase::LoadDefault(nullptr, "ibl_cayley_interior_diffuse", &m_cache);
-
-		caching_done = true;
-		blog(LOG_DEBUG, "[FaceMask] Caching done");
-	}
-
 	videoTicked = true;
-	if (!isVisible || !isActive || loading_mask) {
+	if (!isVisible || !isActive) {
 		// *** SKIP TICK ***
 		return;
 	}
@@ -903,7 +960,7 @@ void Plugin::FaceMaskFilter::Instance::video_render(void *ptr,
 void Plugin::FaceMaskFilter::Instance::video_render(gs_effect_t *effect) {
 
 	// Skip rendering if inactive or invisible.
-	if (!isActive || !isVisible || loading_mask ||
+	if (!isActive || !isVisible ||
 		// or if the alert is done
 		(!drawMask && alertElapsedTime > alertDuration)) {
 		// reset the buffer
@@ -914,8 +971,13 @@ void Plugin::FaceMaskFilter::Instance::video_render(gs_effect_t *effect) {
 		if(smllFaceDetector)
 			smllFaceDetector->ResetFaces();
 		faces.length = 0;
+		faceFilters.ReleaseAll();
 		// make sure file loads still happen
-		checkForMaskUnloading();
+		{
+			std::unique_lock<std::mutex> masklock(maskDataMutex, std::try_to_lock);
+			if (masklock.owns_lock())
+				swapInStandbyMask();
+		}
 		obs_source_skip_video_filter(source);
 		return;
 	}
@@ -927,6 +989,9 @@ void Plugin::FaceMaskFilter::Instance::video_render(gs_effect_t *effect) {
 		return;
 	}
 
+	// frame boundary: pick up a mask that finished loading
+	swapInStandbyMask();
+
 	if (logMode) {
 		renderTimestamp = NEW_TIMESTAMP;
 	}
@@ -1288,23 +1353,30 @@ void Plugin::FaceMaskFilter::Instance::video_render(gs_effect_t *effect) {
 		}
 
 	}
-	// since we are on the gpu right now anyway, here is 
-	// a good spot to unload mask data if we need to.
-	checkForMaskUnloading();
 
 	videoTicked = false;
 	
 }
 
-void Plugin::FaceMaskFilter::Instance::checkForMaskUnloading() {
-	// Check for file/folder changes
-	if (currentMaskFilename != maskFilename) {
-		maskData = nullptr;
-	}
+void Plugin::FaceMaskFilter::Instance::swapInStandbyMask() {
+	// call from video_render with maskDataMutex held, so the
+	// old mask data is freed on the graphics thread
+	if (!standbyMaskReady)
+		return;
 
-	if (currentMaskFolder != maskFolder) {
-		maskData = nullptr;
-	}
+	// keep the outgoing mask around, we might switch back to it
+	if (maskData)
+		CacheMaskData(currentMaskFolder + "\\" + currentMaskFilename,
+			std::move(maskData));
+
+	maskData = std::move(standbyMaskData);
+	currentMaskFilename = standbyMaskFilename;
+	currentMaskFolder = standbyMaskFolder;
+	standbyMaskReady = false;
+
+	// cached masks come back where they left off
+	if (maskData)
+		maskData->Rewind();
 }
 
 void Plugin::FaceMaskFilter::Instance::demoModeRender(gs_texture* vidTex, gs_texture* maskTex, 
@@ -1431,151 +1503,106 @@ void Plugin::FaceMaskFilter::Instance::setupRenderingState() {
 		gs_blend_type::GS_BLEND_INVSRCALPHA);
 }
 
-int32_t Plugin::FaceMaskFilter::Instance::StaticThreadMain(Instance *ptr) {
-	return ptr->LocalThreadMain();
+std::chrono::system_clock::time_point Plugin::FaceMaskFilter::Instance::NextRun() const {
+	return detection.nextRun;
 }
 
-int32_t Plugin::FaceMaskFilter::Instance::LocalThreadMain() {
-
-	HANDLE hTask = NULL;
-	DWORD taskIndex = 0;
-	hTask = AvSetMmThreadCharacteristics(TEXT(MM_THREAD_TASK_NAME), &taskIndex);
-	if (hTask == NULL) {
-		blog(LOG_DEBUG, "[FaceMask] Failed to set MM thread characteristics");
-	}
-
-	obs_source_t *parent = obs_filter_get_parent(source);
-
-	smllFaceDetector = new smll::FaceDetector();
-
-	// run until we're shut down
-	TimeStamp lastTimestamp;
-	while (detection_thread_running.test_and_set()) {
-
-		if (loading_mask) {
-			std::this_thread::sleep_for(std::chrono::milliseconds(20));
-			continue;
-		}
-		{
-			std::unique_lock<std::mutex> lockMaskDetect(loadMaskDetectionMutex);
-			auto frameStart = std::chrono::system_clock::now();
-
-			// get the frame index
-			if (!detection.frame.active) {
-				std::this_thread::sleep_for(std::chrono::milliseconds(16));
-				continue;
-			}
-
-			smll::DetectionResults detect_results;
+void Plugin::FaceMaskFilter::Instance::DetectionFailed(const std::exception& e) {
+	PLOG_ERROR("Face detection failed: %s", e.what());
+}
 
+bool Plugin::FaceMaskFilter::Instance::DetectionStep() {
 
-			bool skipped = false;
-			{
-				std::unique_lock<std::mutex> lock(detection.frame.mutex);
+	// the service holds us back until nextRun, per the speed limit
+	auto frameStart = std::chrono::system_clock::now();
 
-				// check to see if we are detecting the same frame as last time
-				if (lastTimestamp == detection.frame.timestamp) {
-					// same frame, skip
-					skipped = true;
-				}
-				else {
-					// new frame - do the face detection
-					smllFaceDetector->DetectFaces(detection.frame.capture, detection.frame.resizeWidth, detection.frame.resizeHeight, detect_results);
+	// get the frame index
+	if (!detection.frame.active)
+		return false;
 
-					smllFaceDetector->DetectLandmarks(detect_results);
-					smllFaceDetector->DoPoseEstimation(detect_results);
+	// loads the models, so do it here rather than on the graphics thread
+	if (!smllFaceDetector)
+		smllFaceDetector = new smll::FaceDetector();
 
-					lastTimestamp = detection.frame.timestamp;
-				}
-			}
+	smll::DetectionResults detect_results;
 
-			if (skipped) {
-				// sleep for 1ms and continue
-				std::this_thread::sleep_for(std::chrono::milliseconds(1));
-				continue;
-			}
+	{
+		std::unique_lock<std::mutex> lock(detection.frame.mutex);
 
-			// get the index into the faces buffer
-			int face_idx;
-			{
-				std::unique_lock<std::mutex> lock(detection.mutex);
-				face_idx = detection.facesIndex;
-			}
-			if (face_idx < 0)
-				face_idx = 0;
+		// check to see if we are detecting the same frame as last time
+		if (detection.lastTimestamp == detection.frame.timestamp) {
+			// same frame, skip
+			return false;
+		}
 
-			// acquire the locks in the correct order
-			obs_enter_graphics();
-			{
+		// new frame - do the face detection
+		smllFaceDetector->DetectFaces(detection.frame.capture, detection.frame.resizeWidth, detection.frame.resizeHeight, detect_results);
 
-				std::unique_lock<std::mutex> facelock(detection.faces[face_idx].mutex);
+		smllFaceDetector->DetectLandmarks(detect_results);
+		smllFaceDetector->DoPoseEstimation(detect_results);
 
-				// pass on timestamp to results
-				detection.faces[face_idx].timestamp = lastTimestamp;
-				std::unique_lock<std::mutex> framelock(detection.frame.mutex);
+		detection.lastTimestamp = detection.frame.timestamp;
+	}
 
-				// Make the triangulation
-				detection.faces[face_idx].triangulationResults.buildLines = drawMorphTris;
-				try
-				{
-					smllFaceDetector->MakeTriangulation(detection.frame.morphData,
-						detect_results, detection.faces[face_idx].triangulationResults);
-				}
-				catch (const std::exception&)
-				{
-				}
+	// get the index into the faces buffer
+	int face_idx;
+	{
+		std::unique_lock<std::mutex> lock(detection.mutex);
+		face_idx = detection.facesIndex;
+	}
+	if (face_idx < 0)
+		face_idx = 0;
 
+	// acquire the locks in the correct order
+	obs_enter_graphics();
+	{
 
-				detection.frame.active = false;
+		std::unique_lock<std::mutex> facelock(detection.faces[face_idx].mutex);
 
+		// pass on timestamp to results
+		detection.faces[face_idx].timestamp = detection.lastTimestamp;
+		std::unique_lock<std::mutex> framelock(detection.frame.mutex);
 
-				// Copy our detection results
-				for (int i = 0; i < detect_results.length; i++) {
-					detection.faces[face_idx].detectionResults[i] = detect_results[i];
-				}
-				detection.faces[face_idx].detectionResults.length = detect_results.length;
-				detection.faces[face_idx].detectionResults.processedResults = detect_results.processedResults;
-				detection.faces[face_idx].detectionResults.motionRect = detect_results.motionRect;
+		// Make the triangulation
+		detection.faces[face_idx].triangulationResults.buildLines = drawMorphTris;
+		try
+		{
+			smllFaceDetector->MakeTriangulation(detection.frame.morphData,
+				detect_results, detection.faces[face_idx].triangulationResults);
+		}
+		catch (const std::exception&)
+		{
+		}
 
-			}
-			obs_leave_graphics();
 
-			{
-				std::unique_lock<std::mutex> lock(detection.mutex);
+		detection.frame.active = false;
 
-				// increment face buffer index
-				detection.facesIndex = (face_idx + 1) % ThreadData::BUFFER_SIZE;
-			}
 
-			// don't go too fast and eat up all the cpu
-			auto frameEnd = std::chrono::system_clock::now();
-			auto elapsedMs =
-				std::chrono::duration_cast<std::chrono::microseconds>
-				(frameEnd - frameStart);
-			long long speedLimit = smll::Config::singleton().get_int(
-				smll::CONFIG_INT_SPEED_LIMIT) * 1000;
-			long long sleepTime = max(speedLimit - elapsedMs.count(),
-				(long long)0);
-			if (sleepTime > 0)
-				std::this_thread::sleep_for(std::chrono::microseconds(sleepTime));
+		// Copy our detection results
+		for (int i = 0; i < detect_results.length; i++) {
+			detection.faces[face_idx].detectionResults[i] = detect_results[i];
 		}
-	}
+		detection.faces[face_idx].detectionResults.length = detect_results.length;
+		detection.faces[face_idx].detectionResults.processedResults = detect_results.processedResults;
+		detection.faces[face_idx].detectionResults.motionRect = detect_results.motionRect;
 
-	if(smllFaceDetector)
-		delete smllFaceDetector;
-#if !defined(PUBLIC_RELEASE)
-	delete smllRenderer;
-#endif
+	}
+	obs_leave_graphics();
 
+	{
+		std::unique_lock<std::mutex> lock(detection.mutex);
 
-	if (hTask != NULL) {
-		AvRevertMmThreadCharacteristics(hTask);
+		// increment face buffer index
+		detection.facesIndex = (face_idx + 1) % ThreadData::BUFFER_SIZE;
 	}
 
-	PLOG_DEBUG("Detection thread finished successfully.");
-	detection_thread_destructing.clear();
+	// next run for this source, per the speed limit. the worker
+	// is free to serve other sources in the meantime.
+	long long speedLimit = smll::Config::singleton().get_int(
+		smll::CONFIG_INT_SPEED_LIMIT) * 1000;
+	detection.nextRun = frameStart + std::chrono::microseconds(speedLimit);
 
-	return 0;
+	return true;
 }
 
 int32_t Plugin::FaceMaskFilter::Instance::StaticMaskDataThreadMain(Instance *ptr) {
@@ -1590,33 +1617,61 @@ int32_t Plugin::FaceMaskFilter::Instance::LocalMaskDataThreadMain() {
 
 	// Loading loop
 	bool lastDemoMode = false; 
+	std::string loadedMaskFilename;
+	std::string loadedMaskFolder;
 	while (mask_load_thread_running.test_and_set()) {
-		{
-			std::unique_lock<std::mutex> lock(maskDataMutex, std::try_to_lock);
-			if (lock.owns_lock()) {
-				// time to load mask?
-				if ((maskData == nullptr) &&
-					maskFilename.length() > 0) {
-					// save current
-					currentMaskFilename = maskFilename;
-					currentMaskFolder = maskFolder;
-					// mask filename
-					std::string maskFn = currentMaskFolder + "\\" + currentMaskFilename;
-					// load mask
+		// time to load mask?
+		std::string wantFilename = maskFilename;
+		std::string wantFolder = maskFolder;
+		if (wantFilename != loadedMaskFilename ||
+			wantFolder != loadedMaskFolder) {
+			loadedMaskFilename = wantFilename;
+			loadedMaskFolder = wantFolder;
+
+			// load into a standby mask data, while the current
+			// mask keeps rendering and detection keeps running
+			std::unique_ptr<Mask::MaskData> mdat;
+			if (wantFilename.length() > 0) {
+				std::string maskFn = wantFolder + "\\" + wantFilename;
+				{
+					std::unique_lock<std::mutex> lock(maskCacheMutex);
+					maskCache.take(maskFn, mdat);
+				}
+				if (mdat) {
+					PLOG_INFO("Mask '%s' found in cache.", maskFn.c_str());
+				}
+				else {
 					SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
-					{
-						loading_mask = true;
-						{
-							std::unique_lock<std::mutex> lock(loadMaskDetectionMutex);
-							maskData = std::unique_ptr<Mask::MaskData>(LoadMask(maskFn));
-						}
-						loading_mask = false;
-
-					}
+					mdat = std::unique_ptr<Mask::MaskData>(LoadMask(maskFn));
 					SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
 				}
+			}
 
-				
+			// hand it to the render thread, which swaps it in at
+			// the start of its next frame
+			std::unique_ptr<Mask::MaskData> stale;
+			std::string staleFn;
+			{
+				std::unique_lock<std::mutex> lock(maskDataMutex);
+				stale = std::move(standbyMaskData);
+				staleFn = standbyMaskFolder + "\\" + standbyMaskFilename;
+				standbyMaskData = std::move(mdat);
+				standbyMaskFilename = wantFilename;
+				standbyMaskFolder = wantFolder;
+				standbyMaskReady = true;
+			}
+			// a standby that was never swapped in
+			if (stale)
+				CacheMaskData(staleFn, std::move(stale));
+		}
+		// nothing to switch to, pre-warm the next mask
+		else {
+			PrewarmStep(loadedMaskFolder + "\\" + loadedMaskFilename);
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(maskDataMutex, std::try_to_lock);
+			if (lock.owns_lock()) {
 				// demo mode
 				if (demoModeGenPreviews && !lastDemoMode) {
 					SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
@@ -1642,6 +1697,33 @@ int32_t Plugin::FaceMaskFilter::Instance::LocalMaskDataThreadMain() {
 }
 
 
+int32_t Plugin::FaceMaskFilter::Instance::StaticEnvMapThreadMain(Instance *ptr) {
+	return ptr->LocalEnvMapThreadMain();
+}
+
+int32_t Plugin::FaceMaskFilter::Instance::LocalEnvMapThreadMain() {
+
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+
+	PLOG_DEBUG("Caching environment maps...");
+	for (const char* name : kEnvironmentMaps) {
+		if (envMapCancel)
+			break;
+		std::shared_ptr<Mask::Resource::IBase> res;
+		try {
+			res = Mask::Resource::IBase::LoadDefault(nullptr, name, &m_cache);
+		}
+		catch (...) {
+			PLOG_ERROR("Failed to load environment map '%s'.", name);
+		}
+		// masks waiting on it pick it up on their next frame
+		m_cache.add_default(name, res);
+	}
+	PLOG_DEBUG("Caching environment maps done.");
+
+	return 0;
+}
+
 void Plugin::FaceMaskFilter::Instance::LoadDemo() {
 
 	blog(LOG_DEBUG, "loading demo folder %s", demoModeFolder.c_str());
@@ -1694,6 +1776,30 @@ Plugin::FaceMaskFilter::Instance::LoadMask(std::string filename) {
 	// new mask data
 	Mask::MaskData* mdat = new Mask::MaskData(&m_cache);
 
+	// prefer a compiled mask (mask.fmask) sitting next to the json
+	std::string compiled = filename;
+	size_t dot = compiled.find_last_of("./\\");
+	if (dot != std::string::npos && compiled[dot] == '.')
+		compiled.erase(dot);
+	compiled += Mask::Binary::FILE_EXTENSION;
+	bool haveCompiled = compiled != filename &&
+		Mask::MappedMaskFile::IsCompiled(compiled);
+	if (haveCompiled && !Mask::MappedMaskFile::IsUpToDate(compiled, filename)) {
+		PLOG_WARNING("Compiled mask %s is older than its json, using json.", compiled.c_str());
+		haveCompiled = false;
+	}
+	if (haveCompiled) {
+		try {
+			mdat->Load(compiled);
+			PLOG_INFO("Loading compiled mask '%s' successful!", compiled.c_str());
+			return mdat;
+		}
+		catch (...) {
+			PLOG_WARNING("Failed to load compiled mask %s, using json.", compiled.c_str());
+			mdat->Clear();
+		}
+	}
+
 	// load the json
 	try {
 		mdat->Load(filename);
@@ -1706,6 +1812,55 @@ Plugin::FaceMaskFilter::Instance::LoadMask(std::string filename) {
 	return mdat;
 }
 
+void Plugin::FaceMaskFilter::Instance::CacheMaskData(const std::string& filename,
+	std::unique_ptr<Mask::MaskData> mdat) {
+	std::vector<std::unique_ptr<Mask::MaskData>> evicted;
+	// don't keep masks that failed to load
+	if (mdat->GetNumParts() == 0) {
+		evicted.emplace_back(std::move(mdat));
+	}
+	else {
+		size_t bytes = mdat->GetMemorySize();
+		std::unique_lock<std::mutex> lock(maskCacheMutex);
+		maskCache.put(filename, std::move(mdat), bytes, evicted);
+		PLOG_DEBUG("Mask cache: %d masks, %d KB.", (int)maskCache.size(),
+			(int)(maskCache.cost() / 1024));
+	}
+
+	Mask::Resource::Cache::Stats stats = m_cache.get_stats();
+	PLOG_DEBUG("Resource cache: %d items (%d idle), %d KB, %d hits, %d misses, %d evictions.",
+		(int)stats.items, (int)stats.idle_items, (int)(stats.bytes / 1024),
+		(int)stats.hits, (int)stats.misses, (int)stats.evictions);
+
+	// mask data holds gpu resources
+	obs_enter_graphics();
+	evicted.clear();
+	obs_leave_graphics();
+}
+
+bool Plugin::FaceMaskFilter::Instance::PrewarmStep(const std::string& currentFilename) {
+	std::string maskFn;
+	{
+		std::unique_lock<std::mutex> lock(maskCacheMutex);
+		while (maskFn.empty() && prewarmMasks.size() > 0) {
+			std::string fn = prewarmMasks.front();
+			prewarmMasks.erase(prewarmMasks.begin());
+			if (fn != currentFilename && !maskCache.contains(fn))
+				maskFn = fn;
+		}
+	}
+	if (maskFn.empty())
+		return false;
+
+	PLOG_INFO("Pre-loading mask '%s'...", maskFn.c_str());
+	SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+	std::unique_ptr<Mask::MaskData> mdat(LoadMask(maskFn));
+	SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+
+	CacheMaskData(maskFn, std::move(mdat));
+	return true;
+}
+
 void Plugin::FaceMaskFilter::Instance::drawCropRects(int width, int height) {
 #if !defined(PUBLIC_RELEASE)
 	dlib::rectangle r;
@@ -1802,7 +1957,7 @@ void Plugin::FaceMaskFilter::Instance::updateFaces() {
 			timestampInited = true;
 			processedFrameResults = detection.faces[fidx].detectionResults.processedResults;
 			// update our results
-			faces.CorrelateAndUpdateFrom(newFaces);
+			faces.CorrelateAndUpdateFrom(newFaces, faceFilters);
 			if (lastResultIndex != fidx) {
 				sameFrameResults = false;
 				lastResultIndex = fidx;
@@ -32,6 +32,9 @@
 #include "smll/TriangulationResult.hpp"
 #include "smll/MorphData.hpp"
 
+#include "detection-service.h"
+#include "lru-cache.h"
+
 
 #include "mask/mask.h"
 #include "mask/mask-resource.h"
@@ -76,7 +79,7 @@ namespace Plugin {
 		static const int SSAA_ANTI_ALIASING = 1;
 		static const int FXAA_ANTI_ALIASING = 2;
 
-		class Instance {
+		class Instance : public DetectionService::Client {
 		public:
 			Instance(obs_data_t *, obs_source_t *);
 			~Instance();
@@ -112,12 +115,12 @@ namespace Plugin {
 			using Cache = Mask::Resource::Cache;
 			using CacheableType = Cache::CacheableType;
 			Cache m_cache;
-			bool caching_done;
 			
 		protected:
-			// face detection thread
-			static int32_t StaticThreadMain(Instance*);
-			int32_t LocalThreadMain();
+			// face detection (run by the DetectionService workers)
+			bool DetectionStep() override;
+			std::chrono::system_clock::time_point NextRun() const override;
+			void DetectionFailed(const std::exception& e) override;
 
 			bool SendSourceTextureToThread(gs_texture* sourceTexture);
 
@@ -125,8 +128,14 @@ namespace Plugin {
 			static int32_t StaticMaskDataThreadMain(Instance*);
 			int32_t LocalMaskDataThreadMain();
 
+			// environment map loading thread
+			static int32_t StaticEnvMapThreadMain(Instance*);
+			int32_t LocalEnvMapThreadMain();
+
 			// misc functions
 			Mask::MaskData*	LoadMask(std::string filename);
+			void	CacheMaskData(const std::string& filename, std::unique_ptr<Mask::MaskData> mdat);
+			bool	PrewarmStep(const std::string& currentFilename);
 			void LoadDemo();
 			void drawCropRects(int width, int height);
 			void drawMotionRects(int width, int height);
@@ -174,7 +183,7 @@ namespace Plugin {
 			std::string			maskInternal;
 			std::string			currentMaskFilename;
 
-			void	checkForMaskUnloading();
+			void	swapInStandbyMask();
 
 			// alert params
 			bool				alertActivate;
@@ -186,16 +195,30 @@ namespace Plugin {
 			std::mutex			maskDataMutex;
 			std::unique_ptr<Mask::MaskData>	maskData;
 
-			bool				loading_mask;
+			// next mask, loaded in the background and swapped in
+			// by video_render (guarded by maskDataMutex)
+			std::unique_ptr<Mask::MaskData>	standbyMaskData;
+			std::string			standbyMaskFilename;
+			std::string			standbyMaskFolder;
+			bool				standbyMaskReady;
+
+			// recently used and pre-warmed masks, by full path
+			std::mutex			maskCacheMutex;
+			Utils::LRUCache<std::string, std::unique_ptr<Mask::MaskData>>	maskCache;
+			std::vector<std::string>	prewarmMasks;
+			std::string			prewarmList;
+
+			// environment maps, loaded once in the background. masks
+			// use an empty cubemap until they are there.
+			std::thread			envMapThread;
+			std::atomic<bool>	envMapCancel;
+
 			std::mutex          passFrameToDetection;
-			std::mutex          loadMaskDetectionMutex;
 			// lock-free atomic flag
 			// 1. for signaling to threads to finish their work
 			std::atomic_flag mask_load_thread_running = ATOMIC_FLAG_INIT;
-			std::atomic_flag detection_thread_running = ATOMIC_FLAG_INIT;
 			// 2. for the threads to signal back they're ready to be joined
 			std::atomic_flag mask_load_thread_destructing = ATOMIC_FLAG_INIT;
-			std::atomic_flag detection_thread_destructing = ATOMIC_FLAG_INIT;
 
 			// alert location
 			enum AlertLocation {
@@ -248,6 +271,7 @@ namespace Plugin {
 
 			// our current face detection results
 			smll::DetectionResults		faces;
+			smll::DetectionFilters		faceFilters;
 			smll::TriangulationResult	triangulation;
 			TimeStamp					timestamp;
 			bool						timestampInited;
@@ -278,9 +302,12 @@ namespace Plugin {
 
 				static const int BUFFER_SIZE = 8;
 
-				std::thread thread;
 				std::mutex mutex;
 
+				// last frame detected, and speed limiting
+				TimeStamp	lastTimestamp;
+				std::chrono::system_clock::time_point nextRun;
+
 				// frames circular buffer (video_render()'s thread -> detection thread)
 				struct Frame {
 					smll::MorphData     morphData;
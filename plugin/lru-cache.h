@@ -0,0 +1,123 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#pragma once
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Utils {
+
+	// LRUCache : least recently used cache with a cost budget
+	//
+	// - every entry has a cost (usually bytes), the cache evicts the
+	//   least recently used entries once the total goes over budget
+	// - evicted values are handed back to the caller instead of being
+	//   destroyed here, since some values (gpu resources) have to be
+	//   freed on a specific thread
+	// - not thread safe, callers lock
+	//
+	template <typename Key, typename Value>
+	class LRUCache {
+	public:
+		LRUCache(size_t budget = 0) : m_budget(budget), m_cost(0) {}
+
+		size_t size() const { return m_entries.size(); }
+		size_t cost() const { return m_cost; }
+		size_t budget() const { return m_budget; }
+
+		bool contains(const Key& key) const {
+			return m_index.find(key) != m_index.end();
+		}
+
+		// Change the budget. Entries that no longer fit are added
+		// to evicted.
+		void set_budget(size_t budget, std::vector<Value>& evicted) {
+			m_budget = budget;
+			trim(evicted);
+		}
+
+		// Add (or replace) an entry as the most recently used one.
+		// An entry that is bigger than the whole budget is not kept,
+		// and ends up in evicted along with anything it pushed out.
+		void put(const Key& key, Value value, size_t cost,
+			std::vector<Value>& evicted) {
+			auto it = m_index.find(key);
+			if (it != m_index.end()) {
+				m_cost -= it->second->cost;
+				evicted.emplace_back(std::move(it->second->value));
+				m_entries.erase(it->second);
+				m_index.erase(it);
+			}
+			if (cost > m_budget) {
+				evicted.emplace_back(std::move(value));
+				return;
+			}
+			m_entries.push_front(Entry{ key, std::move(value), cost });
+			m_index[key] = m_entries.begin();
+			m_cost += cost;
+			trim(evicted);
+		}
+
+		// Move an entry out of the cache. Returns false on a miss.
+		bool take(const Key& key, Value& value) {
+			auto it = m_index.find(key);
+			if (it == m_index.end())
+				return false;
+			value = std::move(it->second->value);
+			m_cost -= it->second->cost;
+			m_entries.erase(it->second);
+			m_index.erase(it);
+			return true;
+		}
+
+		// Move every entry out of the cache.
+		void clear(std::vector<Value>& evicted) {
+			for (auto& e : m_entries)
+				evicted.emplace_back(std::move(e.value));
+			m_entries.clear();
+			m_index.clear();
+			m_cost = 0;
+		}
+
+	private:
+		struct Entry {
+			Key		key;
+			Value	value;
+			size_t	cost;
+		};
+		typedef typename std::list<Entry>::iterator EntryIter;
+
+		std::list<Entry>					m_entries;
+		std::unordered_map<Key, EntryIter>	m_index;
+		size_t								m_budget;
+		size_t								m_cost;
+
+		void trim(std::vector<Value>& evicted) {
+			while (m_cost > m_budget && !m_entries.empty()) {
+				Entry& e = m_entries.back();
+				m_cost -= e.cost;
+				evicted.emplace_back(std::move(e.value));
+				m_index.erase(e.key);
+				m_entries.pop_back();
+			}
+		}
+	};
+}
@@ -36,6 +36,9 @@
 #define P_AFTER_TEXT			"After Video Text"
 #define P_VIDEO_GENERATE		"Generate"
 #define P_MASKFOLDER			"maskFolder"
+#define P_MASK_CACHE_SIZE		"maskCacheSize"
+#define P_MASK_PREWARM			"maskPrewarm"
+#define P_RESOURCE_CACHE_SIZE	"resourceCacheSize"
 #define P_DEACTIVATE			"deactivated"
 #define P_DRAWMASK				"drawmask"
 #define P_DRAWALERT				"drawAlert"
@@ -69,4 +72,6 @@ static const char* const kDefaultMask = "";
 static const char* const kDefaultMaskFolder = "";
 static const char* const kDefaultBeforeText = "Before";
 static const char* const kDefaultAfterText	= "After";
+static const int kDefaultMaskCacheSize = 256;
+static const int kDefaultResourceCacheSize = 256;
 
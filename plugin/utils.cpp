@@ -28,6 +28,8 @@
 
 #include <immintrin.h>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
 
 #include <assert.h>
 
@@ -222,6 +224,52 @@ namespace Utils {
 		_mm_sfence();
 	}
 
+	// MurmurHash64A
+	//
+	// https://github.com/aappleby/smhasher
+	//
+	// fast content hash for resource payloads. chain calls by passing
+	// the previous hash as the seed.
+	uint64_t hash64(const void* data, size_t size, uint64_t seed) {
+		const uint64_t m = 0xc6a4a7935bd1e995ULL;
+		const int r = 47;
+
+		uint64_t h = seed ^ (size * m);
+		const uint8_t* p = (const uint8_t*)data;
+		const uint8_t* end = p + (size & ~(size_t)7);
+		for (; p != end; p += 8) {
+			uint64_t k;
+			memcpy(&k, p, sizeof(k));
+			k *= m;
+			k ^= k >> r;
+			k *= m;
+			h ^= k;
+			h *= m;
+		}
+
+		switch (size & 7) {
+		case 7: h ^= uint64_t(p[6]) << 48;
+		case 6: h ^= uint64_t(p[5]) << 40;
+		case 5: h ^= uint64_t(p[4]) << 32;
+		case 4: h ^= uint64_t(p[3]) << 24;
+		case 3: h ^= uint64_t(p[2]) << 16;
+		case 2: h ^= uint64_t(p[1]) << 8;
+		case 1: h ^= uint64_t(p[0]);
+			h *= m;
+		};
+
+		h ^= h >> r;
+		h *= m;
+		h ^= h >> r;
+		return h;
+	}
+
+	std::string hash64ToString(uint64_t hash) {
+		char buf[17];
+		snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)hash);
+		return buf;
+	}
+
 	int count_spaces(const std::string& s) {
 		const char* p = s.data();
 		if (!p) return 0;
@@ -61,6 +61,8 @@ namespace Utils {
 
 	extern float hermite(float t, float p1, float p2, float t1 = 0.0f, float t2 = 0.0f);
 	extern void fastMemcpy(void *pvDest, void *pvSrc, size_t nBytes);
+	extern uint64_t hash64(const void* data, size_t size, uint64_t seed = 0);
+	extern std::string hash64ToString(uint64_t hash);
 
 	extern std::wstring ConvertStringToWstring(const std::string &str);
 	extern std::string ConvertWstringToString(const std::wstring& s);
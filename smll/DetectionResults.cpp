@@ -21,6 +21,8 @@
 #include "DetectionResults.hpp"
 #include "Config.hpp"
 
+#include <stdexcept>
+
 
 
 // how many frames before we consider a face "lost"
@@ -57,6 +59,34 @@ namespace smll {
 		translation[2] = cvTrs.at<double>(2, 0);
 	}
 
+	void ThreeDPose::SetPose(const double rvec[3], const double tvec[3]) {
+		// same as above, without the cv::Mat round trip
+		double angle = sqrt(rvec[0] * rvec[0] + rvec[1] * rvec[1] + rvec[2] * rvec[2]);
+		if (angle < 0.0001) {
+			rotation[0] = 0.0;
+			rotation[1] = 1.0;
+			rotation[2] = 0.0;
+			rotation[3] = 0.0;
+		}
+		else {
+			rotation[0] = rvec[0] / angle;
+			rotation[1] = rvec[1] / angle;
+			rotation[2] = rvec[2] / angle;
+			rotation[3] = angle;
+		}
+
+		translation[0] = tvec[0];
+		translation[1] = tvec[1];
+		translation[2] = tvec[2];
+	}
+
+	void ThreeDPose::GetRodrigues(double rvec[3], double tvec[3]) const {
+		for (int i = 0; i < 3; i++) {
+			rvec[i] = rotation[i] * rotation[3];
+			tvec[i] = translation[i];
+		}
+	}
+
 	cv::Mat ThreeDPose::GetCVRotation() const {
 		cv::Mat m = (cv::Mat_<double>(3, 1) << rotation[0] * rotation[3],
 											   rotation[1] * rotation[3],
@@ -169,7 +199,7 @@ namespace smll {
 
 	}
 
-	void DetectionResults::CorrelateAndUpdateFrom(DetectionResults& other) {
+	void DetectionResults::CorrelateAndUpdateFrom(DetectionResults& other, DetectionFilters& filters) {
 
 		DetectionResults& faces = *this;
 
@@ -185,7 +215,7 @@ namespace smll {
 				int closest = other.findClosest(faces[i]);
 
 				// smooth new face into ours
-				faces[i].UpdateResultsFrom(other[closest]);
+				faces[i].UpdateResultsFrom(other[closest], filters);
 				faces[i].numFramesLost = 0;
 				other[closest].matched = true;
 			}
@@ -195,6 +225,7 @@ namespace smll {
 					// copy new face
 					faces[faces.length] = other[i];
 					faces[faces.length].numFramesLost = 0;
+					faces[faces.length].filterIndex = filters.Acquire();
 					other[i].matched = true;
 					faces.length++;
 				}
@@ -213,7 +244,7 @@ namespace smll {
 				int closest = faces.findClosest(other[i]);
 
 				// smooth new face into ours
-				faces[closest].UpdateResultsFrom(other[i]);
+				faces[closest].UpdateResultsFrom(other[i], filters);
 				faces[closest].numFramesLost = 0;
 				faces[closest].matched = true;
 			}
@@ -224,6 +255,7 @@ namespace smll {
 					faces[i].numFramesLost++;
 					if (faces[i].numFramesLost > NUM_FRAMES_TO_LOSE_FACE) {
 						// remove face
+						filters.Release(faces[i].filterIndex);
 						for (int j = i; j < (faces.length - 1); j++) {
 							faces[j] = faces[j + 1];
 						}
@@ -259,27 +291,7 @@ namespace smll {
 
 
 	DetectionResult::DetectionResult() 
-		: matched(false), numFramesLost(0), kalmanFilterInitialized(false), initedStartPose(false) {
-		nStates = 18;
-		nMeasurements = 6;
-		nInputs = 0;
-		dt = 0.125; // TODO: Change this as per the FPS of tracker.
-	}
-
-	DetectionResult::~DetectionResult() {
-	}
-
-	DetectionResult& DetectionResult::operator=(const DetectionResult& r) {
-		bounds = r.bounds;
-		pose.CopyPoseFrom(r.pose);
-		
-		for (int i = 0; i < NUM_FACIAL_LANDMARKS; i++) {
-			landmarks68[i] = r.landmarks68[i];
-		}
-
-		kalmanFilterInitialized = false;
-		initedStartPose = false;
-		return *this;
+		: initedStartPose(false), matched(false), numFramesLost(0), filterIndex(-1) {
 	}
 
 	DetectionResult& DetectionResult::operator=(const Face& f) {
@@ -289,12 +301,10 @@ namespace smll {
 
 	void DetectionResult::SetPose(const ThreeDPose& p) {
 		pose.CopyPoseFrom(p);
-		kalmanFilterInitialized = false;
 	}
 
 	void DetectionResult::SetPose(cv::Mat cvRot, cv::Mat cvTrs) {
 		pose.SetPose(cvRot, cvTrs);
-		kalmanFilterInitialized = false;
 	}
 
 	cv::Mat DetectionResult::GetCVRotation() const {
@@ -313,6 +323,12 @@ namespace smll {
 		pose.CopyPoseFrom(r.pose);
 	}
 
+	void DetectionResult::CopyMeasurementFrom(const DetectionResult& r) {
+		bounds = r.bounds;
+		pose.CopyPoseFrom(r.pose);
+		landmarks68 = r.landmarks68;
+	}
+
 	void DetectionResult::InitStartPose() {
 		if (!initedStartPose) {
 			startPose.rotation[0] = 0.0;
@@ -326,16 +342,35 @@ namespace smll {
 		}
 	}
 
-	void DetectionResult::UpdateResultsFrom(const DetectionResult& r) {
+	void DetectionResult::UpdateResultsFrom(const DetectionResult& r, DetectionFilters& filters) {
+		if (filterIndex < 0) {
+			filterIndex = filters.Acquire();
+		}
+		filters[filterIndex].Update(*this, r);
+	}
+
+
+	DetectionFilter::DetectionFilter()
+		: kalmanFilterInitialized(false) {
+		nStates = 18;
+		nMeasurements = 6;
+		nInputs = 0;
+		dt = 0.125; // TODO: Change this as per the FPS of tracker.
+	}
+
+	void DetectionFilter::Reset() {
+		kalmanFilterInitialized = false;
+	}
+
+	void DetectionFilter::Update(DetectionResult& smoothed, const DetectionResult& r) {
 
 		if (!kalmanFilterInitialized) {
-			*this = r;
-			for (int i = 0; i < smll::NUM_FACIAL_LANDMARKS; i++) {
-				landmarks68[i] = r.landmarks68[i];
-			}
-			InitKalmanFilter();
+			smoothed.CopyMeasurementFrom(r);
+			InitKalmanFilter(r);
 		}
 
+		ThreeDPose& pose = smoothed.pose;
+
 		double ntx[3] = { r.pose.translation[0], r.pose.translation[1], r.pose.translation[2] };
 		double nrot[4] = { r.pose.rotation[0], r.pose.rotation[1], r.pose.rotation[2], r.pose.rotation[3] };
 		dlib::rectangle bnd = r.bounds;
@@ -394,26 +429,26 @@ namespace smll {
 		}
 
 		// copy values
-		bounds = bnd;
+		smoothed.bounds = bnd;
 		double smoothing = Config::singleton().get_double(CONFIG_FLOAT_SMOOTHING_FACTOR);
 		for (int i = 0; i < smll::NUM_FACIAL_LANDMARKS; i++) {
 			bool landmark_smoothing = Config::singleton().get_bool((std::string(CONFIG_BOOL_SMOOTH_LANDMARK) + std::to_string(i + 1)).c_str());
 			if (landmark_smoothing) {
 				kalmanFilters[2 * i].SetMeasurementNoiseCovariance(smoothing);
 				kalmanFilters[2 * i + 1].SetMeasurementNoiseCovariance(smoothing);
-				double x = kalmanFilters[2 * i].Update(r.landmarks68[i].x());
-				double y = kalmanFilters[2 * i + 1].Update(r.landmarks68[i].y());
-				landmarks68[i] = dlib::point(x, y);
+				double x = kalmanFilters[2 * i].Update(r.landmarks68.x[i]);
+				double y = kalmanFilters[2 * i + 1].Update(r.landmarks68.y[i]);
+				smoothed.landmarks68.Set(i, (float)x, (float)y);
 			}
 			else {
-				landmarks68[i] = r.landmarks68[i];
+				smoothed.landmarks68.Set(i, r.landmarks68.x[i], r.landmarks68.y[i]);
 			}
 
 		}
 		
 	}
 
-	void DetectionResult::InitKalmanFilter() {
+	void DetectionFilter::InitKalmanFilter(const DetectionResult& r) {
 		if (Config::singleton().get_bool(CONFIG_BOOL_KALMAN_ENABLE)) {
 			kalmanFilter.init(nStates, nMeasurements, nInputs, CV_64F);					// init Kalman Filter
 			cv::setIdentity(kalmanFilter.processNoiseCov, cv::Scalar::all(1e-5));		// set process noise
@@ -479,8 +514,8 @@ namespace smll {
 			double smoothing = Config::singleton().get_double(CONFIG_FLOAT_SMOOTHING_FACTOR);
 			for (size_t i = 0; i < NUM_FACIAL_LANDMARKS; i++)
 			{
-				kalmanFilters[2*i].Init(landmarks68[i].x());
-				kalmanFilters[2 * i + 1].Init(landmarks68[i].y());
+				kalmanFilters[2*i].Init(r.landmarks68.x[i]);
+				kalmanFilters[2 * i + 1].Init(r.landmarks68.y[i]);
 				kalmanFilters[2 * i].SetMeasurementNoiseCovariance(smoothing);
 				kalmanFilters[2 * i + 1].SetMeasurementNoiseCovariance(smoothing);
 			}
@@ -489,7 +524,7 @@ namespace smll {
 		}
 	}
 
-	void DetectionResult::UpdateKalmanFilter(cv::Mat& measurements, cv::Mat& translationEstimated, cv::Mat& eulersEstimated) {
+	void DetectionFilter::UpdateKalmanFilter(cv::Mat& measurements, cv::Mat& translationEstimated, cv::Mat& eulersEstimated) {
 		// First predict, to update the internal statePre variable  
 		cv::Mat prediction = kalmanFilter.predict();
 
@@ -507,4 +542,32 @@ namespace smll {
 		eulersEstimated.at<double>(2) = estimated.at<double>(11);
 	}
 
+
+
+	DetectionFilters::DetectionFilters() {
+		m_inUse.fill(false);
+	}
+
+	int DetectionFilters::Acquire() {
+		for (int i = 0; i < MAX_FACES; i++) {
+			if (!m_inUse[i]) {
+				m_inUse[i] = true;
+				m_filters[i].Reset();
+				return i;
+			}
+		}
+		// can't happen: we never track more than MAX_FACES
+		throw std::runtime_error("DetectionFilters: no free filter slots");
+	}
+
+	void DetectionFilters::Release(int idx) {
+		if (idx >= 0 && idx < MAX_FACES) {
+			m_inUse[idx] = false;
+		}
+	}
+
+	void DetectionFilters::ReleaseAll() {
+		m_inUse.fill(false);
+	}
+
 }
@@ -49,8 +49,10 @@ namespace smll {
 		ThreeDPose();
 
 		void SetPose(cv::Mat cvRot, cv::Mat cvTrs);
+		void SetPose(const double rvec[3], const double tvec[3]);
 		cv::Mat GetCVRotation() const;
 		cv::Mat GetCVTranslation() const;
+		void GetRodrigues(double rvec[3], double tvec[3]) const;
 
 		double DistanceTo(const ThreeDPose& r) const;
 		void CopyPoseFrom(const ThreeDPose& r);
@@ -85,6 +87,15 @@ namespace smll {
 	typedef sarray<ThreeDPose, MAX_FACES> ThreeDPoses;
 
 
+	class DetectionFilters;
+
+	// DetectionResult : the measurement for one face
+	//
+	// - plain data only, so results can be handed between threads
+	//   with a straight copy
+	// - smoothing state lives in DetectionFilters, and is looked
+	//   up with filterIndex
+	//
 	class DetectionResult
 	{
 	public:
@@ -92,7 +103,7 @@ namespace smll {
 		dlib::rectangle		bounds;
 
 		// facial landmarks (68 point)
-		dlib::point			landmarks68[NUM_FACIAL_LANDMARKS];
+		LandmarkPoints		landmarks68;
 
 		// 3D pose 
 		ThreeDPose			pose;
@@ -101,9 +112,6 @@ namespace smll {
 		bool				initedStartPose;
 
 		DetectionResult();
-		DetectionResult(const DetectionResult& r) { *this = r; }
-		~DetectionResult();
-		DetectionResult& operator=(const DetectionResult& r);
 		DetectionResult& operator=(const Face& f);
 
 		void SetPose(const ThreeDPose& p);
@@ -112,8 +120,9 @@ namespace smll {
 		cv::Mat GetCVTranslation() const;
 
 		void CopyPoseFrom(const DetectionResult& r);
+		void CopyMeasurementFrom(const DetectionResult& r);
 		void InitStartPose();
-		void UpdateResultsFrom(const DetectionResult& r);
+		void UpdateResultsFrom(const DetectionResult& r, DetectionFilters& filters);
 
 		double DistanceTo(const DetectionResult& r) const;
 
@@ -126,6 +135,20 @@ namespace smll {
 		bool matched;
 		int numFramesLost;
 
+		// slot in DetectionFilters, -1 if none
+		int filterIndex;
+	};
+
+
+	// DetectionFilter : smoothing state for one tracked face
+	//
+	class DetectionFilter
+	{
+	public:
+		DetectionFilter();
+
+		void Reset();
+		void Update(DetectionResult& smoothed, const DetectionResult& measured);
 
 	private:
 		// Kalman Filter variables
@@ -138,8 +161,34 @@ namespace smll {
 		bool kalmanFilterInitialized;
 
 		// Kalman Filter methods
-		void InitKalmanFilter();
+		void InitKalmanFilter(const DetectionResult& r);
 		void UpdateKalmanFilter(cv::Mat& measurements, cv::Mat& translationEstimated, cv::Mat& eulersEstimated);
+
+		// SingleValueKalman owns a raw pointer
+		DetectionFilter(const DetectionFilter&) = delete;
+		DetectionFilter& operator=(const DetectionFilter&) = delete;
+	};
+
+
+	// DetectionFilters : fixed pool of filters, one per tracked face
+	//
+	// - slots stay put while faces come and go, so removing a face
+	//   only shifts the (plain data) results
+	//
+	class DetectionFilters
+	{
+	public:
+		DetectionFilters();
+
+		int Acquire();
+		void Release(int idx);
+		void ReleaseAll();
+
+		DetectionFilter& operator[](int idx) { return m_filters[idx]; }
+
+	private:
+		std::array<DetectionFilter, MAX_FACES>	m_filters;
+		std::array<bool, MAX_FACES>				m_inUse;
 	};
 
 
@@ -147,7 +196,7 @@ namespace smll {
 	{
 	public:
 		DetectionResults();
-		void CorrelateAndUpdateFrom(DetectionResults& other);
+		void CorrelateAndUpdateFrom(DetectionResults& other, DetectionFilters& filters);
 		int findClosest(const smll::DetectionResult& result);
 		ProcessedResults processedResults;
 		dlib::rectangle motionRect;
@@ -34,11 +34,20 @@
 #define FACEMASK_AVX		(L"facemask_AVX.dll")
 #define FACEMASK_NO_AVX		(L"facemask_NO_AVX.dll")
 
-typedef void(*facemask_init_face_detector)(dlib::frontal_face_detector&);
 typedef std::vector<dlib::rectangle>(*facemask_detect_faces)(dlib::frontal_face_detector&, dlib::cv_image<unsigned char>&);
 
-static const char* const kFileShapePredictor68 = "shape_predictor_68_face_landmarks.dat";
-static const char* const kFileFaceDetector = "FD.dat";
+
+// Landmarks used for solving 3D pose
+static const int kPoseModelIndices[] = {
+	smll::LEFT_OUTER_EYE_CORNER,
+	smll::RIGHT_OUTER_EYE_CORNER,
+	smll::NOSE_1,
+	smll::NOSE_2,
+	smll::NOSE_3,
+	smll::NOSE_4,
+	smll::NOSE_7,
+};
+static const int kNumPoseModelPoints = sizeof(kPoseModelIndices) / sizeof(kPoseModelIndices[0]);
 
 using namespace dlib;
 using namespace std;
@@ -59,72 +68,23 @@ namespace smll {
 		, loaded(false)
 		, avx(false)
 		, hGetProcIDDLL(NULL) {
-		// Load face detection and pose estimation models.
-
-		char *filename_fd = obs_module_file(kFileFaceDetector);
-		if (!filename_fd) {
-			PLOG_ERROR("Failed to get face detector file path");
-			throw std::runtime_error("Failed to get face detector file path");
-		}
-
-		PLOG_INFO("Face Detector File: %s.", filename_fd);
-
+		// Get the face detection and landmark models. These are
+		// shared by all detectors, and only loaded the first time.
 #ifdef PUBLIC_RELEASE
 		load_dll();
-		facemask_init_face_detector fcn = (facemask_init_face_detector)GetProcAddress(hGetProcIDDLL, "facemask_init_face_detector");
-		if (fcn) {
-			fcn(m_detector);
-		}
-#else
-		m_detector = get_frontal_face_detector();
 #endif
-		std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converterFD;
-		std::wstring wide_filenameFD(converterFD.from_bytes(filename_fd));
-		std::ifstream detector_file(wide_filenameFD.c_str(), std::ios::binary);
-		if (!detector_file) {
-			throw std::runtime_error("Failed to open face detector file");
-		}
-#ifdef _WIN32
-		deserialize(m_detector, detector_file);
-#else
-		deserialize(filename) >> m_predictor68;
-#endif
-
-		// set the overlap out
-		dlib::test_box_overlap overlap_bounds(0.15, 0.75);
-		m_detector.set_overlap_tester(overlap_bounds);
+		// the HOG detector has scratch state, so we keep our own copy
+		m_sharedDetector = ModelStore::singleton().GetFaceDetector();
+		m_detector = *m_sharedDetector;
+		m_predictor68 = ModelStore::singleton().GetShapePredictor68();
 		count = 0;
-		
-		char *filename = obs_module_file(kFileShapePredictor68);
-		if (!filename) {
-			PLOG_ERROR("Failed to get predictor68 file path");
-			throw std::runtime_error("Failed to get predictor68 file path");
-		}
-
-		PLOG_INFO("Shape Predictor File: %s.", filename);
-
-#ifdef _WIN32
-		std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-		std::wstring wide_filename(converter.from_bytes(filename));
-
-		/* DLIB will not accept a wifstream or widestring to construct
-		 * an ifstream or wifstream itself. Here we use a non-standard
-		 * constructor provided by Microsoft and then the direct
-		 * serialization function with an ifstream. */
-		std::ifstream predictor68_file(wide_filename.c_str(), std::ios::binary);
-
-		if (!predictor68_file) {
-			PLOG_ERROR("Cannot Open Shape Predictor File, Error: %s.", strerror(errno));
-			throw std::runtime_error("Failed to open predictor68 file");
-		}
-
-		deserialize(m_predictor68, predictor68_file);
-#else
-		deserialize(filename) >> m_predictor68;
-#endif
-		bfree(filename);
-		bfree(filename_fd);
 
+		// model points for pose estimation never change
+		std::vector<int> model_indices(kPoseModelIndices,
+			kPoseModelIndices + kNumPoseModelPoints);
+		m_poseModelPoints = GetLandmarkPoints(model_indices);
+		m_poseSolver.SetModelPoints(m_poseModelPoints.data(),
+			(int)m_poseModelPoints.size());
 	}
 
 	FaceDetector::~FaceDetector() {
@@ -187,6 +147,8 @@ namespace smll {
 					0,			  0,			1);
 			// We assume no lens distortion
 			m_dist_coeffs = cv::Mat::zeros(4, 1, cv::DataType<float>::type);
+
+			m_poseSolver.SetCamera(focal_length, center.x, center.y);
 		}
 	}
 	void FaceDetector::computeDifference(DetectionResults& results) {
@@ -407,10 +369,10 @@ namespace smll {
 		std::vector<cv::Point2f> points;
 
 		// add facial landmark points
-		dlib::point* facePoints = face.landmarks68;
+		points.reserve(NUM_FACIAL_LANDMARKS + HP_NUM_HEAD_POINTS);
+		const LandmarkPoints& facePoints = face.landmarks68;
 		for (int i = 0; i < NUM_FACIAL_LANDMARKS; i++) {
-			points.push_back(cv::Point2f((float)facePoints[i].x(),
-				(float)facePoints[i].y()));
+			points.push_back(facePoints[i]);
 		}
 
 		// add the head points
@@ -1131,7 +1093,7 @@ namespace smll {
 
 			dlib::cv_image<unsigned char> img(grayImage);
 
-			d68 = m_predictor68(img, m_faces[f].m_bounds);
+			d68 = (*m_predictor68)(img, m_faces[f].m_bounds);
 
 			// Sanity check
 			if (d68.num_parts() != NUM_FACIAL_LANDMARKS)
@@ -1139,41 +1101,17 @@ namespace smll {
 					"shape predictor got wrong number of landmarks");
 
 			for (int j = 0; j < NUM_FACIAL_LANDMARKS; j++) {
-				results[f].landmarks68[j] = point(d68.part(j).x(), d68.part(j).y());
+				results[f].landmarks68.Set(j, (float)d68.part(j).x(), (float)d68.part(j).y());
 			}
 		}
 
 		results.length = m_faces.length;
 	}
 
-	float FaceDetector::ReprojectionError(const std::vector<cv::Point3f>& model_points,
-		const std::vector<cv::Point2f>& image_points,
-		const cv::Mat& rotation, const cv::Mat& translation) {
-
-		// reproject to check error
-		std::vector<cv::Point2f> projectedPoints;
-		cv::projectPoints(model_points, rotation, translation,
-			GetCVCamMatrix(), GetCVDistCoeffs(), projectedPoints);
-		// Compute error
-		std::vector<cv::Point2f> absDiff;
-		cv::absdiff(image_points, projectedPoints, absDiff);
-		float error = cv::sum(cv::mean(absDiff))[0];
-		return error;
-	}
-
-
 	void FaceDetector::DoPoseEstimation(DetectionResults& results)
 	{
-		// Build a set of model points to use for solving 3D pose
-		std::vector<int> model_indices;
-		model_indices.push_back(LEFT_OUTER_EYE_CORNER);
-		model_indices.push_back(RIGHT_OUTER_EYE_CORNER);
-		model_indices.push_back(NOSE_1);
-		model_indices.push_back(NOSE_2);
-		model_indices.push_back(NOSE_3);
-		model_indices.push_back(NOSE_4);
-		model_indices.push_back(NOSE_7);
-		std::vector<cv::Point3f> model_points = GetLandmarkPoints(model_indices);
+		// make sure the solver has the current camera
+		SetCVCamera();
 
 		if (m_poses.length != results.length) {
 			m_poses.length = results.length;
@@ -1182,48 +1120,54 @@ namespace smll {
 			}
 		}
 
-		float threshold = 4.0f * model_points.size();
+		const int numPoints = m_poseSolver.NumPoints();
+		float threshold = 4.0f * numPoints;
 		threshold *= ((float)CaptureWidth() / 1920.0f);
 
 		bool resultsBad = false;
 		for (int i = 0; i < results.length; i++) {
-			std::vector<cv::Point2f> image_points;
-			// copy 2D image points. 
-			point* p = results[i].landmarks68;
-			for (int j = 0; j < model_indices.size(); j++) {
-				int idx = model_indices[j];
-				image_points.push_back(cv::Point2f((float)p[idx].x(), (float)p[idx].y()));
+			// copy 2D image points
+			cv::Point2f image_points[PoseSolver::MAX_POINTS];
+			const LandmarkPoints& p = results[i].landmarks68;
+			for (int j = 0; j < numPoints; j++) {
+				image_points[j] = p[kPoseModelIndices[j]];
 			}
 
-			// Solve for pose
-			cv::Mat translation = m_poses[i].GetCVTranslation();
-			cv::Mat rotation = m_poses[i].GetCVRotation();
-			cv::solvePnP(model_points, image_points,
-				GetCVCamMatrix(), GetCVDistCoeffs(),
-				rotation, translation,
-				m_poses[i].PoseValid(),
-				cv::SOLVEPNP_EPNP);
+			// warm start from the previous pose, if we have one
+			double rvec[3], tvec[3];
+			bool prevValid = m_poses[i].PoseValid();
+			if (prevValid) {
+				m_poses[i].GetRodrigues(rvec, tvec);
+			}
+			else {
+				// cold start: get an initial guess from EPnP
+				std::vector<cv::Point2f> ip(image_points, image_points + numPoints);
+				cv::Mat rotation, translation;
+				cv::solvePnP(m_poseModelPoints, ip,
+					GetCVCamMatrix(), GetCVDistCoeffs(),
+					rotation, translation, false, cv::SOLVEPNP_EPNP);
+				for (int k = 0; k < 3; k++) {
+					rvec[k] = rotation.at<double>(k, 0);
+					tvec[k] = translation.at<double>(k, 0);
+				}
+			}
 
+			// Solve for pose
+			double error = m_poseSolver.Solve(image_points, rvec, tvec);
 
 			// TODO: Check if we still get wrong results.
-			if (translation.at<double>(2, 0) > 1000.0 ||
-				translation.at<double>(2, 0) < -1000.0) {
+			if (tvec[2] > 1000.0 || tvec[2] < -1000.0) {
 				resultsBad = true;
 				m_poses.length = 0;
 				break;
 			}
 
-			// TODO: If possible, remove these sanity checks
 			// NOTE: If no pose is generated, use previous pose.
-			if (m_poses[i].PoseValid() &&
-				ReprojectionError(model_points, image_points, rotation, translation) > threshold) {
-				// reset pose
-				translation = m_poses[i].GetCVTranslation();
-				rotation = m_poses[i].GetCVRotation();
+			if (!prevValid || error <= threshold) {
+				m_poses[i].SetPose(rvec, tvec);
 			}
 
 			// Save it
-			m_poses[i].SetPose(rotation, translation);
 			results[i].SetPose(m_poses[i]);
 		}
 
@@ -28,6 +28,8 @@
 #include "DetectionResults.hpp"
 #include "TriangulationResult.hpp"
 #include "MorphData.hpp"
+#include "PoseSolver.hpp"
+#include "ModelStore.hpp"
 
 #include <stdexcept>
 
@@ -96,11 +98,13 @@ private:
 	// Tracking time-slicer
 	int				m_trackingFaceIndex;
 
-	// dlib HOG face detector
+	// dlib HOG face detector. detecting isn't const, so we run our
+	// own copy, and hold the shared one so the store keeps it loaded
+	ModelStore::FaceDetectorPtr		m_sharedDetector;
 	dlib::frontal_face_detector		m_detector;
 
-	// dlib landmark predictors (68 point)
-	dlib::shape_predictor			m_predictor68;
+	// dlib landmark predictors (68 point, shared)
+	ModelStore::ShapePredictorPtr	m_predictor68;
 
 	// openCV camera (saved for convenience)
 	int				m_camera_w, m_camera_h;
@@ -167,9 +171,8 @@ private:
 	void 	UnstageCaptureTexture();
 
 	// For 3d pose
-	float	ReprojectionError(const std::vector<cv::Point3f>& model_points,
-		const std::vector<cv::Point2f>& image_points,
-		const cv::Mat& rotation, const cv::Mat& translation);
+	PoseSolver					m_poseSolver;
+	std::vector<cv::Point3f>	m_poseModelPoints;
 
 	// Morph Triangulation Helpers
 	void	Subdivide(std::vector<cv::Point2f>& points);
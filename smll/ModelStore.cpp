@@ -0,0 +1,107 @@
+/*
+* Face Masks for SlOBS
+* smll - streamlabs machine learning library
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#include "ModelStore.hpp"
+#include "../Plugin/plugin.h"
+
+#include <libobs/obs-module.h>
+#include <codecvt>
+#include <fstream>
+#include <locale>
+#include <stdexcept>
+#include <string>
+
+static const char* const kFileShapePredictor68 = "shape_predictor_68_face_landmarks.dat";
+static const char* const kFileFaceDetector = "FD.dat";
+
+namespace smll {
+
+	static ModelStore g_modelStore;
+
+	ModelStore& ModelStore::singleton() {
+		return g_modelStore;
+	}
+
+	// Open a model file from the plugin data folder. Throws on failure.
+	static std::ifstream OpenModelFile(const char* name) {
+		char *filename = obs_module_file(name);
+		if (!filename) {
+			PLOG_ERROR("Failed to get model file path: %s", name);
+			throw std::runtime_error("Failed to get model file path");
+		}
+		PLOG_INFO("Loading Model File: %s.", filename);
+
+		/* DLIB will not accept a wifstream or widestring to construct
+		 * an ifstream or wifstream itself. Here we use a non-standard
+		 * constructor provided by Microsoft and then the direct
+		 * serialization function with an ifstream. */
+#ifdef _WIN32
+		std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+		std::wstring wide_filename(converter.from_bytes(filename));
+		std::ifstream file(wide_filename.c_str(), std::ios::binary);
+#else
+		std::ifstream file(filename, std::ios::binary);
+#endif
+		bfree(filename);
+
+		if (!file) {
+			PLOG_ERROR("Cannot Open Model File, Error: %s.", strerror(errno));
+			throw std::runtime_error("Failed to open model file");
+		}
+		return file;
+	}
+
+	ModelStore::FaceDetectorPtr ModelStore::GetFaceDetector() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		FaceDetectorPtr detector = m_faceDetector.lock();
+		if (!detector) {
+			std::ifstream file = OpenModelFile(kFileFaceDetector);
+			std::shared_ptr<dlib::frontal_face_detector> d =
+				std::make_shared<dlib::frontal_face_detector>();
+			dlib::deserialize(*d, file);
+
+			// set the overlap out
+			dlib::test_box_overlap overlap_bounds(0.15, 0.75);
+			d->set_overlap_tester(overlap_bounds);
+
+			detector = d;
+			m_faceDetector = detector;
+		}
+		return detector;
+	}
+
+	ModelStore::ShapePredictorPtr ModelStore::GetShapePredictor68() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		ShapePredictorPtr predictor = m_predictor68.lock();
+		if (!predictor) {
+			std::ifstream file = OpenModelFile(kFileShapePredictor68);
+			std::shared_ptr<dlib::shape_predictor> p =
+				std::make_shared<dlib::shape_predictor>();
+			dlib::deserialize(*p, file);
+
+			predictor = p;
+			m_predictor68 = predictor;
+		}
+		return predictor;
+	}
+
+}
@@ -0,0 +1,68 @@
+/*
+* Face Masks for SlOBS
+* smll - streamlabs machine learning library
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#pragma once
+
+#pragma warning( push )
+#pragma warning( disable: 4127 )
+#pragma warning( disable: 4201 )
+#pragma warning( disable: 4456 )
+#pragma warning( disable: 4458 )
+#pragma warning( disable: 4459 )
+#pragma warning( disable: 4505 )
+#pragma warning( disable: 4267 )
+#pragma warning( disable: 4100 )
+#include <dlib/image_processing/frontal_face_detector.h>
+#include <dlib/image_processing.h>
+#pragma warning( pop )
+
+#include <memory>
+#include <mutex>
+
+namespace smll {
+
+	// ModelStore : process-wide, read-only detection models
+	//
+	// - each model is deserialized once and shared by every
+	//   FaceDetector that is alive
+	// - models are refcounted, and freed when the last
+	//   FaceDetector using them goes away
+	// - shape_predictor is const-callable, so it is shared as is.
+	//   the HOG detector keeps a scratch image pyramid in its
+	//   operator(), so users copy it from here (in memory, no disk)
+	//
+	class ModelStore
+	{
+	public:
+		typedef std::shared_ptr<const dlib::frontal_face_detector>	FaceDetectorPtr;
+		typedef std::shared_ptr<const dlib::shape_predictor>		ShapePredictorPtr;
+
+		static ModelStore& singleton();
+
+		FaceDetectorPtr		GetFaceDetector();
+		ShapePredictorPtr	GetShapePredictor68();
+
+	private:
+		std::mutex											m_mutex;
+		std::weak_ptr<const dlib::frontal_face_detector>	m_faceDetector;
+		std::weak_ptr<const dlib::shape_predictor>			m_predictor68;
+	};
+
+}
@@ -251,7 +251,7 @@ namespace smll {
 		}
 	}
 
-	void OBSRenderer::DrawLandmarks(const dlib::point* points, 
+	void OBSRenderer::DrawLandmarks(const LandmarkPoints& points, 
 		bool * checklist) {
 		// landmarks
 		SetDrawColor(0, 255, 0);
@@ -696,16 +696,16 @@ namespace smll {
 		gs_vertexbuffer_destroy(vertbuff);
 	}
 
-	void	OBSRenderer::drawPoints(const dlib::point* points, int start,
+	void	OBSRenderer::drawPoints(const LandmarkPoints& points, int start,
 		int end, bool * checklist) {
 		// make vb
 		gs_render_start(true);
 		// verts
-		for (int i = start; i <= end; i++) {
+		for (int i = start; i < end; i++) {
 			if (checklist[i]) {
 				for (int j = -2; j < 2; j++) {
 					for (int k = -2; k < 2; k++) {
-						gs_vertex2f((float)points[i].x() + j, (float)points[i].y() + k);
+						gs_vertex2f(points.x[i] + j, points.y[i] + k);
 					}
 				}
 			}
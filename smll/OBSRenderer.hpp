@@ -66,7 +66,7 @@ namespace smll {
 		void    DestroyVertexBufffer(int which);
 
 		void	DrawFaces(const DetectionResults& faces);
-		void	DrawLandmarks(const dlib::point* points, bool * checklist);
+		void	DrawLandmarks(const LandmarkPoints& points, bool * checklist);
 		void	DrawRect(const dlib::rectangle& r, int width = 1);
 
 		void    DrawGlasses(const DetectionResult& face, int texture);
@@ -103,7 +103,7 @@ namespace smll {
 		struct vec4					veccol;
 		void						drawLines(const dlib::point* points,
 			int start, int end, bool closed = false);
-		void						drawPoints(const dlib::point* points,
+		void						drawPoints(const LandmarkPoints& points,
 			int start, int end, bool * checklist);
 		void						drawLine(const dlib::point* points,
 			int start, int end);
@@ -0,0 +1,328 @@
+/*
+* Face Masks for SlOBS
+* smll - streamlabs machine learning library
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#include "PoseSolver.hpp"
+
+#include <cmath>
+#include <cfloat>
+
+// number of pose parameters (3 rotation + 3 translation)
+#define NUM_POSE_PARAMS		(6)
+// points behind (or on) the camera plane get this cost
+#define BAD_COST			(DBL_MAX / 4.0)
+// stop iterating when the update gets this small
+#define MIN_STEP_SQ			(1e-12)
+
+namespace smll {
+
+	// Solve A x = b for a 6x6 system, gaussian elimination with
+	// partial pivoting. A and b are trashed.
+	static bool Solve6x6(double A[NUM_POSE_PARAMS][NUM_POSE_PARAMS],
+		double b[NUM_POSE_PARAMS], double x[NUM_POSE_PARAMS]) {
+		const int n = NUM_POSE_PARAMS;
+		for (int c = 0; c < n; c++) {
+			// pivot
+			int p = c;
+			for (int r = c + 1; r < n; r++) {
+				if (std::abs(A[r][c]) > std::abs(A[p][c]))
+					p = r;
+			}
+			if (std::abs(A[p][c]) < 1e-15)
+				return false;
+			if (p != c) {
+				for (int k = 0; k < n; k++)
+					std::swap(A[p][k], A[c][k]);
+				std::swap(b[p], b[c]);
+			}
+			// eliminate
+			for (int r = c + 1; r < n; r++) {
+				double f = A[r][c] / A[c][c];
+				for (int k = c; k < n; k++)
+					A[r][k] -= f * A[c][k];
+				b[r] -= f * b[c];
+			}
+		}
+		// back substitute
+		for (int r = n - 1; r >= 0; r--) {
+			double s = b[r];
+			for (int k = r + 1; k < n; k++)
+				s -= A[r][k] * x[k];
+			x[r] = s / A[r][r];
+		}
+		return true;
+	}
+
+	// out = A * B, 3x3 row major
+	static void MatMul3(const double A[9], const double B[9], double out[9]) {
+		for (int r = 0; r < 3; r++) {
+			for (int c = 0; c < 3; c++) {
+				out[r * 3 + c] = A[r * 3 + 0] * B[0 * 3 + c] +
+					A[r * 3 + 1] * B[1 * 3 + c] +
+					A[r * 3 + 2] * B[2 * 3 + c];
+			}
+		}
+	}
+
+	PoseSolver::PoseSolver()
+		: m_focal(1.0)
+		, m_cx(0.0)
+		, m_cy(0.0)
+		, m_numPoints(0) {
+	}
+
+	void PoseSolver::SetCamera(double focal, double cx, double cy) {
+		m_focal = focal;
+		m_cx = cx;
+		m_cy = cy;
+	}
+
+	void PoseSolver::SetModelPoints(const cv::Point3f* points, int count) {
+		if (count > MAX_POINTS)
+			throw std::invalid_argument("too many model points for pose solver");
+		for (int i = 0; i < count; i++) {
+			m_model[i][0] = points[i].x;
+			m_model[i][1] = points[i].y;
+			m_model[i][2] = points[i].z;
+		}
+		m_numPoints = count;
+	}
+
+	void PoseSolver::RodriguesToMatrix(const double r[3], double R[9]) {
+		double theta = std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+		if (theta < 1e-12) {
+			// first order: I + [r]x
+			R[0] = 1.0;   R[1] = -r[2]; R[2] = r[1];
+			R[3] = r[2];  R[4] = 1.0;   R[5] = -r[0];
+			R[6] = -r[1]; R[7] = r[0];  R[8] = 1.0;
+			return;
+		}
+		double kx = r[0] / theta;
+		double ky = r[1] / theta;
+		double kz = r[2] / theta;
+		double c = std::cos(theta);
+		double s = std::sin(theta);
+		double v = 1.0 - c;
+
+		R[0] = c + kx * kx * v;
+		R[1] = kx * ky * v - kz * s;
+		R[2] = kx * kz * v + ky * s;
+		R[3] = ky * kx * v + kz * s;
+		R[4] = c + ky * ky * v;
+		R[5] = ky * kz * v - kx * s;
+		R[6] = kz * kx * v - ky * s;
+		R[7] = kz * ky * v + kx * s;
+		R[8] = c + kz * kz * v;
+	}
+
+	void PoseSolver::MatrixToRodrigues(const double R[9], double r[3]) {
+		double c = (R[0] + R[4] + R[8] - 1.0) * 0.5;
+		if (c > 1.0) c = 1.0;
+		if (c < -1.0) c = -1.0;
+		double theta = std::acos(c);
+		double s = std::sin(theta);
+
+		double rx = R[7] - R[5];
+		double ry = R[2] - R[6];
+		double rz = R[3] - R[1];
+
+		if (theta < 1e-6) {
+			// tiny rotation
+			r[0] = rx * 0.5;
+			r[1] = ry * 0.5;
+			r[2] = rz * 0.5;
+		}
+		else if (s < 1e-6) {
+			// rotation of ~pi: R = 2kk' - I, pick the biggest axis
+			// component to avoid dividing by ~0
+			int i = 0;
+			if (R[4] > R[i * 4]) i = 1;
+			if (R[8] > R[i * 4]) i = 2;
+			double k[3];
+			k[i] = std::sqrt((R[i * 4] + 1.0) * 0.5);
+			for (int j = 0; j < 3; j++) {
+				if (j != i)
+					k[j] = (R[i * 3 + j] + R[j * 3 + i]) / (4.0 * k[i]);
+			}
+			r[0] = k[0] * theta;
+			r[1] = k[1] * theta;
+			r[2] = k[2] * theta;
+		}
+		else {
+			double f = theta / (2.0 * s);
+			r[0] = rx * f;
+			r[1] = ry * f;
+			r[2] = rz * f;
+		}
+	}
+
+	double PoseSolver::Residuals(const cv::Point2f* imagePoints, const double R[9],
+		const double t[3], double res[MAX_POINTS * 2]) const {
+		double cost = 0.0;
+		for (int i = 0; i < m_numPoints; i++) {
+			const double* X = m_model[i];
+			double x = R[0] * X[0] + R[1] * X[1] + R[2] * X[2] + t[0];
+			double y = R[3] * X[0] + R[4] * X[1] + R[5] * X[2] + t[1];
+			double z = R[6] * X[0] + R[7] * X[1] + R[8] * X[2] + t[2];
+			if (z <= 1e-6)
+				return BAD_COST;
+			double iz = 1.0 / z;
+			double du = m_focal * x * iz + m_cx - imagePoints[i].x;
+			double dv = m_focal * y * iz + m_cy - imagePoints[i].y;
+			res[i * 2 + 0] = du;
+			res[i * 2 + 1] = dv;
+			cost += du * du + dv * dv;
+		}
+		return cost;
+	}
+
+	double PoseSolver::ReprojectionError(const cv::Point2f* imagePoints,
+		const double rvec[3], const double tvec[3]) const {
+		if (m_numPoints == 0)
+			return 0.0;
+		double R[9];
+		RodriguesToMatrix(rvec, R);
+		double res[MAX_POINTS * 2];
+		if (Residuals(imagePoints, R, tvec, res) >= BAD_COST)
+			return DBL_MAX;
+		double ex = 0.0, ey = 0.0;
+		for (int i = 0; i < m_numPoints; i++) {
+			ex += std::abs(res[i * 2 + 0]);
+			ey += std::abs(res[i * 2 + 1]);
+		}
+		return (ex + ey) / (double)m_numPoints;
+	}
+
+	double PoseSolver::Solve(const cv::Point2f* imagePoints, double rvec[3],
+		double tvec[3], int maxIterations) const {
+
+		double R[9], t[3];
+		RodriguesToMatrix(rvec, R);
+		t[0] = tvec[0]; t[1] = tvec[1]; t[2] = tvec[2];
+
+		double res[MAX_POINTS * 2];
+		double cost = Residuals(imagePoints, R, t, res);
+		if (cost >= BAD_COST)
+			return DBL_MAX;
+
+		double lambda = 1e-3;
+		for (int iter = 0; iter < maxIterations; iter++) {
+
+			// build normal equations J'J and J'r
+			// - rotation is updated on the left: R <- exp(w) * R, so
+			//   d(Xc)/dw = -[R X]x and d(Xc)/dt = I
+			double H[NUM_POSE_PARAMS][NUM_POSE_PARAMS] = {};
+			double g[NUM_POSE_PARAMS] = {};
+			for (int i = 0; i < m_numPoints; i++) {
+				const double* X = m_model[i];
+				double px = R[0] * X[0] + R[1] * X[1] + R[2] * X[2];
+				double py = R[3] * X[0] + R[4] * X[1] + R[5] * X[2];
+				double pz = R[6] * X[0] + R[7] * X[1] + R[8] * X[2];
+				double x = px + t[0];
+				double y = py + t[1];
+				double z = pz + t[2];
+				double iz = 1.0 / z;
+				double fz = m_focal * iz;
+
+				// d(u,v)/d(Xc)
+				double ux = fz, uz = -fz * x * iz;
+				double vy = fz, vz = -fz * y * iz;
+
+				// -[p]x = [[0, pz, -py], [-pz, 0, px], [py, -px, 0]]
+				double Ju[NUM_POSE_PARAMS] = {
+					uz * py,
+					ux * pz - uz * px,
+					-ux * py,
+					ux, 0.0, uz };
+				double Jv[NUM_POSE_PARAMS] = {
+					-vy * pz + vz * py,
+					-vz * px,
+					vy * px,
+					0.0, vy, vz };
+
+				double ru = res[i * 2 + 0];
+				double rv = res[i * 2 + 1];
+				for (int a = 0; a < NUM_POSE_PARAMS; a++) {
+					g[a] += Ju[a] * ru + Jv[a] * rv;
+					for (int b = a; b < NUM_POSE_PARAMS; b++)
+						H[a][b] += Ju[a] * Ju[b] + Jv[a] * Jv[b];
+				}
+			}
+			for (int a = 0; a < NUM_POSE_PARAMS; a++)
+				for (int b = 0; b < a; b++)
+					H[a][b] = H[b][a];
+
+			// damped step, retry with more damping until cost goes down
+			bool improved = false;
+			double stepSq = 0.0;
+			for (int tries = 0; tries < 5 && !improved; tries++) {
+				double A[NUM_POSE_PARAMS][NUM_POSE_PARAMS];
+				double b[NUM_POSE_PARAMS];
+				double d[NUM_POSE_PARAMS];
+				for (int a = 0; a < NUM_POSE_PARAMS; a++) {
+					for (int c = 0; c < NUM_POSE_PARAMS; c++)
+						A[a][c] = H[a][c];
+					A[a][a] += lambda * (H[a][a] + 1e-9);
+					b[a] = -g[a];
+				}
+				if (!Solve6x6(A, b, d)) {
+					lambda *= 10.0;
+					continue;
+				}
+
+				double dR[9], newR[9], newT[3];
+				RodriguesToMatrix(d, dR);
+				MatMul3(dR, R, newR);
+				newT[0] = t[0] + d[3];
+				newT[1] = t[1] + d[4];
+				newT[2] = t[2] + d[5];
+
+				double newRes[MAX_POINTS * 2];
+				double newCost = Residuals(imagePoints, newR, newT, newRes);
+				if (newCost < cost) {
+					for (int k = 0; k < 9; k++) R[k] = newR[k];
+					t[0] = newT[0]; t[1] = newT[1]; t[2] = newT[2];
+					for (int k = 0; k < m_numPoints * 2; k++) res[k] = newRes[k];
+					cost = newCost;
+					lambda *= 0.1;
+					improved = true;
+					stepSq = 0.0;
+					for (int k = 0; k < NUM_POSE_PARAMS; k++)
+						stepSq += d[k] * d[k];
+				}
+				else {
+					lambda *= 10.0;
+				}
+			}
+			if (!improved || stepSq < MIN_STEP_SQ)
+				break;
+		}
+
+		MatrixToRodrigues(R, rvec);
+		tvec[0] = t[0]; tvec[1] = t[1]; tvec[2] = t[2];
+
+		double ex = 0.0, ey = 0.0;
+		for (int i = 0; i < m_numPoints; i++) {
+			ex += std::abs(res[i * 2 + 0]);
+			ey += std::abs(res[i * 2 + 1]);
+		}
+		return (ex + ey) / (double)m_numPoints;
+	}
+
+}
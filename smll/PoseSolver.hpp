@@ -0,0 +1,81 @@
+/*
+* Face Masks for SlOBS
+* smll - streamlabs machine learning library
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#pragma once
+
+#pragma warning( push )
+#pragma warning( disable: 4127 )
+#pragma warning( disable: 4201 )
+#pragma warning( disable: 4456 )
+#pragma warning( disable: 4458 )
+#pragma warning( disable: 4459 )
+#pragma warning( disable: 4505 )
+#pragma warning( disable: 4267 )
+#include <opencv2/opencv.hpp>
+#pragma warning( pop )
+
+namespace smll {
+
+	// PoseSolver : small-N perspective-n-point solver
+	//
+	// - Levenberg-Marquardt on the 6 pose parameters, with an
+	//   analytic jacobian and everything on the stack
+	// - meant to be warm-started from the previous pose, so it
+	//   usually converges in 2 or 3 iterations
+	// - assumes a pinhole camera with no lens distortion (which
+	//   is what we have always assumed for solvePnP)
+	//
+	class PoseSolver
+	{
+	public:
+		static const int MAX_POINTS = 8;
+		static const int MAX_ITERATIONS = 10;
+
+		PoseSolver();
+
+		void	SetCamera(double focal, double cx, double cy);
+		void	SetModelPoints(const cv::Point3f* points, int count);
+		int		NumPoints() const { return m_numPoints; }
+
+		// Refine rvec/tvec (openCV rodrigues vector & translation)
+		// in place. Returns the reprojection error of the result:
+		// mean abs x error + mean abs y error, in pixels.
+		double	Solve(const cv::Point2f* imagePoints, double rvec[3],
+			double tvec[3], int maxIterations = MAX_ITERATIONS) const;
+
+		// Reprojection error of a pose, same metric as above
+		double	ReprojectionError(const cv::Point2f* imagePoints,
+			const double rvec[3], const double tvec[3]) const;
+
+		// rotation helpers
+		static void	RodriguesToMatrix(const double r[3], double R[9]);
+		static void	MatrixToRodrigues(const double R[9], double r[3]);
+
+	private:
+		double		m_focal;
+		double		m_cx, m_cy;
+		double		m_model[MAX_POINTS][3];
+		int			m_numPoints;
+
+		double	Residuals(const cv::Point2f* imagePoints, const double R[9],
+			const double t[3], double res[MAX_POINTS * 2]) const;
+	};
+
+}
@@ -33,6 +33,7 @@
 
 #include <vector>
 #include <bitset>
+#include <type_traits>
 
 
 namespace smll {
@@ -191,6 +192,24 @@ namespace smll {
 	};
 
 
+	// 2D landmark positions for one face
+	// - float SoA, plain data, sub-pixel
+	struct LandmarkPoints {
+		float	x[NUM_FACIAL_LANDMARKS];
+		float	y[NUM_FACIAL_LANDMARKS];
+
+		inline cv::Point2f operator[](int i) const {
+			return cv::Point2f(x[i], y[i]);
+		}
+		inline void Set(int i, float px, float py) {
+			x[i] = px;
+			y[i] = py;
+		}
+	};
+	static_assert(std::is_trivially_copyable<LandmarkPoints>::value,
+		"LandmarkPoints must stay plain data");
+
+
 	// access to 3D landmark points
 	void	GetLandmarkPoints();
 	std::vector<cv::Point3f>	GetLandmarkPoints(const std::vector<int>& indices);
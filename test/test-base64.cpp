@@ -21,6 +21,7 @@
 #include <CppUTest/TestHarness.h>
 #include "Plugin/base64.h"
 #include <cmath>
+#include <cstring>
 #include <iostream>
 using namespace std;
 TEST_GROUP(base64Test) {};
@@ -54,4 +55,44 @@ TEST(base64Test, base64DecodeTest) {
 	for (size_t i = 0; i < actaulResult.size(); i++) {
 		CHECK_EQUAL(actaulResult[i], expectedResult[i]);
 	}
-}
\ No newline at end of file
+}
+
+TEST(base64Test, base64DecodePaddingTest) {
+	const char* encoded[] = { "Zg==", "Zm8=", "Zm9v", "Zm9vYg", "Zm9v!mFy" };
+	const char* expected[] = { "f", "fo", "foo", "foob", "foo" };
+	for (int i = 0; i < 5; i++) {
+		size_t len = strlen(encoded[i]);
+		std::vector<uint8_t> buf(base64_decoded_size(encoded[i], len));
+		size_t n = base64_decode(encoded[i], len, buf.data());
+		CHECK_EQUAL(strlen(expected[i]), n);
+		CHECK(memcmp(expected[i], buf.data(), n) == 0);
+	}
+}
+
+// big enough to cross several streaming chunks
+static std::vector<uint8_t> makeTestData(size_t size) {
+	std::vector<uint8_t> data(size);
+	uint32_t x = 12345;
+	for (size_t i = 0; i < size; i++) {
+		x = x * 1103515245 + 12345;
+		data[i] = (uint8_t)((i / 7) ^ ((x >> 16) & 0x3));
+	}
+	return data;
+}
+
+TEST(base64Test, base64DecodeZStreamTest) {
+	std::vector<uint8_t> input = makeTestData(300 * 1024);
+	string encoded = base64_encodeZ(input.data(), input.size());
+
+	CHECK_EQUAL(input.size(), base64_decodeZ_size(encoded));
+	std::vector<uint8_t> out(input.size());
+	CHECK_EQUAL(input.size(), base64_decodeZ(encoded, out.data(), out.size()));
+	CHECK(memcmp(input.data(), out.data(), out.size()) == 0);
+
+	// plain base64 comes back as is
+	string plain = base64_encode(input.data(), input.size());
+	std::vector<uint8_t> raw;
+	base64_decodeZ(plain, raw);
+	CHECK_EQUAL(input.size(), raw.size());
+	CHECK(memcmp(input.data(), raw.data(), raw.size()) == 0);
+}
@@ -0,0 +1,106 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#include <CppUTest/TestHarness.h>
+#include "mask/mask-block-compression.h"
+#include <cstdlib>
+#include <vector>
+
+using namespace Mask::BlockCompression;
+
+// largest per channel difference between two rgba images
+static int maxError(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+	int err = 0;
+	for (size_t i = 0; i < a.size(); i++) {
+		int d = abs((int)a[i] - (int)b[i]);
+		err = d > err ? d : err;
+	}
+	return err;
+}
+
+// horizontal gradient, alpha fading top to bottom
+static std::vector<uint8_t> makeGradient(int width, int height, bool alpha) {
+	std::vector<uint8_t> rgba(width * height * 4);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			uint8_t* p = &rgba[(y * width + x) * 4];
+			p[0] = (uint8_t)(x * 255 / (width - 1));
+			p[1] = (uint8_t)(255 - p[0]);
+			p[2] = 64;
+			p[3] = alpha ? (uint8_t)(y * 255 / (height - 1)) : 255;
+		}
+	}
+	return rgba;
+}
+
+TEST_GROUP(blockCompressionTest) {
+};
+
+TEST(blockCompressionTest, ImageSize) {
+	CHECK_EQUAL(8, ImageSize(BC1, 4, 4));
+	CHECK_EQUAL(16, ImageSize(BC3, 4, 4));
+	CHECK_EQUAL(8 * 4, ImageSize(BC1, 8, 8));
+	// partial blocks round up
+	CHECK_EQUAL(8, ImageSize(BC1, 2, 2));
+	CHECK_EQUAL(16 * 6, ImageSize(BC3, 5, 9));
+}
+
+TEST(blockCompressionTest, FormatNames) {
+	Format f;
+	CHECK(ParseFormat("bc1", &f));
+	CHECK_EQUAL(BC1, f);
+	CHECK(ParseFormat(FormatName(BC3), &f));
+	CHECK_EQUAL(BC3, f);
+	CHECK(!ParseFormat("dxt7", &f));
+}
+
+TEST(blockCompressionTest, SolidColorIsExact) {
+	// 565 representable color
+	std::vector<uint8_t> rgba(8 * 8 * 4);
+	for (size_t i = 0; i < rgba.size(); i += 4) {
+		rgba[i + 0] = 255;
+		rgba[i + 1] = 0;
+		rgba[i + 2] = 255;
+		rgba[i + 3] = 255;
+	}
+	std::vector<uint8_t> blocks(ImageSize(BC1, 8, 8));
+	Compress(BC1, rgba.data(), 8, 8, blocks.data());
+	std::vector<uint8_t> out(rgba.size());
+	Decompress(BC1, blocks.data(), 8, 8, out.data());
+	CHECK_EQUAL(0, maxError(rgba, out));
+}
+
+TEST(blockCompressionTest, GradientRoundTrip) {
+	std::vector<uint8_t> rgba = makeGradient(16, 16, false);
+	std::vector<uint8_t> blocks(ImageSize(BC1, 16, 16));
+	Compress(BC1, rgba.data(), 16, 16, blocks.data());
+	std::vector<uint8_t> out(rgba.size());
+	Decompress(BC1, blocks.data(), 16, 16, out.data());
+	CHECK(maxError(rgba, out) <= 16);
+}
+
+TEST(blockCompressionTest, AlphaRoundTrip) {
+	// not a multiple of 4
+	std::vector<uint8_t> rgba = makeGradient(10, 6, true);
+	std::vector<uint8_t> blocks(ImageSize(BC3, 10, 6));
+	Compress(BC3, rgba.data(), 10, 6, blocks.data());
+	std::vector<uint8_t> out(rgba.size());
+	Decompress(BC3, blocks.data(), 10, 6, out.data());
+	CHECK(maxError(rgba, out) <= 16);
+}
@@ -0,0 +1,177 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#include <CppUTest/TestHarness.h>
+#include "plugin/detection-service.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+TEST_GROUP(detectionServiceTest) {};
+
+// long enough for a busy machine, only hit when a test fails
+static const std::chrono::seconds STEP_TIMEOUT(10);
+
+class CountingClient : public Plugin::DetectionService::Client {
+public:
+	CountingClient() : steps(0), running(0), failures(0), overlapped(false),
+		throwing(false) {}
+
+	bool DetectionStep() override {
+		if (running.fetch_add(1) != 0)
+			overlapped = true;
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+		running--;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			steps++;
+			lastStep = std::chrono::system_clock::now();
+		}
+		cv.notify_all();
+		if (throwing)
+			throw std::runtime_error("detection failed");
+		return true;
+	}
+
+	std::chrono::system_clock::time_point NextRun() const override {
+		return nextRun;
+	}
+
+	void DetectionFailed(const std::exception&) override {
+		failures++;
+	}
+
+	// false if the client didn't get to n steps in time
+	bool WaitForSteps(int n) {
+		std::unique_lock<std::mutex> lock(mutex);
+		return cv.wait_for(lock, STEP_TIMEOUT, [this, n] { return steps >= n; });
+	}
+
+	std::atomic<int>	steps;
+	std::atomic<int>	running;
+	std::atomic<int>	failures;
+	std::atomic<bool>	overlapped;
+	std::atomic<bool>	throwing;
+	std::chrono::system_clock::time_point nextRun;
+	std::chrono::system_clock::time_point lastStep;
+
+	std::mutex				mutex;
+	std::condition_variable	cv;
+};
+
+TEST(detectionServiceTest, allClientsRunTest) {
+	Plugin::DetectionService& service = Plugin::DetectionService::singleton();
+
+	CountingClient a, b, c;
+	service.Register(&a);
+	service.Register(&b);
+	service.Register(&c);
+	CHECK(service.NumWorkers() > 0);
+
+	// a few frames each, every one gets processed
+	for (int frame = 1; frame <= 5; frame++) {
+		service.Notify(&a);
+		service.Notify(&b);
+		service.Notify(&c);
+		CHECK(a.WaitForSteps(frame));
+		CHECK(b.WaitForSteps(frame));
+		CHECK(c.WaitForSteps(frame));
+	}
+
+	service.Unregister(&a);
+	service.Unregister(&b);
+	service.Unregister(&c);
+	CHECK_EQUAL(0, service.NumWorkers());
+
+	// never on two workers at once
+	CHECK(!a.overlapped);
+	CHECK(!b.overlapped);
+	CHECK(!c.overlapped);
+}
+
+TEST(detectionServiceTest, unregisterStopsStepsTest) {
+	Plugin::DetectionService& service = Plugin::DetectionService::singleton();
+
+	CountingClient a;
+	service.Register(&a);
+	service.Notify(&a);
+	CHECK(a.WaitForSteps(1));
+	service.Unregister(&a);
+
+	int steps = a.steps;
+	service.Notify(&a);
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	CHECK_EQUAL(steps, a.steps);
+	CHECK_EQUAL(0, a.running);
+}
+
+TEST(detectionServiceTest, idleWithoutFramesTest) {
+	Plugin::DetectionService& service = Plugin::DetectionService::singleton();
+
+	// nothing posted, nothing run
+	CountingClient a;
+	service.Register(&a);
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	CHECK_EQUAL(0, a.steps);
+
+	// one frame, one step
+	service.Notify(&a);
+	CHECK(a.WaitForSteps(1));
+	service.Unregister(&a);
+	CHECK_EQUAL(1, a.steps);
+}
+
+TEST(detectionServiceTest, speedLimitTest) {
+	Plugin::DetectionService& service = Plugin::DetectionService::singleton();
+
+	// the frame waits for the client's next run time
+	CountingClient a;
+	a.nextRun = std::chrono::system_clock::now() + std::chrono::milliseconds(30);
+	service.Register(&a);
+	service.Notify(&a);
+	CHECK(a.WaitForSteps(1));
+	service.Unregister(&a);
+	CHECK_EQUAL(1, a.steps);
+	CHECK(a.lastStep >= a.nextRun);
+}
+
+TEST(detectionServiceTest, failuresReportedTest) {
+	Plugin::DetectionService& service = Plugin::DetectionService::singleton();
+
+	// a throwing client is reported, and doesn't stop the others
+	CountingClient a, b;
+	a.throwing = true;
+	service.Register(&a);
+	service.Register(&b);
+	for (int frame = 1; frame <= 3; frame++) {
+		service.Notify(&a);
+		service.Notify(&b);
+		CHECK(a.WaitForSteps(frame));
+		CHECK(b.WaitForSteps(frame));
+	}
+
+	// unregistering waits out the last failure report
+	service.Unregister(&a);
+	service.Unregister(&b);
+	CHECK_EQUAL(3, a.failures);
+	CHECK_EQUAL(0, b.failures);
+}
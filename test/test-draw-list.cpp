@@ -0,0 +1,130 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#include <CppUTest/TestHarness.h>
+#include "mask/mask-draw-list.h"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+struct TestCommand {
+	int id;
+};
+
+typedef Mask::DrawList<TestCommand> TestDrawList;
+
+TEST_GROUP(drawListTest) {
+};
+
+TEST(drawListTest, SortsByKey) {
+	TestDrawList list;
+	list.add(3).id = 0;
+	list.add(1).id = 1;
+	list.add(2).id = 2;
+	list.sort();
+	CHECK_EQUAL(3, list.size());
+	CHECK_EQUAL(1, list[0].id);
+	CHECK_EQUAL(2, list[1].id);
+	CHECK_EQUAL(0, list[2].id);
+	CHECK_EQUAL(3, list.key(2));
+}
+
+TEST(drawListTest, EqualKeysKeepOrder) {
+	TestDrawList list;
+	for (int i = 0; i < 10; i++)
+		list.add(i % 2).id = i;
+	list.sort();
+	for (int i = 0; i < 5; i++) {
+		CHECK_EQUAL(i * 2, list[i].id);
+		CHECK_EQUAL(i * 2 + 1, list[i + 5].id);
+	}
+}
+
+TEST(drawListTest, ClearReuses) {
+	TestDrawList list;
+	list.add(1).id = 1;
+	list.clear();
+	CHECK(list.empty());
+	list.add(5).id = 5;
+	list.sort();
+	CHECK_EQUAL(1, list.size());
+	CHECK_EQUAL(5, list[0].id);
+}
+
+TEST(drawListTest, RadixMatchesStableSort) {
+	TestDrawList list;
+	std::vector<std::pair<uint64_t, int>> expected;
+	uint64_t seed = 12345;
+	for (int i = 0; i < 1000; i++) {
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		// few distinct high bytes, lots of ties
+		uint64_t key = (seed >> 8) & 0xFF000000000FFFULL;
+		list.add(key).id = i;
+		expected.push_back(std::make_pair(key, i));
+	}
+	std::stable_sort(expected.begin(), expected.end(),
+		[](const std::pair<uint64_t, int>& a, const std::pair<uint64_t, int>& b) {
+		return a.first < b.first;
+	});
+	list.sort();
+	for (size_t i = 0; i < expected.size(); i++) {
+		CHECK_EQUAL(expected[i].second, list[i].id);
+	}
+}
+
+TEST(drawListTest, SortKeys) {
+	CHECK(Mask::SortKeyInt(-1) < Mask::SortKeyInt(0));
+	CHECK(Mask::SortKeyInt(0) < Mask::SortKeyInt(3));
+	CHECK(Mask::SortKeyFloat(-100.0f) < Mask::SortKeyFloat(-1.5f));
+	CHECK(Mask::SortKeyFloat(-1.5f) < Mask::SortKeyFloat(0.0f));
+	CHECK(Mask::SortKeyFloat(0.0f) < Mask::SortKeyFloat(0.25f));
+	CHECK(Mask::SortKeyFloat(0.25f) < Mask::SortKeyFloat(10.0f));
+}
+
+struct TestBatchCommand {
+	const void*	part;
+	const void*	sorted;
+	size_t		instanceId;
+	bool		batch;
+};
+
+TEST(drawListTest, BatchSharedSortedObject) {
+	// one transparent object referenced by two parts, faces
+	// sorted so the parts' commands end up next to each other
+	int object, partA, partB;
+	Mask::DrawList<TestBatchCommand> list;
+	list.add(1) = TestBatchCommand{ &partA, &object, 1, true };
+	list.add(2) = TestBatchCommand{ &partA, &object, 1, true };
+	list.add(3) = TestBatchCommand{ &partB, &object, 2, true };
+	list.add(4) = TestBatchCommand{ &partB, &object, 2, true };
+	list.sort();
+
+	// faces of the same part batch, the parts don't
+	CHECK(Mask::CanBatch(list[0], list[1]));
+	CHECK(!Mask::CanBatch(list[1], list[2]));
+	CHECK(Mask::CanBatch(list[2], list[3]));
+
+	// nor do different instance datas, or unbatchable commands
+	TestBatchCommand other = list[3];
+	other.instanceId = 3;
+	CHECK(!Mask::CanBatch(list[3], other));
+	other = list[3];
+	other.batch = false;
+	CHECK(!Mask::CanBatch(list[3], other));
+}
@@ -0,0 +1,80 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#include <CppUTest/TestHarness.h>
+#include "mask/mask-instance-table.h"
+#include <vector>
+
+using namespace Mask;
+
+struct CountData : public InstanceData {
+	int count;
+	CountData() : count(1) {}
+	void Reset() override { count = 0; }
+};
+
+struct ScaleData : public InstanceData {
+	float scale;
+	ScaleData() : scale(1.0f) {}
+};
+
+TEST_GROUP(instanceTableTest) {
+};
+
+TEST(instanceTableTest, GetCreatesOnce) {
+	InstanceTable table;
+	CHECK(table.Find<CountData>(5) == nullptr);
+	CountData* data = table.Get<CountData>(5);
+	data->count = 7;
+	CHECK(table.Get<CountData>(5) == data);
+	CHECK(table.Find<CountData>(5) == data);
+	CHECK_EQUAL(1, table.Size());
+}
+
+TEST(instanceTableTest, TypesAreSeparate) {
+	InstanceTable table;
+	CountData* count = table.Get<CountData>(1);
+	CHECK(table.Find<ScaleData>(1) == nullptr);
+	ScaleData* scale = table.Get<ScaleData>(1);
+	CHECK((void*)scale != (void*)count);
+	CHECK_EQUAL(2, table.Size());
+}
+
+TEST(instanceTableTest, PointersSurviveGrowing) {
+	InstanceTable table;
+	std::vector<CountData*> datas;
+	for (size_t i = 0; i < 1000; i++) {
+		datas.push_back(table.Get<CountData>(i * 2654435761u));
+		datas.back()->count = (int)i;
+	}
+	for (size_t i = 0; i < 1000; i++) {
+		CHECK(table.Find<CountData>(i * 2654435761u) == datas[i]);
+		CHECK_EQUAL((int)i, datas[i]->count);
+	}
+}
+
+TEST(instanceTableTest, Datas) {
+	InstanceTable table;
+	table.Get<CountData>(3)->count = 5;
+	table.Get<ScaleData>(4);
+	CHECK_EQUAL(2, table.Datas().size());
+	for (InstanceData* data : table.Datas())
+		data->Reset();
+	CHECK_EQUAL(0, table.Find<CountData>(3)->count);
+}
@@ -0,0 +1,109 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#include <CppUTest/TestHarness.h>
+#include "mask/mask-keyframes.h"
+#include <vector>
+
+using namespace Mask::Keyframes;
+
+TEST_GROUP(keyframesTest) {
+};
+
+TEST(keyframesTest, FromSamplesDropsLinearKeys) {
+	// a ramp up, then flat
+	float samples[] = { 0, 1, 2, 3, 4, 4, 4, 4 };
+	Curve curve;
+	FromSamples(samples, 8, 0.001f, &curve);
+	CHECK_EQUAL(3, curve.times.size());
+	DOUBLES_EQUAL(4.0, curve.times[1], 0.0);
+	DOUBLES_EQUAL(8.0, curve.length, 0.0);
+
+	CurveSet set;
+	set.Add(curve, CONSTANT, CONSTANT);
+	for (int i = 0; i < 8; i++)
+		DOUBLES_EQUAL(samples[i], set.Evaluate(0, (float)i), 0.0001);
+	// in between frames
+	DOUBLES_EQUAL(2.5, set.Evaluate(0, 2.5f), 0.0001);
+}
+
+TEST(keyframesTest, Extrapolation) {
+	float samples[] = { 0, 1, 2, 3 };
+	Curve curve;
+	FromSamples(samples, 4, 0.0f, &curve);
+
+	CurveSet set;
+	set.Add(curve, CONSTANT, CONSTANT);
+	set.Add(curve, LINEAR, LINEAR);
+	set.Add(curve, REPEAT, REPEAT);
+
+	float out[3];
+	set.Evaluate(-2.0f, out);
+	DOUBLES_EQUAL(0.0, out[0], 0.0001);
+	DOUBLES_EQUAL(-2.0, out[1], 0.0001);
+	DOUBLES_EQUAL(2.0, out[2], 0.0001);
+
+	set.Evaluate(5.0f, out);
+	DOUBLES_EQUAL(3.0, out[0], 0.0001);
+	DOUBLES_EQUAL(5.0, out[1], 0.0001);
+	DOUBLES_EQUAL(1.0, out[2], 0.0001);
+}
+
+TEST(keyframesTest, HermiteTangents) {
+	// ease in and out between two keys
+	Curve curve;
+	curve.times = { 0.0f, 10.0f };
+	curve.values = { 0.0f, 1.0f };
+	curve.inTangents = { 0.0f, 0.0f };
+	curve.outTangents = { 0.0f, 0.0f };
+
+	CurveSet set;
+	set.Add(curve, CONSTANT, CONSTANT);
+	DOUBLES_EQUAL(0.5, set.Evaluate(0, 5.0f), 0.0001);
+	CHECK(set.Evaluate(0, 1.0f) < 0.1f);
+	CHECK(set.Evaluate(0, 9.0f) > 0.9f);
+}
+
+TEST(keyframesTest, EncodeDecode) {
+	float samples[] = { 0.0f, 0.5f, 2.0f, -1.0f, 3.0f, 3.0f };
+	Curve curve;
+	FromSamples(samples, 6, 0.0f, &curve);
+
+	std::vector<uint8_t> data;
+	Encode(curve, false, &data);
+	Curve exact;
+	CHECK(Decode(data.data(), data.size(), &exact));
+	CHECK_EQUAL(curve.times.size(), exact.times.size());
+	for (size_t i = 0; i < curve.times.size(); i++)
+		DOUBLES_EQUAL(curve.values[i], exact.values[i], 0.0);
+
+	// quantized values are close
+	std::vector<uint8_t> small;
+	Encode(curve, true, &small);
+	CHECK(small.size() < data.size());
+	Curve quantized;
+	CHECK(Decode(small.data(), small.size(), &quantized));
+	for (size_t i = 0; i < curve.times.size(); i++) {
+		DOUBLES_EQUAL(curve.values[i], quantized.values[i], 0.0001);
+		DOUBLES_EQUAL(curve.outTangents[i], quantized.outTangents[i], 0.0002);
+	}
+
+	// truncated
+	CHECK(!Decode(small.data(), small.size() - 1, &quantized));
+}
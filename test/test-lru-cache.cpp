@@ -0,0 +1,101 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#include <CppUTest/TestHarness.h>
+#include "Plugin/lru-cache.h"
+#include <memory>
+#include <string>
+
+typedef Utils::LRUCache<std::string, std::unique_ptr<int>> IntCache;
+
+TEST_GROUP(lruCacheTest) {
+};
+
+TEST(lruCacheTest, PutAndTake) {
+	IntCache cache(100);
+	std::vector<std::unique_ptr<int>> evicted;
+	cache.put("a", std::unique_ptr<int>(new int(1)), 10, evicted);
+	cache.put("b", std::unique_ptr<int>(new int(2)), 20, evicted);
+	CHECK_EQUAL(0, evicted.size());
+	CHECK_EQUAL(2, cache.size());
+	CHECK_EQUAL(30, cache.cost());
+
+	std::unique_ptr<int> v;
+	CHECK(cache.take("a", v));
+	CHECK_EQUAL(1, *v);
+	CHECK(!cache.contains("a"));
+	CHECK_EQUAL(20, cache.cost());
+	CHECK(!cache.take("a", v));
+}
+
+TEST(lruCacheTest, EvictsLeastRecentlyUsed) {
+	IntCache cache(30);
+	std::vector<std::unique_ptr<int>> evicted;
+	cache.put("a", std::unique_ptr<int>(new int(1)), 10, evicted);
+	cache.put("b", std::unique_ptr<int>(new int(2)), 10, evicted);
+	cache.put("c", std::unique_ptr<int>(new int(3)), 10, evicted);
+
+	// touch a, so b is now the oldest
+	std::unique_ptr<int> v;
+	cache.take("a", v);
+	cache.put("a", std::move(v), 10, evicted);
+
+	cache.put("d", std::unique_ptr<int>(new int(4)), 10, evicted);
+	CHECK_EQUAL(1, evicted.size());
+	CHECK_EQUAL(2, *evicted[0]);
+	CHECK(cache.contains("a"));
+	CHECK(cache.contains("c"));
+	CHECK(cache.contains("d"));
+	CHECK_EQUAL(30, cache.cost());
+}
+
+TEST(lruCacheTest, OverBudget) {
+	IntCache cache(30);
+	std::vector<std::unique_ptr<int>> evicted;
+	cache.put("a", std::unique_ptr<int>(new int(1)), 10, evicted);
+
+	// too big to ever fit, handed straight back
+	cache.put("big", std::unique_ptr<int>(new int(2)), 31, evicted);
+	CHECK_EQUAL(1, evicted.size());
+	CHECK_EQUAL(2, *evicted[0]);
+	CHECK(cache.contains("a"));
+
+	// shrinking the budget evicts
+	evicted.clear();
+	cache.set_budget(0, evicted);
+	CHECK_EQUAL(1, evicted.size());
+	CHECK_EQUAL(0, cache.size());
+	CHECK_EQUAL(0, cache.cost());
+}
+
+TEST(lruCacheTest, Replace) {
+	IntCache cache(100);
+	std::vector<std::unique_ptr<int>> evicted;
+	cache.put("a", std::unique_ptr<int>(new int(1)), 10, evicted);
+	cache.put("a", std::unique_ptr<int>(new int(2)), 40, evicted);
+	CHECK_EQUAL(1, evicted.size());
+	CHECK_EQUAL(1, *evicted[0]);
+	CHECK_EQUAL(1, cache.size());
+	CHECK_EQUAL(40, cache.cost());
+
+	evicted.clear();
+	cache.clear(evicted);
+	CHECK_EQUAL(1, evicted.size());
+	CHECK_EQUAL(0, cache.size());
+}
@@ -0,0 +1,112 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#include <CppUTest/TestHarness.h>
+#include "mask/mask-binary.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+static const char* const TEST_FILE = "test-mask-binary.fmask";
+static const char* const TEST_SOURCE = "test-mask-binary.json";
+
+// json + one blob, laid out like MaskMaker's compile command does
+static void writeTestFile(const char* json, const std::vector<uint8_t>& blob) {
+	using namespace Mask::Binary;
+	Header header;
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.numSections = 2;
+	header.reserved = 0;
+
+	Section sections[2];
+	sections[0].type = SECTION_JSON;
+	sections[0].reserved = 0;
+	sections[0].offset = 64;
+	sections[0].size = strlen(json) + 1;
+	sections[1].type = SECTION_BLOB;
+	sections[1].reserved = 0;
+	sections[1].offset = 64 + ((sections[0].size + 15) & ~15);
+	sections[1].size = blob.size();
+
+	std::vector<uint8_t> file((size_t)(sections[1].offset + blob.size()));
+	memcpy(file.data(), &header, sizeof(header));
+	memcpy(file.data() + sizeof(header), sections, sizeof(sections));
+	memcpy(file.data() + sections[0].offset, json, (size_t)sections[0].size);
+	memcpy(file.data() + sections[1].offset, blob.data(), blob.size());
+
+	std::ofstream f(TEST_FILE, std::ios::binary);
+	f.write((const char*)file.data(), file.size());
+}
+
+TEST_GROUP(maskBinaryTest) {
+	void teardown() {
+		remove(TEST_FILE);
+		remove(TEST_SOURCE);
+	}
+};
+
+TEST(maskBinaryTest, roundTripTest) {
+	std::vector<uint8_t> blob = { 1, 2, 3, 4, 5 };
+	writeTestFile("{\"mip-data-0\":\"@blob:1\"}", blob);
+
+	CHECK(Mask::MappedMaskFile::IsCompiled(TEST_FILE));
+	Mask::MappedMaskFile mf(TEST_FILE);
+	STRCMP_EQUAL("{\"mip-data-0\":\"@blob:1\"}", mf.GetJson());
+
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+	CHECK(mf.GetBlob("@blob:1", &data, &size));
+	CHECK_EQUAL(blob.size(), size);
+	CHECK(memcmp(blob.data(), data, size) == 0);
+	CHECK_EQUAL(0, (int)((uintptr_t)data & 15));
+
+	// plain base64 values aren't blobs
+	CHECK(!mf.GetBlob("AQIDBAU=", &data, &size));
+}
+
+TEST(maskBinaryTest, badFileTest) {
+	writeTestFile("{}", std::vector<uint8_t>(4));
+	Mask::MappedMaskFile mf(TEST_FILE);
+	const uint8_t* data;
+	size_t size;
+	CHECK_THROWS(std::runtime_error, mf.GetBlob("@blob:0", &data, &size));
+	CHECK_THROWS(std::runtime_error, mf.GetBlob("@blob:7", &data, &size));
+	CHECK_THROWS(std::runtime_error, mf.GetBlob("@blob:x", &data, &size));
+
+	std::ofstream(TEST_FILE, std::ios::binary) << "{\"not\":\"compiled\"}";
+	CHECK(!Mask::MappedMaskFile::IsCompiled(TEST_FILE));
+	CHECK_THROWS(std::runtime_error, Mask::MappedMaskFile mf2(TEST_FILE));
+}
+
+TEST(maskBinaryTest, upToDateTest) {
+	// no compiled file yet
+	std::ofstream(TEST_SOURCE, std::ios::binary) << "{}";
+	CHECK(!Mask::MappedMaskFile::IsUpToDate(TEST_FILE, TEST_SOURCE));
+
+	// compiled after the json
+	writeTestFile("{}", std::vector<uint8_t>(4));
+	CHECK(Mask::MappedMaskFile::IsUpToDate(TEST_FILE, TEST_SOURCE));
+
+	// shipped without the json
+	remove(TEST_SOURCE);
+	CHECK(Mask::MappedMaskFile::IsUpToDate(TEST_FILE, TEST_SOURCE));
+}
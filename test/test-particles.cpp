@@ -0,0 +1,122 @@
+/*
+* Face Masks for SlOBS
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#include <CppUTest/TestHarness.h>
+#include "mask/mask-particles.h"
+#include <algorithm>
+#include <vector>
+
+using namespace Mask;
+
+static const float ZERO[3] = { 0.0f, 0.0f, 0.0f };
+
+// constant friction and force
+static ParticleForces makeForces(float friction, float force) {
+	ParticleForces f;
+	f.frictionMin = f.frictionMax = friction;
+	for (int i = 0; i < 3; i++)
+		f.forceMin[i] = f.forceMax[i] = force;
+	return f;
+}
+
+TEST_GROUP(particlesTest) {
+};
+
+TEST(particlesTest, RandomRange) {
+	ParticleRandom random(42);
+	for (int i = 0; i < 1000; i++) {
+		float f = random.Float(-2.0f, 3.0f);
+		CHECK(f >= -2.0f && f < 3.0f);
+	}
+	// zero seed still produces numbers
+	ParticleRandom zero(0);
+	CHECK(zero.Next() != 0);
+}
+
+TEST(particlesTest, EmitUpToCapacity) {
+	ParticleStore store;
+	ParticleRandom random;
+	store.Init(5);
+	CHECK_EQUAL(3, store.Emit(3, ZERO, ZERO, 1.0f, random));
+	CHECK_EQUAL(2, store.Emit(3, ZERO, ZERO, 1.0f, random));
+	CHECK_EQUAL(0, store.Emit(1, ZERO, ZERO, 1.0f, random));
+	CHECK_EQUAL(5, store.Count());
+	CHECK_EQUAL(0, store.NumAlive());
+}
+
+TEST(particlesTest, SpawnedWaitForMarkAlive) {
+	ParticleStore store;
+	ParticleRandom random;
+	store.Init(8);
+	float v[3] = { 1.0f, 2.0f, 3.0f };
+	store.Emit(1, v, v, 1.0f, random);
+	store.Integrate(0.5f, 10.0f, makeForces(1.0f, 0.0f), random);
+	DOUBLES_EQUAL(0.0, store.px()[0], 0.0001);
+
+	store.MarkAlive();
+	store.Integrate(0.5f, 10.0f, makeForces(1.0f, 0.0f), random);
+	DOUBLES_EQUAL(0.5, store.px()[0], 0.0001);
+	DOUBLES_EQUAL(1.0, store.py()[0], 0.0001);
+	DOUBLES_EQUAL(1.5, store.pz()[0], 0.0001);
+	DOUBLES_EQUAL(0.5, store.elapsed()[0], 0.0001);
+}
+
+TEST(particlesTest, FrictionAndForce) {
+	// enough particles for the simd loop and the tail
+	ParticleStore store;
+	ParticleRandom random;
+	store.Init(7);
+	float v[3] = { 4.0f, 4.0f, 4.0f };
+	store.Emit(7, v, v, 1.0f, random);
+	store.MarkAlive();
+	store.Integrate(1.0f, 10.0f, makeForces(0.5f, 1.0f), random);
+	for (int i = 0; i < 7; i++) {
+		DOUBLES_EQUAL(4.0, store.px()[i], 0.0001);
+		DOUBLES_EQUAL(3.0, store.vx()[i], 0.0001);
+		DOUBLES_EQUAL(3.0, store.vz()[i], 0.0001);
+	}
+}
+
+TEST(particlesTest, KillKeepsIds) {
+	ParticleStore store;
+	ParticleRandom random;
+	store.Init(6);
+	std::vector<size_t> ids(store.ids(), store.ids() + 6);
+
+	store.Emit(4, ZERO, ZERO, 1.0f, random);
+	store.MarkAlive();
+	store.Integrate(1.0f, 1.5f, makeForces(1.0f, 0.0f), random);
+	// two more, still spawned
+	store.Emit(2, ZERO, ZERO, 1.0f, random);
+	CHECK_EQUAL(4, store.NumAlive());
+	CHECK_EQUAL(6, store.Count());
+
+	// the first four die, the spawned two stay spawned
+	store.Integrate(1.0f, 1.5f, makeForces(1.0f, 0.0f), random);
+	CHECK_EQUAL(0, store.NumAlive());
+	CHECK_EQUAL(2, store.Count());
+	DOUBLES_EQUAL(0.0, store.elapsed()[0], 0.0001);
+	DOUBLES_EQUAL(0.0, store.elapsed()[1], 0.0001);
+
+	// ids moved around but are still the same set
+	std::vector<size_t> after(store.ids(), store.ids() + 6);
+	std::sort(ids.begin(), ids.end());
+	std::sort(after.begin(), after.end());
+	CHECK(ids == after);
+}
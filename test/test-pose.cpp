@@ -0,0 +1,89 @@
+/*
+* Face Masks for SlOBS
+* smll - streamlabs machine learning library
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#include <CppUTest/TestHarness.h>
+#include "PoseSolver.hpp"
+#include <cmath>
+
+TEST_GROUP(poseTest) {};
+
+// roughly the eye corners and nose points of the landmark model
+static const int numPoints = 7;
+static const cv::Point3f modelPoints[numPoints] = {
+	cv::Point3f(-4.5f, -3.5f, 3.0f),
+	cv::Point3f(4.5f, -3.5f, 3.0f),
+	cv::Point3f(0.0f, -3.0f, 0.0f),
+	cv::Point3f(0.0f, -1.0f, -1.0f),
+	cv::Point3f(0.0f, 1.0f, -2.0f),
+	cv::Point3f(0.0f, 2.0f, -3.0f),
+	cv::Point3f(0.0f, 4.0f, -1.0f),
+};
+
+static void project(const double r[3], const double t[3], cv::Point2f* out) {
+	double R[9];
+	smll::PoseSolver::RodriguesToMatrix(r, R);
+	for (int i = 0; i < numPoints; i++) {
+		const cv::Point3f& m = modelPoints[i];
+		double x = R[0] * m.x + R[1] * m.y + R[2] * m.z + t[0];
+		double y = R[3] * m.x + R[4] * m.y + R[5] * m.z + t[1];
+		double z = R[6] * m.x + R[7] * m.y + R[8] * m.z + t[2];
+		out[i] = cv::Point2f((float)(1280.0 * x / z + 640.0),
+			(float)(1280.0 * y / z + 360.0));
+	}
+}
+
+TEST(poseTest, rodriguesRoundTripTest) {
+	const double testRotations[3][3] = {
+		{ 0.1, -0.3, 0.05 },
+		{ 0.0, 0.0, 0.0 },
+		{ 0.0, 3.1, 0.05 }, // close to pi
+	};
+	for (int i = 0; i < 3; i++) {
+		double R[9], r[3];
+		smll::PoseSolver::RodriguesToMatrix(testRotations[i], R);
+		smll::PoseSolver::MatrixToRodrigues(R, r);
+		for (int j = 0; j < 3; j++) {
+			DOUBLES_EQUAL(testRotations[i][j], r[j], 1e-6);
+		}
+	}
+}
+
+TEST(poseTest, warmStartSolveTest) {
+	smll::PoseSolver solver;
+	solver.SetCamera(1280.0, 640.0, 360.0);
+	solver.SetModelPoints(modelPoints, numPoints);
+
+	const double rot[3] = { 0.1, -0.3, 0.05 };
+	const double trx[3] = { 2.0, -1.0, 40.0 };
+	cv::Point2f imagePoints[numPoints];
+	project(rot, trx, imagePoints);
+
+	// start from a nearby pose, like last frame's
+	double r[3] = { 0.15, -0.25, 0.0 };
+	double t[3] = { 1.5, -0.5, 38.0 };
+	double error = solver.Solve(imagePoints, r, t);
+
+	CHECK(error < 0.01);
+	for (int i = 0; i < 3; i++) {
+		DOUBLES_EQUAL(rot[i], r[i], 1e-3);
+		DOUBLES_EQUAL(trx[i], t[i], 1e-2);
+	}
+	DOUBLES_EQUAL(error, solver.ReprojectionError(imagePoints, r, t), 1e-9);
+}
@@ -174,4 +174,21 @@ TEST(UtilsTest, convertWstringToStringTest) {
 		const std::string actual = Utils::ConvertWstringToString(testTexts[i]);
 		STRCMP_EQUAL(expectedResult[i].c_str(), actual.c_str());
 	}
-}
\ No newline at end of file
+}
+TEST(UtilsTest, hash64Test) {
+	const char a[] = "identical payload, different resource name";
+	const char b[] = "identical payload, different resource name";
+	const char c[] = "identical payload, different resource namf";
+
+	// same content, same hash. any change, different hash.
+	CHECK(Utils::hash64(a, sizeof(a)) == Utils::hash64(b, sizeof(b)));
+	CHECK(Utils::hash64(a, sizeof(a)) != Utils::hash64(c, sizeof(c)));
+	CHECK(Utils::hash64(a, sizeof(a) - 1) != Utils::hash64(a, sizeof(a)));
+
+	// chaining through the seed depends on the order
+	uint64_t ab = Utils::hash64(b, 5, Utils::hash64(a, 3));
+	uint64_t ba = Utils::hash64(a, 3, Utils::hash64(b, 5));
+	CHECK(ab != ba);
+
+	STRCMP_EQUAL("00000000000000ff", Utils::hash64ToString(0xff).c_str());
+}
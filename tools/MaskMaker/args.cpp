@@ -98,6 +98,7 @@ void Args::usage() {
 	cout << "  import  -  imports an FBX file and creates a json" << endl;
 	cout << "  morphimport,mi  -  imports morph FBX files and creates a json" << endl;
 	cout << "  tweak   -  tweak (set) values in the json." << endl;
+	cout << "  compile -  compiles a json into a memory mappable .fmask file" << endl;
 	cout << endl;
 	cout << "example:" << endl;
 	cout << endl;
@@ -107,6 +108,8 @@ void Args::usage() {
 	cout << "  maskmaker.exe addres file=phong.effect helmet.json" << endl;
 	cout << "  maskmaker.exe addres type=material helmet.json" << endl;
 	cout << "  maskmaker.exe addpart name=helmet helmet.json" << endl;
+	cout << "  maskmaker.exe compile helmet.json" << endl;
+	cout << "  maskmaker.exe compile compress=auto helmet.json" << endl;
 	cout << endl;
 }
 
@@ -240,6 +243,10 @@ string Args::default_value(string key) {
 		if (key == "sound")
 			return Utils::find_resource(*jptr, "sound");
 	}
+	if (command == "compile") {
+		if (key == "compress")
+			return "none";
+	}
 
 	return "";
 }
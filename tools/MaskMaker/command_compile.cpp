@@ -0,0 +1,255 @@
+/*
+*
+* Copyright (C) 2017 General Workings Inc
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#include "stdafx.h"
+#include "utils.h"
+#include "command_compile.h"
+#include "base64.h"
+#include "mask-binary-format.h"
+#include "mask-block-compression.h"
+
+using namespace Mask::Binary;
+
+
+// store a blob, leave a reference to it in value
+static void storeBlob(json& value, vector<uint8_t> blob, vector<vector<uint8_t>>& blobs) {
+	// identical payloads (shared textures, meshes) are stored once
+	size_t idx = 0;
+	while (idx < blobs.size() && blobs[idx] != blob)
+		idx++;
+	if (idx == blobs.size())
+		blobs.emplace_back(std::move(blob));
+	// section 0 is the json
+	value = string(BLOB_PREFIX) + to_string(idx + 1);
+}
+
+// move a base64 value into a blob section, leave a reference behind
+static void moveToBlob(json& value, vector<vector<uint8_t>>& blobs) {
+	if (!value.is_string())
+		return;
+	string s = value;
+	if (s.length() == 0 || s.compare(0, strlen(BLOB_PREFIX), BLOB_PREFIX) == 0)
+		return;
+	// base64 decode, and inflate if it was zlib'd
+	vector<uint8_t> blob;
+	base64_decodeZ(s, blob);
+	storeBlob(value, std::move(blob), blobs);
+}
+
+// (operator[] would add missing keys to the json)
+static void moveToBlob(json& obj, const char* key, vector<vector<uint8_t>>& blobs) {
+	auto it = obj.find(key);
+	if (it != obj.end())
+		moveToBlob(*it, blobs);
+}
+
+static bool isImageData(const string& k) {
+	return k == "data" || k.compare(0, 9, "mip-data-") == 0 ||
+		(k.compare(0, 5, "side-") == 0 && k.find("-mip-data-") != string::npos);
+}
+
+static int intValue(const json& obj, const char* key) {
+	auto it = obj.find(key);
+	if (it == obj.end() || !it->is_number())
+		return 0;
+	return *it;
+}
+
+// Block compress the mips of an 8 bit RGBA image (2d or cubemap) into
+// blobs. mode is "auto" (BC3 if the image has alpha, else BC1), "bc1"
+// or "bc3". Returns false, and leaves the image alone, if it can't be
+// compressed.
+static bool compressImage(json& r, const string& mode, vector<vector<uint8_t>>& blobs) {
+	using namespace Mask::BlockCompression;
+
+	if (r.find("compression") != r.end())
+		return false;
+	auto cf = r.find("channel-format");
+	if (cf != r.end() && cf->is_string() && *cf == "float32")
+		return false;
+	int width = intValue(r, "width");
+	int height = intValue(r, "height");
+	int levels = intValue(r, "mip-levels");
+	if (intValue(r, "bpp") != 4 || levels < 1)
+		return false;
+	// the top level has to be whole blocks
+	if (width <= 0 || height <= 0 || (width % 4) != 0 || (height % 4) != 0)
+		return false;
+
+	bool cube = r.find("side-0-mip-data-0") != r.end();
+	int sides = cube ? 6 : 1;
+	vector<string> keys;
+	vector<vector<uint8_t>> mips;
+	bool alpha = false;
+	for (int side = 0; side < sides; side++) {
+		for (int level = 0; level < levels; level++) {
+			char key[64];
+			if (cube)
+				snprintf(key, sizeof(key), "side-%d-mip-data-%d", side, level);
+			else
+				snprintf(key, sizeof(key), "mip-data-%d", level);
+			auto it = r.find(key);
+			if (it == r.end() || !it->is_string())
+				return false;
+			vector<uint8_t> mip;
+			base64_decodeZ(it->get<string>(), mip);
+			size_t w = max(width >> level, 1);
+			size_t h = max(height >> level, 1);
+			if (mip.size() != w * h * 4)
+				return false;
+			for (size_t i = 3; i < mip.size() && !alpha; i += 4)
+				alpha = mip[i] < 255;
+			keys.push_back(key);
+			mips.emplace_back(std::move(mip));
+		}
+	}
+
+	Format format;
+	if (mode == "auto")
+		format = alpha ? BC3 : BC1;
+	else if (!ParseFormat(mode.c_str(), &format)) {
+		cout << "Unknown texture compression '" << mode << "'." << endl;
+		return false;
+	}
+	if (format == BC1 && alpha)
+		cout << "Warning: BC1 drops the alpha channel." << endl;
+
+	for (size_t i = 0; i < mips.size(); i++) {
+		int level = (int)(i % levels);
+		int w = max(width >> level, 1);
+		int h = max(height >> level, 1);
+		vector<uint8_t> blocks(ImageSize(format, w, h));
+		Compress(format, mips[i].data(), w, h, blocks.data());
+		storeBlob(r[keys[i]], std::move(blocks), blobs);
+	}
+	r["compression"] = FormatName(format);
+	return true;
+}
+
+static void writePadding(fstream& f, uint64_t& pos) {
+	static const char zeros[SECTION_ALIGNMENT] = { 0 };
+	uint64_t pad = (SECTION_ALIGNMENT - (pos % SECTION_ALIGNMENT)) % SECTION_ALIGNMENT;
+	f.write(zeros, pad);
+	pos += pad;
+}
+
+
+void command_compile(Args& args) {
+
+	json j = args.loadJsonFile(args.filename);
+	if (j.is_null())
+		return;
+
+	// block compress textures?
+	string compress = args.value("compress");
+	bool compressTextures = compress != "none";
+	int compressedImages = 0;
+
+	// pull the payloads out of the resources
+	vector<vector<uint8_t>> blobs;
+	auto res = j.find("resources");
+	if (res == j.end()) {
+		cout << "No resources in '" << args.filename << "'." << endl;
+		return;
+	}
+	for (auto it = res->begin(); it != res->end(); it++) {
+		json& r = it.value();
+		auto tt = r.find("type");
+		if (tt == r.end() || !tt->is_string())
+			continue;
+		string tp = *tt;
+		if (tp == "image") {
+			if (compressTextures && compressImage(r, compress, blobs))
+				compressedImages++;
+			for (auto kt = r.begin(); kt != r.end(); kt++) {
+				if (isImageData(kt.key()))
+					moveToBlob(kt.value(), blobs);
+			}
+		}
+		else if (tp == "mesh") {
+			moveToBlob(r, "vertex-buffer", blobs);
+			moveToBlob(r, "index-buffer", blobs);
+			moveToBlob(r, "data", blobs);
+		}
+		else if (tp == "animation") {
+			auto channels = r.find("channels");
+			if (channels == r.end())
+				continue;
+			for (auto ct = channels->begin(); ct != channels->end(); ct++) {
+				if (ct->is_object()) {
+					moveToBlob(*ct, "values", blobs);
+					moveToBlob(*ct, "keys", blobs);
+				}
+			}
+		}
+	}
+	string js = j.dump();
+
+	// output file
+	string outFile;
+	if (args.haveValue("out"))
+		outFile = args.value("out");
+	else {
+		outFile = args.filename;
+		size_t dot = outFile.find_last_of("./\\");
+		if (dot != string::npos && outFile[dot] == '.')
+			outFile.erase(dot);
+		outFile += FILE_EXTENSION;
+	}
+
+	// lay out the sections
+	uint32_t numSections = (uint32_t)blobs.size() + 1;
+	vector<Section> sections(numSections);
+	uint64_t pos = sizeof(Header) + sizeof(Section) * numSections;
+	for (uint32_t i = 0; i < numSections; i++) {
+		pos += (SECTION_ALIGNMENT - (pos % SECTION_ALIGNMENT)) % SECTION_ALIGNMENT;
+		sections[i].type = (i == 0) ? SECTION_JSON : SECTION_BLOB;
+		sections[i].reserved = 0;
+		sections[i].offset = pos;
+		sections[i].size = (i == 0) ? js.length() + 1 : blobs[i - 1].size();
+		pos += sections[i].size;
+	}
+
+	Header header;
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.numSections = numSections;
+	header.reserved = 0;
+
+	fstream f(outFile.c_str(), ios::out | ios::binary);
+	if (!f.good()) {
+		cout << "Cannot write compiled mask '" << outFile << "'." << endl;
+		return;
+	}
+	f.write((const char*)&header, sizeof(header));
+	f.write((const char*)sections.data(), sizeof(Section) * numSections);
+	pos = sizeof(Header) + sizeof(Section) * numSections;
+	for (uint32_t i = 0; i < numSections; i++) {
+		writePadding(f, pos);
+		if (i == 0)
+			f.write(js.c_str(), js.length() + 1);
+		else
+			f.write((const char*)blobs[i - 1].data(), blobs[i - 1].size());
+		pos += sections[i].size;
+	}
+	f.close();
+
+	cout << "Compiled '" << args.filename << "' to '" << outFile << "' ("
+		<< blobs.size() << " blobs, " << compressedImages << " compressed images, "
+		<< pos << " bytes)." << endl;
+}
@@ -20,8 +20,11 @@
 #include "utils.h"
 #include "command_import.h"
 #include "command_morph_import.h"
+#include "mask-keyframes.h"
 
-#define MAX_BONES_PER_SKIN		(8)
+// bone palette size of the effects (mask-resource-skinned-model.h)
+#define MAX_BONES_PER_SKIN		(64)
+#define MAX_BONES_PER_VERTEX	(8)
 
 #define INHERIT_TYPE_RrSs 0
 #define INHERIT_TYPE_RSrs 1
@@ -427,6 +430,21 @@ string AnimBehaviourToString(aiAnimBehaviour b) {
 	return "repeat";
 }
 
+// one sample per frame, to quantized keyframes
+string EncodeChannelKeys(const std::vector<float>& samples) {
+	float lo = samples.empty() ? 0.0f : samples[0];
+	float hi = lo;
+	for (float v : samples) {
+		lo = v < lo ? v : lo;
+		hi = v > hi ? v : hi;
+	}
+	Mask::Keyframes::Curve curve;
+	Mask::Keyframes::FromSamples(samples.data(), samples.size(), (hi - lo) * 0.0001f, &curve);
+	std::vector<uint8_t> data;
+	Mask::Keyframes::Encode(curve, true, &data);
+	return base64_encodeZ(data.data(), data.size());
+}
+
 struct VtxToBone {
 	int		bone;	// index into mesh bones list
 	float	weight;
@@ -612,7 +630,7 @@ void command_import(Args& args) {
 				if (verts[j].bones.size() == 0) {
 					cout << "WARNING! SKINNED MESH HAS ENTIRELY UNWEIGHTED VERTEX!" << endl;
 				}
-				if (verts[j].bones.size() > MAX_BONES_PER_SKIN) {
+				if (verts[j].bones.size() > MAX_BONES_PER_VERTEX) {
 					cout << "WARNING! SKINNED MESH VERTEX " << j << " HAS TOO MANY WEIGHTS! " << verts[j].bones.size() << endl;
 					for (unsigned int k = 0; k < verts[j].bones.size(); k++) {
 						cout << " vert bone index: " << verts[j].bones[k].bone << " : " << verts[j].bones[k].weight << endl;
@@ -1331,7 +1349,7 @@ void ImportAnimations(Args& args, const aiScene* scene, json& rez,
 
 						const aiVectorKey& next_key = chan->mPositionKeys[keyframe+1];
 						double next_time = next_key.mTime;
-						const aiVector3D &nv = key.mValue;
+						const aiVector3D &nv = next_key.mValue;
 
 						if (current_time <= timestamp && next_time > timestamp) {
 							double delta_time = next_time - current_time;
@@ -1413,8 +1431,7 @@ void ImportAnimations(Args& args, const aiScene* scene, json& rez,
 					}
 					jchan["pre-state"] = AnimBehaviourToString(chan->mPreState);
 					jchan["post-state"] = AnimBehaviourToString(chan->mPostState);
-					jchan["values"] = base64_encodeZ((uint8_t*)xkeys.data(),
-						(unsigned int)(sizeof(float) * xkeys.size()));
+					jchan["keys"] = EncodeChannelKeys(xkeys);
 					snprintf(temp, sizeof(temp), "%d", jchanCount++);
 					jchannels[temp] = jchan;
 				}
@@ -1430,8 +1447,7 @@ void ImportAnimations(Args& args, const aiScene* scene, json& rez,
 					}
 					jchan["pre-state"] = AnimBehaviourToString(chan->mPreState);
 					jchan["post-state"] = AnimBehaviourToString(chan->mPostState);
-					jchan["values"] = base64_encodeZ((uint8_t*)ykeys.data(),
-						(unsigned int)(sizeof(float) * ykeys.size()));
+					jchan["keys"] = EncodeChannelKeys(ykeys);
 					snprintf(temp, sizeof(temp), "%d", jchanCount++);
 					jchannels[temp] = jchan;
 				}
@@ -1447,8 +1463,7 @@ void ImportAnimations(Args& args, const aiScene* scene, json& rez,
 					}
 					jchan["pre-state"] = AnimBehaviourToString(chan->mPreState);
 					jchan["post-state"] = AnimBehaviourToString(chan->mPostState);
-					jchan["values"] = base64_encodeZ((uint8_t*)zkeys.data(),
-						(unsigned int)(sizeof(float) * zkeys.size()));
+					jchan["keys"] = EncodeChannelKeys(zkeys);
 					snprintf(temp, sizeof(temp), "%d", jchanCount++);
 					jchannels[temp] = jchan;
 				}
@@ -1535,8 +1550,7 @@ void ImportAnimations(Args& args, const aiScene* scene, json& rez,
 					jchan["type"] = "part-qrot-x";
 					jchan["pre-state"] = AnimBehaviourToString(chan->mPreState);
 					jchan["post-state"] = AnimBehaviourToString(chan->mPostState);
-					jchan["values"] = base64_encodeZ((uint8_t*)xkeys.data(),
-						(unsigned int)(sizeof(float) * xkeys.size()));
+					jchan["keys"] = EncodeChannelKeys(xkeys);
 					snprintf(temp, sizeof(temp), "%d", jchanCount++);
 					jchannels[temp] = jchan;
 				}
@@ -1546,8 +1560,7 @@ void ImportAnimations(Args& args, const aiScene* scene, json& rez,
 					jchan["type"] = "part-qrot-y";
 					jchan["pre-state"] = AnimBehaviourToString(chan->mPreState);
 					jchan["post-state"] = AnimBehaviourToString(chan->mPostState);
-					jchan["values"] = base64_encodeZ((uint8_t*)ykeys.data(),
-						(unsigned int)(sizeof(float) * ykeys.size()));
+					jchan["keys"] = EncodeChannelKeys(ykeys);
 					snprintf(temp, sizeof(temp), "%d", jchanCount++);
 					jchannels[temp] = jchan;
 				}
@@ -1557,8 +1570,7 @@ void ImportAnimations(Args& args, const aiScene* scene, json& rez,
 					jchan["type"] = "part-qrot-z";
 					jchan["pre-state"] = AnimBehaviourToString(chan->mPreState);
 					jchan["post-state"] = AnimBehaviourToString(chan->mPostState);
-					jchan["values"] = base64_encodeZ((uint8_t*)zkeys.data(),
-						(unsigned int)(sizeof(float) * zkeys.size()));
+					jchan["keys"] = EncodeChannelKeys(zkeys);
 					snprintf(temp, sizeof(temp), "%d", jchanCount++);
 					jchannels[temp] = jchan;
 				}
@@ -1568,8 +1580,7 @@ void ImportAnimations(Args& args, const aiScene* scene, json& rez,
 					jchan["type"] = "part-qrot-w";
 					jchan["pre-state"] = AnimBehaviourToString(chan->mPreState);
 					jchan["post-state"] = AnimBehaviourToString(chan->mPostState);
-					jchan["values"] = base64_encodeZ((uint8_t*)wkeys.data(),
-						(unsigned int)(sizeof(float) * wkeys.size()));
+					jchan["keys"] = EncodeChannelKeys(wkeys);
 					snprintf(temp, sizeof(temp), "%d", jchanCount++);
 					jchannels[temp] = jchan;
 				}
@@ -1646,8 +1657,7 @@ void ImportAnimations(Args& args, const aiScene* scene, json& rez,
 					jchan["type"] = "part-scl-x";
 					jchan["pre-state"] = AnimBehaviourToString(chan->mPreState);
 					jchan["post-state"] = AnimBehaviourToString(chan->mPostState);
-					jchan["values"] = base64_encodeZ((uint8_t*)xkeys.data(),
-						(unsigned int)(sizeof(float) * xkeys.size()));
+					jchan["keys"] = EncodeChannelKeys(xkeys);
 					snprintf(temp, sizeof(temp), "%d", jchanCount++);
 					jchannels[temp] = jchan;
 				}
@@ -1657,8 +1667,7 @@ void ImportAnimations(Args& args, const aiScene* scene, json& rez,
 					jchan["type"] = "part-scl-y";
 					jchan["pre-state"] = AnimBehaviourToString(chan->mPreState);
 					jchan["post-state"] = AnimBehaviourToString(chan->mPostState);
-					jchan["values"] = base64_encodeZ((uint8_t*)ykeys.data(),
-						(unsigned int)(sizeof(float) * ykeys.size()));
+					jchan["keys"] = EncodeChannelKeys(ykeys);
 					snprintf(temp, sizeof(temp), "%d", jchanCount++);
 					jchannels[temp] = jchan;
 				}
@@ -1668,8 +1677,7 @@ void ImportAnimations(Args& args, const aiScene* scene, json& rez,
 					jchan["type"] = "part-scl-z";
 					jchan["pre-state"] = AnimBehaviourToString(chan->mPreState);
 					jchan["post-state"] = AnimBehaviourToString(chan->mPostState);
-					jchan["values"] = base64_encodeZ((uint8_t*)zkeys.data(),
-						(unsigned int)(sizeof(float) * zkeys.size()));
+					jchan["keys"] = EncodeChannelKeys(zkeys);
 					snprintf(temp, sizeof(temp), "%d", jchanCount++);
 					jchannels[temp] = jchan;
 				}
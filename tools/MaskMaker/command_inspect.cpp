@@ -19,7 +19,9 @@
 #include "stdafx.h"
 #include "utils.h"
 #include "command_inspect.h"
-#define MAX_BONES_PER_SKIN		(8)
+// bone palette size of the effects (mask-resource-skinned-model.h)
+#define MAX_BONES_PER_SKIN		(64)
+#define MAX_BONES_PER_VERTEX	(8)
 
 
 #define ALIGNED(XXX) (((size_t)(XXX) & 0xF) ? (((size_t)(XXX) + 0x10) & 0xFFFFFFFFFFFFFFF0ULL) : (size_t)(XXX))
@@ -562,7 +564,7 @@ void command_inspect(Args& args) {
 				if (verts[j].bones.size() == 0) {
 					cerr << "WARNING! SKINNED MESH HAS ENTIRELY UNWEIGHTED VERTEX!" << endl;
 				}
-				if (verts[j].bones.size() > MAX_BONES_PER_SKIN) {
+				if (verts[j].bones.size() > MAX_BONES_PER_VERTEX) {
 					cerr << "WARNING! SKINNED MESH VERTEX " << j << " HAS TOO MANY WEIGHTS! " << verts[j].bones.size() << endl;
 					for (unsigned int k = 0; k < verts[j].bones.size(); k++) {
 						cerr << " vert bone index: " << verts[j].bones[k].bone << " : " << verts[j].bones[k].weight << endl;